@@ -4,6 +4,12 @@
 
 #define LOCTEXT_NAMESPACE "FStateMachineModule"
 
+DEFINE_LOG_CATEGORY(LogStateMachine);
+
+DEFINE_STAT(STAT_StateMachine_TickComponent);
+DEFINE_STAT(STAT_StateMachine_SwitchState);
+DEFINE_STAT(STAT_StateMachine_BatchTick);
+
 void FStateMachineModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
@@ -2,6 +2,10 @@
 
 
 #include "StateMachineComponent.h"
+#include "StateMachine.h"
+#include "StateMachineSubsystem.h"
+#include "StateMachineTraceSubsystem.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 
 // Sets default values for this component's properties
 UStateMachineComponent::UStateMachineComponent()
@@ -16,22 +20,55 @@ UStateMachineComponent::UStateMachineComponent()
 
 bool UStateMachineComponent::SwitchState(FGameplayTag Tag)
 {
-	
+	if(!Tag.IsValid())
+	{
+		if(bDebug)
+		{
+			UE_LOG(LogStateMachine, Error, TEXT("Could not switch state for %s to an invalid tag"), *GetOwner()->GetName());
+		}
+		return false;
+	}
+	return SwitchStateByIndex(ResolveStateIndex(Tag));
+}
+
+bool UStateMachineComponent::SwitchStateByIndex(int32 StateIndex)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StateMachine_SwitchState);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UStateMachineComponent::SwitchState);
+
+	if(!StateTable.IsValidIndex(StateIndex))
+	{
+		return false;
+	}
+	const FGameplayTag& Tag = StateTable[StateIndex];
 	if(Tag.MatchesTagExact(StateTag)) 
 	{ 
 		if(bDebug)
 		{
-			UE_LOG(LogTemp, Error, TEXT("Could not switch state for %s because it is already in %s"), *GetOwner()->GetName(), *Tag.ToString());
+			UE_LOG(LogStateMachine, Error, TEXT("Could not switch state for %s because it is already in %s"), *GetOwner()->GetName(), *Tag.ToString());
 		}
 		return false;
 	}
+	if(TraceSubsystem)
+	{
+		TraceSubsystem->RecordTransition(GetWorld()->GetTimeSeconds(), GetOwner()->GetUniqueID(), StateTag, Tag);
+	}
 	// To prevent the old state ticking after switching to a new one
 	bCanTickState = false;
 	EndState();
 	StateTag = Tag;
+	CurrentStateIndex = StateIndex;
 	InitState();
 	bCanTickState = true;
 
+	TimeInState = 0.f;
+	if(BatchSubsystem)
+	{
+		BatchSubsystem->ResetTimeInState(BatchSlot);
+	}
+	UpdateBatch();
+	bDebugTextDirty = true;
+
 	if(StateChangedDelegate.IsBound())
 	{
 		StateChangedDelegate.Broadcast(StateTag);
@@ -45,37 +82,245 @@ void UStateMachineComponent::BeginPlay()
 	Super::BeginPlay();
 
 	// ...
-	SwitchState(InitialStateTag);
+	StateHistoryRing.SetNum(FMath::Max(StateHistoryLength, 0));
+	StateHistoryHead = 0;
+	StateHistoryNum = 0;
+	StateHistory.Reset(StateHistoryRing.Num());
+
+	UStateMachineTraceSubsystem* Trace = GetWorld()->GetSubsystem<UStateMachineTraceSubsystem>();
+	TraceSubsystem = Trace && Trace->IsRecording() ? Trace : nullptr;
+
+	for(const FGameplayTag& State : States)
+	{
+		ResolveStateIndex(State);
+	}
+
+	if(bBatchTick)
+	{
+		if(UStateMachineSubsystem* Subsystem = GetWorld()->GetSubsystem<UStateMachineSubsystem>())
+		{
+			Subsystem->RegisterMachine(this);
+			SetComponentTickEnabled(false);
+		}
+	}
+
+	if(InitialStateTag.IsValid())
+	{
+		SwitchState(InitialStateTag);
+	}
+	else
+	{
+		UE_LOG(LogStateMachine, Error, TEXT("State machine of %s has no InitialStateTag, it starts without a state"), *GetOwner()->GetName());
+		// SwitchState refuses the empty tag, but machines without an initial state always started and ticked in it
+		InitState();
+		bCanTickState = true;
+		UpdateBatch();
+		bDebugTextDirty = true;
+	}
+}
+
+void UStateMachineComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(BatchSubsystem)
+	{
+		BatchSubsystem->UnregisterMachine(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 UStateMachineComponent::RegisterStateHandlers(FGameplayTag Tag, FStateHandlers Handlers)
+{
+	const int32 StateIndex = ResolveStateIndex(Tag);
+	if(StateIndex == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+	// Only states with handlers get a row, states that are merely switched to don't grow the table
+	if(!StateHandlers.IsValidIndex(StateIndex))
+	{
+		StateHandlers.SetNum(StateIndex + 1);
+	}
+	StateHandlers[StateIndex] = MoveTemp(Handlers);
+	if(StateIndex == CurrentStateIndex)
+	{
+		UpdateBatch();
+	}
+	return StateIndex;
+}
+
+float UStateMachineComponent::GetTimeInState() const
+{
+	return BatchSubsystem ? BatchSubsystem->GetTimeInState(BatchSlot) : TimeInState;
+}
+
+void UStateMachineComponent::SaveState(FStateMachineSnapshot& OutSnapshot) const
+{
+	OutSnapshot.StateIndex = CurrentStateIndex;
+	OutSnapshot.TimeInState = GetTimeInState();
+	OutSnapshot.bCanTickState = bCanTickState;
+}
+
+void UStateMachineComponent::RestoreState(const FStateMachineSnapshot& Snapshot)
+{
+	if(Snapshot.StateIndex != CurrentStateIndex)
+	{
+		CurrentStateIndex = StateTable.IsValidIndex(Snapshot.StateIndex) ? Snapshot.StateIndex : INDEX_NONE;
+		StateTag = CurrentStateIndex != INDEX_NONE ? StateTable[CurrentStateIndex] : FGameplayTag();
+		bDebugTextDirty = true;
+	}
+	bCanTickState = Snapshot.bCanTickState;
+
+	TimeInState = Snapshot.TimeInState;
+	if(BatchSubsystem)
+	{
+		BatchSubsystem->SetTimeInState(BatchSlot, Snapshot.TimeInState);
+	}
+	UpdateBatch();
+}
+
+TArray<FGameplayTag> UStateMachineComponent::GetStateHistory() const
+{
+	TArray<FGameplayTag> History;
+	History.Reserve(StateHistoryNum);
+	for(int32 i = 0; i < StateHistoryNum; ++i)
+	{
+		History.Add(GetStateHistoryEntry(i));
+	}
+	return History;
+}
+
+const FGameplayTag& UStateMachineComponent::GetStateHistoryEntry(int32 Index) const
+{
+	check(Index >= 0 && Index < StateHistoryNum);
+	// The oldest entry sits at the head once the ring is full, at slot 0 before that
+	const int32 Oldest = StateHistoryNum < StateHistoryRing.Num() ? 0 : StateHistoryHead;
+	return StateHistoryRing[(Oldest + Index) % StateHistoryRing.Num()];
+}
+
+int32 UStateMachineComponent::GetStateIndex(FGameplayTag Tag) const
+{
+	const int32* StateIndex = StateIndices.Find(Tag);
+	return StateIndex ? *StateIndex : INDEX_NONE;
+}
+
+int32 UStateMachineComponent::ResolveStateIndex(const FGameplayTag& Tag)
+{
+	if(const int32* StateIndex = StateIndices.Find(Tag))
+	{
+		return *StateIndex;
+	}
+	if(!Tag.IsValid())
+	{
+		return INDEX_NONE;
+	}
+	const int32 StateIndex = StateTable.Add(Tag);
+	StateIndices.Add(Tag, StateIndex);
+	return StateIndex;
 }
 
 
 // Called every frame
 void UStateMachineComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
+	SCOPE_CYCLE_COUNTER(STAT_StateMachine_TickComponent);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UStateMachineComponent::TickComponent);
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
 	// ...
+	Step(DeltaTime);
+}
+
+void UStateMachineComponent::Step(float DeltaTime)
+{
+	checkSlow(!IsBatched());
+	TimeInState += DeltaTime;
+	TickStateMachine(DeltaTime);
+}
 
+void UStateMachineComponent::TickStateMachine(float DeltaTime)
+{
 	if(bCanTickState)
 	{
 		TickState(DeltaTime);
 	}
 
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
 	if(bDebug)
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 0.0f, FColor::Red, FString::Printf(TEXT("Current State for %s: %s"), *GetOwner()->GetName(), *StateTag.ToString()));
-		if(StateHistory.Num() > 0)
+		if(bDebugTextDirty)
 		{
-			for(int32 i = 0; i < StateHistory.Num(); ++i)
-			{
-				GEngine->AddOnScreenDebugMessage(-1, 0.0f, FColor::Blue, FString::Printf(TEXT("%s"), *StateHistory[i].ToString()));
-			}
+			UpdateDebugText();
+		}
+		// A key per machine replaces last frame's message instead of queueing a new one
+		const uint64 DebugKey = static_cast<uint64>(GetUniqueID()) << 1;
+		GEngine->AddOnScreenDebugMessage(DebugKey, 0.0f, FColor::Red, DebugStateText);
+		if(StateHistoryNum > 0)
+		{
+			GEngine->AddOnScreenDebugMessage(DebugKey | 1, 0.0f, FColor::Blue, DebugHistoryText);
 		}
 	}
+#endif
+}
+
+void UStateMachineComponent::UpdateDebugText()
+{
+	DebugStateText = FString::Printf(TEXT("Current State for %s: %s"), *GetOwner()->GetName(), *StateTag.ToString());
+	DebugHistoryText.Reset();
+	for(int32 i = 0; i < StateHistoryNum; ++i)
+	{
+		if(i > 0)
+		{
+			DebugHistoryText += TEXT("\n");
+		}
+		DebugHistoryText += GetStateHistoryEntry(i).ToString();
+	}
+	bDebugTextDirty = false;
+}
+
+void UStateMachineComponent::TickNativeState(int32 StateIndex, float DeltaTime)
+{
+	StateHandlers[StateIndex].Tick.ExecuteIfBound(DeltaTime);
+}
+
+EStateTickWork UStateMachineComponent::GetTickWork() const
+{
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if(bDebug)
+	{
+		return EStateTickWork::GameThread;
+	}
+#endif
+	if(!bCanTickState)
+	{
+		return EStateTickWork::None;
+	}
+	// Listeners bound between switches are caught by the subsystem, which calls UpdateBatch once it sees them
+	if(bBroadcastTickDelegate || TickStateDelegate.IsBound())
+	{
+		return EStateTickWork::GameThread;
+	}
+	if(StateHandlers.IsValidIndex(CurrentStateIndex) && StateHandlers[CurrentStateIndex].Tick.IsBound())
+	{
+		return StateHandlers[CurrentStateIndex].bTickIsThreadSafe ? EStateTickWork::ThreadSafe : EStateTickWork::GameThread;
+	}
+	return EStateTickWork::None;
+}
+
+void UStateMachineComponent::UpdateBatch()
+{
+	if(BatchSubsystem)
+	{
+		BatchSubsystem->UpdateMachine(BatchSlot, CurrentStateIndex, bCanTickState, GetTickWork());
+	}
 }
 
 void UStateMachineComponent::InitState()
 {
+	if(StateHandlers.IsValidIndex(CurrentStateIndex))
+	{
+		StateHandlers[CurrentStateIndex].Init.ExecuteIfBound();
+	}
 	if(InitStateDelegate.IsBound())
 	{
 		InitStateDelegate.Broadcast(StateTag);
@@ -84,6 +329,10 @@ void UStateMachineComponent::InitState()
 
 void UStateMachineComponent::TickState(float deltaTime)
 {
+	if(StateHandlers.IsValidIndex(CurrentStateIndex))
+	{
+		StateHandlers[CurrentStateIndex].Tick.ExecuteIfBound(deltaTime);
+	}
 	if(TickStateDelegate.IsBound())
 	{
 		TickStateDelegate.Broadcast(deltaTime, StateTag);
@@ -92,12 +341,22 @@ void UStateMachineComponent::TickState(float deltaTime)
 
 void UStateMachineComponent::EndState()
 {
-	if(StateHistory.Num() >= StateHistoryLength)
+	if(StateHistoryRing.Num() > 0)
+	{
+		StateHistoryRing[StateHistoryHead] = StateTag;
+		StateHistoryHead = (StateHistoryHead + 1) % StateHistoryRing.Num();
+		StateHistoryNum = FMath::Min(StateHistoryNum + 1, StateHistoryRing.Num());
+
+		if(StateHistory.Num() >= StateHistoryRing.Num())
+		{
+			StateHistory.RemoveAt(0, 1, false);
+		}
+		StateHistory.Add(StateTag);
+	}
+	if(StateHandlers.IsValidIndex(CurrentStateIndex))
 	{
-		StateHistory.RemoveAt(0);
-		
+		StateHandlers[CurrentStateIndex].End.ExecuteIfBound();
 	}
-	StateHistory.Push(StateTag);
 	if(EndStateDelegate.IsBound())
 	{
 		EndStateDelegate.Broadcast(StateTag);
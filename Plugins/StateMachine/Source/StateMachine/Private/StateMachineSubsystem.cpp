@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StateMachineSubsystem.h"
+#include "StateMachine.h"
+#include "StateMachineComponent.h"
+#include "Async/ParallelFor.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+void UStateMachineSubsystem::Deinitialize()
+{
+	for (UStateMachineComponent* Machine : Machines)
+	{
+		if (Machine)
+		{
+			Machine->BatchSubsystem = nullptr;
+			Machine->BatchSlot = INDEX_NONE;
+		}
+	}
+	Machines.Empty();
+	StateIndices.Empty();
+	CanTickState.Empty();
+	TimeInState.Empty();
+	TickWork.Empty();
+	NumThreadSafeMachines = 0;
+
+	Super::Deinitialize();
+}
+
+bool UStateMachineSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStateMachineSubsystem::Tick(float DeltaTime)
+{
+	TickMachines(DeltaTime);
+}
+
+bool UStateMachineSubsystem::IsTickable() const
+{
+	return bAutoTick && Machines.Num() > 0;
+}
+
+TStatId UStateMachineSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStateMachineSubsystem, STATGROUP_StateMachine);
+}
+
+void UStateMachineSubsystem::TickMachines(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StateMachine_BatchTick);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UStateMachineSubsystem::TickMachines);
+
+	bIsTicking = true;
+	const int32 NumMachines = Machines.Num();
+
+	for (int32 Slot = 0; Slot < NumMachines; ++Slot)
+	{
+		TimeInState[Slot] += DeltaTime;
+
+		// A listener bound after the machine's last switch, e.g. from the owner's BeginPlay, moves it to the game thread
+		if (TickWork[Slot] != EStateTickWork::GameThread && CanTickState[Slot] && Machines[Slot]->TickStateDelegate.IsBound())
+		{
+			Machines[Slot]->UpdateBatch();
+		}
+	}
+
+	// Thread safe handlers must not switch state or touch other machines, so they can all run at once
+	if (NumThreadSafeMachines > 0)
+	{
+		ParallelFor(NumMachines, [this, DeltaTime](int32 Slot)
+		{
+			if (TickWork[Slot] == EStateTickWork::ThreadSafe && CanTickState[Slot])
+			{
+				Machines[Slot]->TickNativeState(StateIndices[Slot], DeltaTime);
+			}
+		});
+	}
+
+	for (int32 Slot = 0; Slot < NumMachines; ++Slot)
+	{
+		if (TickWork[Slot] == EStateTickWork::GameThread)
+		{
+			Machines[Slot]->TickStateMachine(DeltaTime);
+		}
+	}
+
+	bIsTicking = false;
+
+	// Highest slot first, so swapping the last slot in never moves a slot that is still pending
+	PendingRemovals.Sort(TGreater<int32>());
+	for (const int32 Slot : PendingRemovals)
+	{
+		RemoveSlot(Slot);
+	}
+	PendingRemovals.Reset();
+}
+
+int32 UStateMachineSubsystem::RegisterMachine(UStateMachineComponent* Machine)
+{
+	check(Machine && Machine->BatchSlot == INDEX_NONE);
+
+	const int32 Slot = Machines.Add(Machine);
+	StateIndices.Add(Machine->CurrentStateIndex);
+	CanTickState.Add(Machine->bCanTickState);
+	TimeInState.Add(0.f);
+	TickWork.Add(EStateTickWork::None);
+
+	Machine->BatchSubsystem = this;
+	Machine->BatchSlot = Slot;
+	UpdateMachine(Slot, Machine->CurrentStateIndex, Machine->bCanTickState, Machine->GetTickWork());
+	return Slot;
+}
+
+void UStateMachineSubsystem::UnregisterMachine(UStateMachineComponent* Machine)
+{
+	const int32 Slot = Machine->BatchSlot;
+	if (!Machines.IsValidIndex(Slot) || Machines[Slot] != Machine)
+	{
+		return;
+	}
+
+	Machine->BatchSubsystem = nullptr;
+	Machine->BatchSlot = INDEX_NONE;
+
+	if (bIsTicking)
+	{
+		// The loop may still be iterating this slot, so only stop it from ticking for now
+		UpdateMachine(Slot, INDEX_NONE, false, EStateTickWork::None);
+		Machines[Slot] = nullptr;
+		PendingRemovals.Add(Slot);
+	}
+	else
+	{
+		RemoveSlot(Slot);
+	}
+}
+
+void UStateMachineSubsystem::UpdateMachine(int32 Slot, int32 StateIndex, bool bCanTickState, EStateTickWork InTickWork)
+{
+	NumThreadSafeMachines -= TickWork[Slot] == EStateTickWork::ThreadSafe ? 1 : 0;
+	NumThreadSafeMachines += InTickWork == EStateTickWork::ThreadSafe ? 1 : 0;
+
+	StateIndices[Slot] = StateIndex;
+	CanTickState[Slot] = bCanTickState;
+	TickWork[Slot] = InTickWork;
+}
+
+void UStateMachineSubsystem::RemoveSlot(int32 Slot)
+{
+	UpdateMachine(Slot, INDEX_NONE, false, EStateTickWork::None);
+
+	Machines.RemoveAtSwap(Slot, 1, false);
+	StateIndices.RemoveAtSwap(Slot, 1, false);
+	CanTickState.RemoveAtSwap(Slot, 1, false);
+	TimeInState.RemoveAtSwap(Slot, 1, false);
+	TickWork.RemoveAtSwap(Slot, 1, false);
+
+	if (Machines.IsValidIndex(Slot) && Machines[Slot])
+	{
+		Machines[Slot]->BatchSlot = Slot;
+	}
+}
@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StateMachineTraceSubsystem.h"
+#include "StateMachine.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+namespace StateMachineTrace
+{
+	static TAutoConsoleVariable<bool> CVarTrace(
+		TEXT("StateMachine.Trace"), false,
+		TEXT("Record the state transitions of every state machine to a binary trace file. Read when a world starts."));
+
+	static TAutoConsoleVariable<int32> CVarFlushThreshold(
+		TEXT("StateMachine.Trace.FlushThreshold"), 16384,
+		TEXT("Number of buffered transitions after which the trace is flushed to disk."));
+
+	static FAutoConsoleCommandWithWorld FlushCommand(
+		TEXT("StateMachine.Trace.Flush"),
+		TEXT("Writes the buffered state transitions of the current world to its trace file."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			UStateMachineTraceSubsystem* Subsystem = World ? World->GetSubsystem<UStateMachineTraceSubsystem>() : nullptr;
+			if (Subsystem && Subsystem->IsRecording())
+			{
+				Subsystem->Flush();
+				UE_LOG(LogStateMachine, Display, TEXT("Flushed state transitions to %s"), *Subsystem->GetTraceFilename());
+			}
+		}));
+
+	static std::atomic<uint32> NextTraceId{1};
+
+	/** The buffer the current thread recorded to last, valid while TraceId matches. */
+	struct FThreadBufferCache
+	{
+		uint32 TraceId = 0;
+		void* Buffer = nullptr;
+	};
+	static thread_local FThreadBufferCache ThreadBufferCache;
+}
+
+void UStateMachineTraceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (!StateMachineTrace::CVarTrace.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	TraceId = StateMachineTrace::NextTraceId.fetch_add(1);
+	TraceFilename = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("StateMachine")
+		/ FString::Printf(TEXT("%s-%s.smtrace"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+	UE_LOG(LogStateMachine, Display, TEXT("Recording state transitions to %s"), *TraceFilename);
+}
+
+void UStateMachineTraceSubsystem::Deinitialize()
+{
+	if (IsRecording())
+	{
+		Flush();
+		UE_LOG(LogStateMachine, Display, TEXT("Wrote %d state transitions to %s"), NumRecordsWritten, *TraceFilename);
+		TraceId = 0;
+		ThreadBuffers.Empty();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UStateMachineTraceSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UStateMachineTraceSubsystem::Tick(float DeltaTime)
+{
+	int32 NumBuffered = 0;
+	for (const TUniquePtr<FThreadBuffer>& Buffer : ThreadBuffers)
+	{
+		NumBuffered += Buffer->Records.Num();
+	}
+	if (NumBuffered >= StateMachineTrace::CVarFlushThreshold.GetValueOnGameThread())
+	{
+		Flush();
+	}
+}
+
+bool UStateMachineTraceSubsystem::IsTickable() const
+{
+	return IsRecording();
+}
+
+TStatId UStateMachineTraceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStateMachineTraceSubsystem, STATGROUP_StateMachine);
+}
+
+UStateMachineTraceSubsystem::FThreadBuffer& UStateMachineTraceSubsystem::GetThreadBuffer()
+{
+	StateMachineTrace::FThreadBufferCache& Cache = StateMachineTrace::ThreadBufferCache;
+	if (Cache.TraceId == TraceId)
+	{
+		return *static_cast<FThreadBuffer*>(Cache.Buffer);
+	}
+
+	// Slow path, taken once per thread unless several worlds record at the same time
+	const uint32 ThreadId = FPlatformTLS::GetCurrentThreadId();
+	FScopeLock Lock(&ThreadBuffersLock);
+	FThreadBuffer* Buffer = nullptr;
+	for (const TUniquePtr<FThreadBuffer>& Existing : ThreadBuffers)
+	{
+		if (Existing->ThreadId == ThreadId)
+		{
+			Buffer = Existing.Get();
+			break;
+		}
+	}
+	if (!Buffer)
+	{
+		Buffer = ThreadBuffers.Add_GetRef(MakeUnique<FThreadBuffer>()).Get();
+		Buffer->ThreadId = ThreadId;
+		Buffer->Records.Reserve(StateMachineTrace::CVarFlushThreshold.GetValueOnAnyThread());
+	}
+	Cache.TraceId = TraceId;
+	Cache.Buffer = Buffer;
+	return *Buffer;
+}
+
+void UStateMachineTraceSubsystem::RecordTransition(double Time, uint32 OwnerId, const FGameplayTag& FromTag, const FGameplayTag& ToTag)
+{
+	GetThreadBuffer().Records.Add({ Time, OwnerId, FromTag, ToTag });
+}
+
+void UStateMachineTraceSubsystem::Flush()
+{
+	TMap<FGameplayTag, uint16> TagIndices;
+	TArray<FString> Tags;
+	int32 NumRecords = 0;
+	auto GetTagIndex = [&TagIndices, &Tags](const FGameplayTag& Tag)
+	{
+		if (const uint16* Index = TagIndices.Find(Tag))
+		{
+			return *Index;
+		}
+		check(Tags.Num() <= MAX_uint16);
+		const uint16 Index = static_cast<uint16>(Tags.Add(Tag.ToString()));
+		TagIndices.Add(Tag, Index);
+		return Index;
+	};
+	for (const TUniquePtr<FThreadBuffer>& Buffer : ThreadBuffers)
+	{
+		for (const FStateTransitionTraceRecord& Record : Buffer->Records)
+		{
+			GetTagIndex(Record.FromTag);
+			GetTagIndex(Record.ToTag);
+		}
+		NumRecords += Buffer->Records.Num();
+	}
+	if (NumRecords == 0)
+	{
+		return;
+	}
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TraceFilename, bWroteHeader ? FILEWRITE_Append : FILEWRITE_None));
+	if (!Writer)
+	{
+		UE_LOG(LogStateMachine, Error, TEXT("Could not open %s, dropping %d state transitions"), *TraceFilename, NumRecords);
+	}
+	else
+	{
+		if (!bWroteHeader)
+		{
+			uint32 Magic = StateMachineTraceFile::Magic;
+			uint32 Version = StateMachineTraceFile::Version;
+			*Writer << Magic << Version;
+			bWroteHeader = true;
+		}
+
+		int32 NumTags = Tags.Num();
+		*Writer << NumTags;
+		for (FString& Tag : Tags)
+		{
+			*Writer << Tag;
+		}
+
+		*Writer << NumRecords;
+		for (const TUniquePtr<FThreadBuffer>& Buffer : ThreadBuffers)
+		{
+			for (const FStateTransitionTraceRecord& Record : Buffer->Records)
+			{
+				double Time = Record.Time;
+				uint32 OwnerId = Record.OwnerId;
+				uint16 FromTag = TagIndices[Record.FromTag];
+				uint16 ToTag = TagIndices[Record.ToTag];
+				*Writer << Time << OwnerId << FromTag << ToTag;
+			}
+		}
+		NumRecordsWritten += NumRecords;
+	}
+
+	for (const TUniquePtr<FThreadBuffer>& Buffer : ThreadBuffers)
+	{
+		// Keep the allocation, the next transitions go into the same memory
+		Buffer->Records.Reset();
+	}
+}
+
+bool StateMachineTraceFile::Load(const FString& Filename, FContents& OutContents)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Reader)
+	{
+		UE_LOG(LogStateMachine, Error, TEXT("Could not open %s"), *Filename);
+		return false;
+	}
+
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	*Reader << FileMagic << FileVersion;
+	if (FileMagic != Magic || FileVersion != Version)
+	{
+		UE_LOG(LogStateMachine, Error, TEXT("%s is not a state machine trace of version %u"), *Filename, Version);
+		return false;
+	}
+
+	TMap<FName, int32> TagIndices;
+	TArray<int32> BlockTags;
+	while (!Reader->AtEnd() && !Reader->IsError())
+	{
+		int32 NumTags = 0;
+		*Reader << NumTags;
+		BlockTags.Reset(NumTags);
+		for (int32 Index = 0; Index < NumTags && !Reader->IsError(); ++Index)
+		{
+			FString Tag;
+			*Reader << Tag;
+			const FName TagName(*Tag);
+			const int32* TagIndex = TagIndices.Find(TagName);
+			BlockTags.Add(TagIndex ? *TagIndex : TagIndices.Add(TagName, OutContents.Tags.Add(TagName)));
+		}
+
+		int32 NumRecords = 0;
+		*Reader << NumRecords;
+		OutContents.Records.Reserve(OutContents.Records.Num() + NumRecords);
+		for (int32 Index = 0; Index < NumRecords && !Reader->IsError(); ++Index)
+		{
+			FContents::FRecord Record;
+			uint16 FromTag = 0;
+			uint16 ToTag = 0;
+			*Reader << Record.Time << Record.OwnerId << FromTag << ToTag;
+			if (!BlockTags.IsValidIndex(FromTag) || !BlockTags.IsValidIndex(ToTag))
+			{
+				Reader->SetError();
+				break;
+			}
+			Record.FromTag = BlockTags[FromTag];
+			Record.ToTag = BlockTags[ToTag];
+			OutContents.Records.Add(Record);
+		}
+	}
+
+	if (Reader->IsError())
+	{
+		UE_LOG(LogStateMachine, Error, TEXT("%s is truncated or corrupt"), *Filename);
+		return false;
+	}
+	return true;
+}
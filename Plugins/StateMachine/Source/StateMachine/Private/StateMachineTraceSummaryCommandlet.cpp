@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StateMachineTraceSummaryCommandlet.h"
+#include "StateMachine.h"
+#include "StateMachineTraceSubsystem.h"
+#include "Misc/FileHelper.h"
+
+namespace StateMachineTraceSummary
+{
+	struct FTransitionStats
+	{
+		int32 FromTag;
+		int32 ToTag;
+		int32 Count = 0;
+	};
+
+	struct FStateStats
+	{
+		int32 Tag;
+		int32 Count = 0;
+		double TotalSeconds = 0.0;
+		double MaxSeconds = 0.0;
+	};
+}
+
+UStateMachineTraceSummaryCommandlet::UStateMachineTraceSummaryCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UStateMachineTraceSummaryCommandlet::Main(const FString& Params)
+{
+	using namespace StateMachineTraceSummary;
+
+	FString TracePath;
+	if (!FParse::Value(*Params, TEXT("Trace="), TracePath))
+	{
+		UE_LOG(LogStateMachine, Error, TEXT("Usage: -run=StateMachineTraceSummary -Trace=<smtrace path> [-Top=20] [-Output=<csv path>]"));
+		return 1;
+	}
+
+	int32 Top = 20;
+	FParse::Value(*Params, TEXT("Top="), Top);
+
+	StateMachineTraceFile::FContents Trace;
+	if (!StateMachineTraceFile::Load(TracePath, Trace))
+	{
+		return 1;
+	}
+	if (Trace.Records.Num() == 0)
+	{
+		UE_LOG(LogStateMachine, Display, TEXT("%s has no transitions"), *TracePath);
+		return 0;
+	}
+
+	TMap<TPair<int32, int32>, FTransitionStats> Transitions;
+	TArray<FStateStats> States;
+	for (int32 Tag = 0; Tag < Trace.Tags.Num(); ++Tag)
+	{
+		States.Add({ Tag });
+	}
+
+	// Threads flush in blocks, so only the records of a single owner sorted by time are a timeline
+	TMap<uint32, TArray<int32>> OwnerRecords;
+	double FirstTime = TNumericLimits<double>::Max();
+	double LastTime = TNumericLimits<double>::Lowest();
+	for (int32 Index = 0; Index < Trace.Records.Num(); ++Index)
+	{
+		const StateMachineTraceFile::FContents::FRecord& Record = Trace.Records[Index];
+		FTransitionStats& Transition = Transitions.FindOrAdd(MakeTuple(Record.FromTag, Record.ToTag), FTransitionStats{ Record.FromTag, Record.ToTag });
+		++Transition.Count;
+		OwnerRecords.FindOrAdd(Record.OwnerId).Add(Index);
+		FirstTime = FMath::Min(FirstTime, Record.Time);
+		LastTime = FMath::Max(LastTime, Record.Time);
+	}
+
+	for (TPair<uint32, TArray<int32>>& Owner : OwnerRecords)
+	{
+		Owner.Value.StableSort([&Trace](int32 A, int32 B) { return Trace.Records[A].Time < Trace.Records[B].Time; });
+		// The state entered by the last transition is still open when the trace ends, so it is not counted
+		for (int32 Index = 0; Index + 1 < Owner.Value.Num(); ++Index)
+		{
+			const StateMachineTraceFile::FContents::FRecord& Entered = Trace.Records[Owner.Value[Index]];
+			const double Seconds = Trace.Records[Owner.Value[Index + 1]].Time - Entered.Time;
+			FStateStats& State = States[Entered.ToTag];
+			++State.Count;
+			State.TotalSeconds += Seconds;
+			State.MaxSeconds = FMath::Max(State.MaxSeconds, Seconds);
+		}
+	}
+
+	TArray<FTransitionStats> SortedTransitions;
+	Transitions.GenerateValueArray(SortedTransitions);
+	SortedTransitions.Sort([](const FTransitionStats& A, const FTransitionStats& B) { return A.Count > B.Count; });
+	States.Sort([](const FStateStats& A, const FStateStats& B) { return A.TotalSeconds > B.TotalSeconds; });
+
+	const double Duration = FMath::Max(LastTime - FirstTime, static_cast<double>(SMALL_NUMBER));
+	UE_LOG(LogStateMachine, Display, TEXT("%s: %d transitions of %d machines over %.1fs (%.1f per second)"),
+		*TracePath, Trace.Records.Num(), OwnerRecords.Num(), Duration, Trace.Records.Num() / Duration);
+
+	UE_LOG(LogStateMachine, Display, TEXT("Most frequent transitions:"));
+	for (int32 Index = 0; Index < FMath::Min(Top, SortedTransitions.Num()); ++Index)
+	{
+		const FTransitionStats& Transition = SortedTransitions[Index];
+		UE_LOG(LogStateMachine, Display, TEXT("  %8d  %6.2f/s  %s -> %s"), Transition.Count, Transition.Count / Duration,
+			*Trace.Tags[Transition.FromTag].ToString(), *Trace.Tags[Transition.ToTag].ToString());
+	}
+
+	UE_LOG(LogStateMachine, Display, TEXT("Time in state (total, mean, max seconds):"));
+	for (const FStateStats& State : States)
+	{
+		if (State.Count > 0)
+		{
+			UE_LOG(LogStateMachine, Display, TEXT("  %10.2f  %8.3f  %8.3f  %s"), State.TotalSeconds, State.TotalSeconds / State.Count,
+				State.MaxSeconds, *Trace.Tags[State.Tag].ToString());
+		}
+	}
+
+	FString OutputPath;
+	if (FParse::Value(*Params, TEXT("Output="), OutputPath))
+	{
+		FString Csv = TEXT("Kind,From,To,Count,TotalSeconds,MeanSeconds,MaxSeconds\n");
+		for (const FTransitionStats& Transition : SortedTransitions)
+		{
+			Csv += FString::Printf(TEXT("Transition,%s,%s,%d,,,\n"),
+				*Trace.Tags[Transition.FromTag].ToString(), *Trace.Tags[Transition.ToTag].ToString(), Transition.Count);
+		}
+		for (const FStateStats& State : States)
+		{
+			if (State.Count > 0)
+			{
+				Csv += FString::Printf(TEXT("State,%s,,%d,%.6f,%.6f,%.6f\n"), *Trace.Tags[State.Tag].ToString(), State.Count,
+					State.TotalSeconds, State.TotalSeconds / State.Count, State.MaxSeconds);
+			}
+		}
+		if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+		{
+			UE_LOG(LogStateMachine, Error, TEXT("Failed to write %s"), *OutputPath);
+			return 1;
+		}
+		UE_LOG(LogStateMachine, Display, TEXT("Wrote %s"), *OutputPath);
+	}
+
+	return 0;
+}
@@ -4,6 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogStateMachine, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("StateMachine"), STATGROUP_StateMachine, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("StateMachine TickComponent"), STAT_StateMachine_TickComponent, STATGROUP_StateMachine, STATEMACHINE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("StateMachine SwitchState"), STAT_StateMachine_SwitchState, STATGROUP_StateMachine, STATEMACHINE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("StateMachine Batch Tick"), STAT_StateMachine_BatchTick, STATGROUP_StateMachine, STATEMACHINE_API);
 
 class FStateMachineModule : public IModuleInterface
 {
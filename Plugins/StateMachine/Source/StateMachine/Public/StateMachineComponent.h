@@ -8,11 +8,38 @@
 #include "GameplayTags.h"
 #include "StateMachineComponent.generated.h"
 
+class UStateMachineSubsystem;
+class UStateMachineTraceSubsystem;
+enum class EStateTickWork : uint8;
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FStateChangedSignature, const FGameplayTag&, NewStateTag);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FInitStateSignature, const FGameplayTag&, StateTag);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FEndStateSignature, const FGameplayTag&, StateTag);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FTickStateSignature, float, DeltaTime, const FGameplayTag&, StateTag);
 
+DECLARE_DELEGATE_OneParam(FNativeTickStateSignature, float /*DeltaTime*/);
+
+/** Native callbacks for a single state. They are dispatched by state index, without reflection or tag compares. */
+struct FStateHandlers
+{
+	FSimpleDelegate Init;
+	FNativeTickStateSignature Tick;
+	FSimpleDelegate End;
+	/** The tick handler only touches its own owner and may run on a worker thread when the machine is batched. */
+	bool bTickIsThreadSafe = false;
+};
+
+/**
+ * Everything a state machine needs to carry on from a point in time, for rollback.
+ * Trivially copyable, the state is kept by index into the machine's own state table.
+ */
+struct FStateMachineSnapshot
+{
+	int32 StateIndex = INDEX_NONE;
+	float TimeInState = 0.f;
+	bool bCanTickState = false;
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent), Blueprintable, BlueprintType )
 class STATEMACHINE_API UStateMachineComponent : public UActorComponent
 {
@@ -42,17 +69,77 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere)
 	bool bDebug = false;
 
+	/** Number of previous states remembered. The history is allocated once at BeginPlay. */
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+	int32 StateHistoryLength = 5;
+
+	/** States resolved to dense indices at BeginPlay. States registered or switched to later are appended. */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+	TArray<FGameplayTag> States;
+
+	/** Copy of the history ring, oldest first, kept filled for existing Blueprints. Native code reads the ring directly. */
+	UPROPERTY(BlueprintReadOnly, meta = (DeprecatedProperty, DeprecationMessage = "Use GetStateHistory instead."))
 	TArray<FGameplayTag> StateHistory;
 
+	/**
+	 * TickStateDelegate is broadcast while it is bound, and a batched machine with no bound delegate and no native
+	 * tick handler skips its state's tick entirely. Listeners bound later at runtime are picked up on the next batched
+	 * tick. Turn this on to keep the game thread tick even while nothing is bound. Takes effect on the next state switch.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bBroadcastTickDelegate = false;
+
+	/** Tick from the world's UStateMachineSubsystem instead of a tick function of its own. */
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
-	int32 StateHistoryLength = 5;
+	bool bBatchTick = true;
 
+	/** @return false for an invalid tag or the current state */
 	UFUNCTION(BlueprintCallable)
 	bool SwitchState(FGameplayTag Tag);
+
+	/** Switches to a state by the index returned from RegisterStateHandlers or GetStateIndex. */
+	bool SwitchStateByIndex(int32 StateIndex);
+
+	/**
+	 * Registers the native handlers for a state, replacing any previous ones.
+	 * @return the dense index of the state, INDEX_NONE for an invalid tag
+	 */
+	int32 RegisterStateHandlers(FGameplayTag Tag, FStateHandlers Handlers);
+
+	/** @return the dense index of a state, or INDEX_NONE if it was never declared, registered or entered */
+	int32 GetStateIndex(FGameplayTag Tag) const;
+
+	int32 GetCurrentStateIndex() const { return CurrentStateIndex; }
+
+	UFUNCTION(BlueprintPure)
+	float GetTimeInState() const;
+
+	/** @return the previous states, oldest first */
+	UFUNCTION(BlueprintPure)
+	TArray<FGameplayTag> GetStateHistory() const;
+
+	int32 GetStateHistoryNum() const { return StateHistoryNum; }
+	/** @return a previous state, 0 being the oldest one still remembered */
+	const FGameplayTag& GetStateHistoryEntry(int32 Index) const;
+
+	bool IsBatched() const { return BatchSubsystem != nullptr; }
+
+	/**
+	 * Advances the machine by DeltaTime, for owners that step it with their own simulation.
+	 * Such owners turn bBatchTick and the component tick off, so the machine isn't ticked twice.
+	 */
+	void Step(float DeltaTime);
+
+	void SaveState(FStateMachineSnapshot& OutSnapshot) const;
+	/**
+	 * Puts the machine back into a saved state without running any init, end or changed handlers,
+	 * the state is not added to the history nor recorded to the trace.
+	 */
+	void RestoreState(const FStateMachineSnapshot& Snapshot);
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 
 public:	
@@ -60,9 +147,51 @@ public:
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
 private:
+	friend class UStateMachineSubsystem;
+
 	bool bCanTickState = false;
 	void InitState();
 	void TickState(float deltaTime);
 	void EndState();
+
+	/** Ticks the current state and the debug output, shared by the component tick and the batched tick. */
+	void TickStateMachine(float DeltaTime);
+	/** Runs only the native tick handler of a state, used for thread safe handlers. */
+	void TickNativeState(int32 StateIndex, float DeltaTime);
+	EStateTickWork GetTickWork() const;
+	/** Pushes the current state to the batch subsystem, if the machine is batched. */
+	void UpdateBatch();
+
+	/** Finds the index of a state, a valid tag seen for the first time is appended to the state table. */
+	int32 ResolveStateIndex(const FGameplayTag& Tag);
+
+	/** Handler table, indexed by state index. Ends after the last state with registered handlers. */
+	TArray<FStateHandlers> StateHandlers;
+	/** State tags, indexed by state index. */
+	TArray<FGameplayTag> StateTable;
+	TMap<FGameplayTag, int32> StateIndices;
+	int32 CurrentStateIndex = INDEX_NONE;
+
+	/** Ring buffer of previous states, StateHistoryHead is the slot written next. */
+	TArray<FGameplayTag> StateHistoryRing;
+	int32 StateHistoryHead = 0;
+	int32 StateHistoryNum = 0;
+
+	/** On-screen debug text, only rebuilt after a state switch. */
+	FString DebugStateText;
+	FString DebugHistoryText;
+	bool bDebugTextDirty = true;
+	void UpdateDebugText();
+
+	/** Time in the current state, only maintained here when the machine is not batched. */
+	float TimeInState = 0.f;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UStateMachineSubsystem> BatchSubsystem;
+	int32 BatchSlot = INDEX_NONE;
+
+	/** Set while the world records a transition trace. */
+	UPROPERTY(Transient)
+	TObjectPtr<UStateMachineTraceSubsystem> TraceSubsystem;
 		
 };
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StateMachineSubsystem.generated.h"
+
+class UStateMachineComponent;
+
+/** What a state machine has to do when it ticks in its current state. */
+enum class EStateTickWork : uint8
+{
+	/** Nothing, the machine is skipped */
+	None,
+	/** Only native tick handlers that are safe to run off the game thread */
+	ThreadSafe,
+	/** Blueprint delegates, debug output or native handlers that must run on the game thread */
+	GameThread
+};
+
+/**
+ * Ticks every batched UStateMachineComponent of a world in one loop instead of one tick function per component.
+ * The per-machine data the loop needs is kept in parallel arrays indexed by the component's batch slot.
+ */
+UCLASS()
+class STATEMACHINE_API UStateMachineSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Ticks all registered machines. Called from Tick unless automatic ticking is turned off. */
+	void TickMachines(float DeltaTime);
+
+	/** Turns the automatic tick off, for callers that drive TickMachines themselves. */
+	void SetAutoTick(bool bInAutoTick) { bAutoTick = bInAutoTick; }
+
+	int32 RegisterMachine(UStateMachineComponent* Machine);
+	void UnregisterMachine(UStateMachineComponent* Machine);
+
+	/** Updates the cached state of a machine after it switched state or changed what its state has to tick. */
+	void UpdateMachine(int32 Slot, int32 StateIndex, bool bCanTickState, EStateTickWork TickWork);
+	void ResetTimeInState(int32 Slot) { TimeInState[Slot] = 0.f; }
+	void SetTimeInState(int32 Slot, float InTimeInState) { TimeInState[Slot] = InTimeInState; }
+	float GetTimeInState(int32 Slot) const { return TimeInState[Slot]; }
+
+	int32 GetNumMachines() const { return Machines.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	void RemoveSlot(int32 Slot);
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UStateMachineComponent>> Machines;
+
+	TArray<int32> StateIndices;
+	TArray<bool> CanTickState;
+	TArray<float> TimeInState;
+	TArray<EStateTickWork> TickWork;
+
+	int32 NumThreadSafeMachines = 0;
+
+	/** Slots unregistered while ticking, removed once the loop is done. */
+	TArray<int32> PendingRemovals;
+	bool bIsTicking = false;
+	bool bAutoTick = true;
+};
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "StateMachineTraceSubsystem.generated.h"
+
+/** One state transition as it is recorded in memory. */
+struct FStateTransitionTraceRecord
+{
+	/** World time of the transition in seconds. */
+	double Time = 0.0;
+	/** UniqueID of the machine's owner. */
+	uint32 OwnerId = 0;
+	FGameplayTag FromTag;
+	FGameplayTag ToTag;
+};
+
+/**
+ * Binary state transition trace file.
+ *
+ * Header: uint32 Magic, uint32 Version.
+ * Followed by one block per flush until the end of the file:
+ *     int32 NumTags, FString Tags[NumTags]
+ *     int32 NumRecords, { double Time, uint32 OwnerId, uint16 FromTag, uint16 ToTag }[NumRecords]
+ * Tag indices refer to the tag table of their own block.
+ */
+namespace StateMachineTraceFile
+{
+	constexpr uint32 Magic = 0x52544D53; // 'SMTR'
+	constexpr uint32 Version = 1;
+
+	/** A trace file with the tag tables of all blocks merged, records are in file order. */
+	struct FContents
+	{
+		TArray<FName> Tags;
+		struct FRecord
+		{
+			double Time;
+			uint32 OwnerId;
+			int32 FromTag;
+			int32 ToTag;
+		};
+		TArray<FRecord> Records;
+	};
+
+	STATEMACHINE_API bool Load(const FString& Filename, FContents& OutContents);
+}
+
+/**
+ * Records every state transition of the world's UStateMachineComponents while StateMachine.Trace is set at world start.
+ *
+ * Recording is lock free: each thread appends to a buffer of its own, found through a thread local cache.
+ * The buffers are flushed to Saved/Profiling/StateMachine on the game thread, when they grow past
+ * StateMachine.Trace.FlushThreshold records, on StateMachine.Trace.Flush and when the world is torn down.
+ */
+UCLASS()
+class STATEMACHINE_API UStateMachineTraceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	bool IsRecording() const { return TraceId != 0; }
+
+	/** Appends a transition to the calling thread's buffer. */
+	void RecordTransition(double Time, uint32 OwnerId, const FGameplayTag& FromTag, const FGameplayTag& ToTag);
+
+	/** Writes all buffered transitions to the trace file. Must not run while other threads are recording. */
+	void Flush();
+
+	const FString& GetTraceFilename() const { return TraceFilename; }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FThreadBuffer
+	{
+		uint32 ThreadId = 0;
+		TArray<FStateTransitionTraceRecord> Records;
+	};
+
+	FThreadBuffer& GetThreadBuffer();
+
+	/** Unique per recording subsystem, so a thread's cached buffer is never mistaken for one of a later world. 0 when not recording. */
+	uint32 TraceId = 0;
+
+	/** Every thread buffer created so far, only locked when a thread records its first transition. */
+	TArray<TUniquePtr<FThreadBuffer>> ThreadBuffers;
+	FCriticalSection ThreadBuffersLock;
+
+	FString TraceFilename;
+	bool bWroteHeader = false;
+	int32 NumRecordsWritten = 0;
+};
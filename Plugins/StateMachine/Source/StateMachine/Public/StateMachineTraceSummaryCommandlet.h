@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "StateMachineTraceSummaryCommandlet.generated.h"
+
+/**
+ * Summarizes a state transition trace written by UStateMachineTraceSubsystem:
+ * how often each transition happened and how long machines stayed in each state.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=StateMachineTraceSummary -Trace=<smtrace path> [-Top=20] [-Output=<csv path>]
+ */
+UCLASS()
+class STATEMACHINE_API UStateMachineTraceSummaryCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UStateMachineTraceSummaryCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PActorPoolSubsystem.h"
+#include "Platformer2D.h"
+#include "HAL/IConsoleManager.h"
+
+namespace PActorPool
+{
+	static FAutoConsoleCommandWithWorld ReportCommand(
+		TEXT("p2d.ActorPool.Report"),
+		TEXT("Logs the hits, misses and size of every actor pool of the world."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const UPActorPoolSubsystem* ActorPool = World ? World->GetSubsystem<UPActorPoolSubsystem>() : nullptr)
+			{
+				ActorPool->LogReport();
+			}
+		}));
+}
+
+FString FPActorPoolStats::ToString() const
+{
+	const int32 NumAcquires = NumHits + NumMisses + NumRecycled + NumRefused;
+	return FString::Printf(TEXT("%d active, %d free, %d hits, %d misses, %d recycled, %d refused (%.1f%% hit rate)"),
+		NumActive, NumFree, NumHits, NumMisses, NumRecycled, NumRefused, NumAcquires > 0 ? 100.0 * NumHits / NumAcquires : 0.0);
+}
+
+void IPPooledActor::OnAcquiredFromPool_Implementation()
+{
+}
+
+void IPPooledActor::OnReturnedToPool_Implementation()
+{
+}
+
+void UPActorPoolSubsystem::FPool::RemoveStale()
+{
+	Active.RemoveAll([](const TWeakObjectPtr<AActor>& Actor) { return !Actor.IsValid(); });
+	Free.RemoveAllSwap([](const TWeakObjectPtr<AActor>& Actor) { return !Actor.IsValid(); });
+	Stats.NumActive = Active.Num();
+	Stats.NumFree = Free.Num();
+}
+
+void UPActorPoolSubsystem::Deinitialize()
+{
+	for (const TPair<const UClass*, FPool>& Pair : Pools)
+	{
+		DEC_DWORD_STAT_BY(STAT_ActorPool_Active, Pair.Value.Active.Num());
+	}
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UPActorPoolSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPActorPoolSubsystem::Prewarm(TSubclassOf<AActor> Class, int32 Count, int32 MaxSize)
+{
+	if (!Class)
+	{
+		return;
+	}
+
+	// Several users of a class share its pool, it gets the largest cap any of them asked for
+	FPool* ExistingPool = Pools.Find(Class.Get());
+	FPool& Pool = ExistingPool ? *ExistingPool : Pools.Add(Class.Get());
+	Pool.RemoveStale();
+	Pool.MaxSize = ExistingPool ? FMath::Max(Pool.MaxSize, MaxSize) : FMath::Max(MaxSize, 1);
+	Count = FMath::Min(Count, Pool.MaxSize);
+	while (Pool.Num() < Count)
+	{
+		AActor* Actor = SpawnPooledActor(Class);
+		if (!Actor)
+		{
+			break;
+		}
+		Pool.Free.Add(Actor);
+	}
+	Pool.Stats.NumFree = Pool.Free.Num();
+}
+
+void UPActorPoolSubsystem::Reserve(TSubclassOf<AActor> Class, int32 Count)
+{
+	if (!Class || Count <= 0)
+	{
+		return;
+	}
+
+	// Unlike Prewarm the caps add up, every user gets its own share
+	FPool* ExistingPool = Pools.Find(Class.Get());
+	FPool& Pool = ExistingPool ? *ExistingPool : Pools.Add(Class.Get());
+	Pool.RemoveStale();
+	Pool.MaxSize = ExistingPool ? Pool.MaxSize + Count : Count;
+	const int32 TargetNum = FMath::Min(Pool.Num() + Count, Pool.MaxSize);
+	while (Pool.Num() < TargetNum)
+	{
+		AActor* Actor = SpawnPooledActor(Class);
+		if (!Actor)
+		{
+			break;
+		}
+		Pool.Free.Add(Actor);
+	}
+	Pool.Stats.NumFree = Pool.Free.Num();
+}
+
+void UPActorPoolSubsystem::Unreserve(TSubclassOf<AActor> Class, int32 Count)
+{
+	FPool* Pool = Class ? Pools.Find(Class.Get()) : nullptr;
+	if (!Pool || Count <= 0)
+	{
+		return;
+	}
+
+	Pool->RemoveStale();
+	Pool->MaxSize = FMath::Max(Pool->MaxSize - Count, 1);
+	while (Pool->Num() > Pool->MaxSize && Pool->Free.Num() > 0)
+	{
+		Pool->Free.Pop(false)->Destroy();
+	}
+	Pool->Stats.NumFree = Pool->Free.Num();
+}
+
+AActor* UPActorPoolSubsystem::Acquire(TSubclassOf<AActor> Class, const FTransform& Transform, bool bAllowRecycle)
+{
+	if (!Class)
+	{
+		return nullptr;
+	}
+
+	FPool& Pool = Pools.FindOrAdd(Class.Get());
+	AActor* Actor = nullptr;
+	while (!Actor && Pool.Free.Num() > 0)
+	{
+		Actor = Pool.Free.Pop(false).Get();
+	}
+
+	if (Actor)
+	{
+		++Pool.Stats.NumHits;
+		INC_DWORD_STAT(STAT_ActorPool_Hits);
+	}
+	else
+	{
+		Pool.RemoveStale();
+		if (Pool.Num() < Pool.MaxSize)
+		{
+			Actor = SpawnPooledActor(Class);
+			if (!Actor)
+			{
+				return nullptr;
+			}
+			++Pool.Stats.NumMisses;
+			INC_DWORD_STAT(STAT_ActorPool_Misses);
+		}
+		else if (!bAllowRecycle)
+		{
+			++Pool.Stats.NumRefused;
+			return nullptr;
+		}
+		else
+		{
+			// At the cap, the oldest actor in use is the least likely to still be needed
+			Actor = Pool.Active[0].Get();
+			Pool.Active.RemoveAt(0, 1, false);
+			Deactivate(Actor);
+			DEC_DWORD_STAT(STAT_ActorPool_Active);
+			++Pool.Stats.NumRecycled;
+		}
+	}
+
+	Pool.Active.Add(Actor);
+	Pool.Stats.NumActive = Pool.Active.Num();
+	Pool.Stats.NumFree = Pool.Free.Num();
+	INC_DWORD_STAT(STAT_ActorPool_Active);
+
+	Activate(Actor, Transform);
+	return Actor;
+}
+
+void UPActorPoolSubsystem::Release(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+
+	FPool* Pool = Pools.Find(Actor->GetClass());
+	if (!Pool || Pool->Active.RemoveSingle(Actor) == 0)
+	{
+		// Already free, or never pooled
+		if (!Pool || !Pool->Free.Contains(Actor))
+		{
+			Actor->Destroy();
+		}
+		return;
+	}
+
+	Deactivate(Actor);
+	Pool->Free.Add(Actor);
+	Pool->Stats.NumActive = Pool->Active.Num();
+	Pool->Stats.NumFree = Pool->Free.Num();
+	DEC_DWORD_STAT(STAT_ActorPool_Active);
+}
+
+FPActorPoolStats UPActorPoolSubsystem::GetStats(TSubclassOf<AActor> Class) const
+{
+	const FPool* Pool = Pools.Find(Class.Get());
+	return Pool ? Pool->Stats : FPActorPoolStats();
+}
+
+void UPActorPoolSubsystem::LogReport() const
+{
+	for (const TPair<const UClass*, FPool>& Pair : Pools)
+	{
+		UE_LOG(LogPlatformer2D, Display, TEXT("%s: %s, cap %d"), *Pair.Key->GetName(), *Pair.Value.Stats.ToString(), Pair.Value.MaxSize);
+	}
+}
+
+AActor* UPActorPoolSubsystem::SpawnPooledActor(UClass* Class)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	AActor* Actor = GetWorld()->SpawnActor<AActor>(Class, FTransform::Identity, SpawnParams);
+	if (!Actor)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("Could not spawn a pooled %s"), *Class->GetName());
+		return nullptr;
+	}
+
+	Deactivate(Actor);
+	return Actor;
+}
+
+void UPActorPoolSubsystem::Activate(AActor* Actor, const FTransform& Transform)
+{
+	Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	Actor->SetActorHiddenInGame(false);
+	Actor->SetActorEnableCollision(true);
+	Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+	if (Actor->Implements<UPPooledActor>())
+	{
+		IPPooledActor::Execute_OnAcquiredFromPool(Actor);
+	}
+}
+
+void UPActorPoolSubsystem::Deactivate(AActor* Actor)
+{
+	if (Actor->Implements<UPPooledActor>())
+	{
+		IPPooledActor::Execute_OnReturnedToPool(Actor);
+	}
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+}
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/Interface.h"
+#include "PActorPoolSubsystem.generated.h"
+
+UINTERFACE(MinimalAPI, Blueprintable)
+class UPPooledActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/** Reset hooks of an actor kept in a UPActorPoolSubsystem, optional for pooled actors. */
+class PLATFORMER2D_API IPPooledActor
+{
+	GENERATED_BODY()
+
+public:
+	/** The actor was handed out, it is already shown and at its new transform. */
+	UFUNCTION(BlueprintNativeEvent, Category = Pool)
+	void OnAcquiredFromPool();
+
+	/** The actor went back to the pool, it is hidden afterwards. Timers, effects and the like should stop here. */
+	UFUNCTION(BlueprintNativeEvent, Category = Pool)
+	void OnReturnedToPool();
+};
+
+USTRUCT(BlueprintType)
+struct PLATFORMER2D_API FPActorPoolStats
+{
+	GENERATED_BODY()
+
+	/** Acquires served by a free actor. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 NumHits = 0;
+
+	/** Acquires that had to spawn an actor. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 NumMisses = 0;
+
+	/** Acquires at the cap, served by taking back the oldest actor in use. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 NumRecycled = 0;
+
+	/** Acquires at the cap that were not allowed to recycle and got nothing. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 NumRefused = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 NumActive = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 NumFree = 0;
+
+	FString ToString() const;
+};
+
+/**
+ * Per-world pools of actors, one per class, so short lived actors like effects are not spawned and destroyed each time.
+ *
+ * Pools are pre-warmed with Prewarm and grow on demand up to their cap, after which the oldest actor in use is taken back.
+ * Users that hold on to their actors instead Reserve their share of the cap and acquire without recycling, so they never take each other's actors.
+ * Free actors are hidden with collision and tick off, actors implementing IPPooledActor are told when they are handed out
+ * and returned. p2d.ActorPool.Report logs the hits and misses of every pool.
+ */
+UCLASS()
+class PLATFORMER2D_API UPActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr int32 DefaultMaxSize = 16;
+
+	virtual void Deinitialize() override;
+
+	/** Spawns actors until the pool of Class has Count of them, and sets its cap. */
+	void Prewarm(TSubclassOf<AActor> Class, int32 Count, int32 MaxSize = DefaultMaxSize);
+
+	/**
+	 * Adds Count to the cap of the pool of Class and spawns Count actors for it, for a user that needs that many actors
+	 * of its own next to every other user of the pool. Undone with Unreserve.
+	 */
+	void Reserve(TSubclassOf<AActor> Class, int32 Count);
+	/** Takes Count back off the cap, free actors over the new cap are destroyed. */
+	void Unreserve(TSubclassOf<AActor> Class, int32 Count);
+
+	/**
+	 * Hands out an actor of Class at Transform. At the cap the oldest actor in use is taken back,
+	 * unless bAllowRecycle is false, e.g. because the actors in use belong to users that still need them.
+	 * @return null if the actor could not be spawned, or the pool is at its cap and may not recycle
+	 */
+	AActor* Acquire(TSubclassOf<AActor> Class, const FTransform& Transform, bool bAllowRecycle = true);
+
+	template <typename ActorType>
+	ActorType* Acquire(TSubclassOf<ActorType> Class, const FTransform& Transform, bool bAllowRecycle = true)
+	{
+		return CastChecked<ActorType>(Acquire(TSubclassOf<AActor>(Class), Transform, bAllowRecycle), ECastCheckedType::NullAllowed);
+	}
+
+	/** Returns an actor to its pool. Actors that did not come from a pool are destroyed. */
+	void Release(AActor* Actor);
+
+	FPActorPoolStats GetStats(TSubclassOf<AActor> Class) const;
+
+	void LogReport() const;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FPool
+	{
+		/** In the order they were acquired, the oldest is recycled at the cap. */
+		TArray<TWeakObjectPtr<AActor>> Active;
+		TArray<TWeakObjectPtr<AActor>> Free;
+		int32 MaxSize = DefaultMaxSize;
+		FPActorPoolStats Stats;
+
+		int32 Num() const { return Active.Num() + Free.Num(); }
+		/** Forgets actors destroyed behind the pool's back, e.g. with their level. */
+		void RemoveStale();
+	};
+
+	AActor* SpawnPooledActor(UClass* Class);
+	void Activate(AActor* Actor, const FTransform& Transform);
+	void Deactivate(AActor* Actor);
+
+	/** The pooled actors are owned by their level, the pools only hold weak pointers to them. */
+	TMap<const UClass*, FPool> Pools;
+};
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PAfterimageTrailComponent.h"
+
+#include "PaperFlipbook.h"
+#include "PaperFlipbookComponent.h"
+#include "PaperSprite.h"
+
+UPAfterimageTrailComponent::UPAfterimageTrailComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	// After the source's flipbook has advanced this frame
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	// Images are in world space and stay where they were taken, whatever the owner does
+	SetUsingAbsoluteLocation(true);
+	SetUsingAbsoluteRotation(true);
+	SetUsingAbsoluteScale(true);
+
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+	CanCharacterStepUpOn = ECB_No;
+	SetCastShadow(false);
+	TranslucencySortPriority = -1;
+}
+
+void UPAfterimageTrailComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	SetWorldTransform(FTransform::Identity);
+	ClearInstances();
+	ImageTimes.Init(-1.f, NumImages);
+	Head = 0;
+}
+
+void UPAfterimageTrailComponent::SetSource(UPaperFlipbookComponent* InSource)
+{
+	Source = InSource;
+}
+
+void UPAfterimageTrailComponent::SetEmitting(bool bInEmitting)
+{
+	if (bInEmitting == bEmitting)
+	{
+		return;
+	}
+
+	bEmitting = bInEmitting;
+	if (bEmitting)
+	{
+		// The first image is taken right away
+		NextSampleTime = Time;
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UPAfterimageTrailComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	Time += DeltaTime;
+	bool bChanged = false;
+	if (bEmitting && Time >= NextSampleTime)
+	{
+		bChanged |= SampleSource();
+		NextSampleTime = Time + SampleInterval;
+	}
+
+	bool bAnyVisible = false;
+	for (int32 Index = 0; Index < ImageTimes.Num(); ++Index)
+	{
+		if (ImageTimes[Index] < 0.f)
+		{
+			continue;
+		}
+
+		const float Fade = 1.f - (Time - ImageTimes[Index]) / FadeDuration;
+		FLinearColor Color = TrailColor;
+		Color.A *= FMath::Max(Fade, 0.f);
+		if (Fade <= 0.f)
+		{
+			ImageTimes[Index] = -1.f;
+		}
+		else
+		{
+			bAnyVisible = true;
+		}
+		UpdateInstanceColor(Index, Color, false);
+		bChanged = true;
+	}
+
+	// The updates above only touched the instance data, the proxy is rebuilt once for all of them
+	if (bChanged)
+	{
+		UpdateBounds();
+		MarkRenderStateDirty();
+	}
+	if (!bEmitting && !bAnyVisible)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+bool UPAfterimageTrailComponent::SampleSource()
+{
+	const UPaperFlipbook* Flipbook = Source ? Source->GetFlipbook() : nullptr;
+	UPaperSprite* Sprite = Flipbook ? Flipbook->GetSpriteAtFrame(Source->GetPlaybackPositionInFrames()) : nullptr;
+	if (!Sprite)
+	{
+		return false;
+	}
+
+	const FTransform Transform = Source->GetComponentTransform();
+	if (GetInstanceCount() < ImageTimes.Num())
+	{
+		// The ring fills up during the first dash, after that instances are only ever overwritten
+		AddInstance(Transform, Sprite, true, TrailColor);
+	}
+	else
+	{
+		// The frames of one flipbook share their material, only the sprite of the instance changes
+		PerInstanceSpriteData[Head].SourceSprite = Sprite;
+		UpdateInstanceTransform(Head, Transform, true, false, true);
+		UpdateInstanceColor(Head, TrailColor, false);
+	}
+
+	ImageTimes[Head] = Time;
+	Head = (Head + 1) % ImageTimes.Num();
+	return true;
+}
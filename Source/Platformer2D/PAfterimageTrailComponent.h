@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PaperGroupedSpriteComponent.h"
+#include "PAfterimageTrailComponent.generated.h"
+
+class UPaperFlipbookComponent;
+
+/**
+ * Afterimage trail of a flipbook sprite, e.g. during a dash.
+ *
+ * While emitting, the source's current frame and transform are sampled at a fixed rate into a fixed ring of sprite instances,
+ * the oldest image is overwritten by the newest. Every image fades out over FadeDuration.
+ * The whole trail is one primitive with one render state update per frame it changes, and it doesn't tick once it has faded.
+ */
+UCLASS(ClassGroup=(Paper2D), meta=(BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPAfterimageTrailComponent : public UPaperGroupedSpriteComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPAfterimageTrailComponent();
+
+	/** Size of the ring, the most images visible at once. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Trail, meta = (ClampMin = "1", ClampMax = "64"))
+	int32 NumImages = 8;
+
+	/** Time between two images while emitting. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trail, meta = (ClampMin = "0.001"))
+	float SampleInterval = 0.04f;
+
+	/** Time an image takes to fade out completely. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trail, meta = (ClampMin = "0.001"))
+	float FadeDuration = 0.25f;
+
+	/** Tint of a new image, its alpha fades to zero. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Trail)
+	FLinearColor TrailColor = FLinearColor(0.4f, 0.6f, 1.f, 0.6f);
+
+	/** Sets the sprite the images are taken from. */
+	void SetSource(UPaperFlipbookComponent* InSource);
+
+	/** Starts or stops taking images. Images already in the trail fade out either way. */
+	UFUNCTION(BlueprintCallable, Category = Trail)
+	void SetEmitting(bool bInEmitting);
+
+	UFUNCTION(BlueprintPure, Category = Trail)
+	bool IsEmitting() const { return bEmitting; }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	/** Writes the source's current frame over the oldest image. @return false if the source has nothing to show */
+	bool SampleSource();
+
+	UPROPERTY(Transient)
+	UPaperFlipbookComponent* Source;
+
+	/** Time each image of the ring was taken at, negative for an image that has faded. */
+	TArray<float> ImageTimes;
+	/** Ring slot the next image is written to. */
+	int32 Head = 0;
+	float Time = 0.f;
+	float NextSampleTime = 0.f;
+	bool bEmitting = false;
+};
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PAnimationResolver.h"
+#include "PaperFlipbookComponent.h"
+
+void FPAnimationResolver::SetFlipbook(EPAnimationState State, UPaperFlipbook* Flipbook)
+{
+	Flipbooks[static_cast<int32>(State)] = Flipbook;
+	Reset();
+}
+
+void FPAnimationResolver::Reset()
+{
+	AppliedKey = NoChange;
+	Facing = 0;
+}
+
+void FPAnimationResolver::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (UPaperFlipbook*& Flipbook : Flipbooks)
+	{
+		Collector.AddReferencedObject(Flipbook);
+	}
+}
+
+void FPAnimationResolver::SetFacing(UPaperFlipbookComponent* Sprite, int8 InFacing)
+{
+	if (InFacing != 0 && InFacing != Facing)
+	{
+		Sprite->SetWorldRotation(FRotator(0, InFacing > 0 ? 0 : -180, 0));
+	}
+	Facing = InFacing;
+}
+
+uint8 FPAnimationResolver::ResolveKey(const FVector& Velocity, bool bIsFalling, bool bIsDashing) const
+{
+	auto Key = [this](EPAnimationState State)
+	{
+		// States without a flipbook keep the current one
+		return Flipbooks[static_cast<int32>(State)] ? static_cast<uint8>(State) : NoChange;
+	};
+
+	if (bIsDashing)
+	{
+		return Key(EPAnimationState::Dash);
+	}
+	if (bIsFalling && Velocity.Z > 0.f)
+	{
+		return Key(EPAnimationState::Jump);
+	}
+	if (bIsFalling && Velocity.Z < 0.f)
+	{
+		// Sets without a fall animation keep jumping on the way down
+		return Flipbooks[static_cast<int32>(EPAnimationState::Fall)] ? Key(EPAnimationState::Fall) : Key(EPAnimationState::Jump);
+	}
+	if (Velocity.IsZero())
+	{
+		return Key(EPAnimationState::Idle);
+	}
+	if (Velocity.Z == 0.f)
+	{
+		return Key(EPAnimationState::Run);
+	}
+	return NoChange;
+}
+
+bool FPAnimationResolver::Update(UPaperFlipbookComponent* Sprite, const FVector& Velocity, bool bIsFalling, bool bIsDashing)
+{
+	bool bTouched = false;
+
+	// The facing is frozen for the whole dash
+	if (!bIsDashing && Velocity.X != 0.f)
+	{
+		const int8 NewFacing = Velocity.X > 0.f ? 1 : -1;
+		if (NewFacing != Facing)
+		{
+			Facing = NewFacing;
+			Sprite->SetWorldRotation(FRotator(0, Facing > 0 ? 0 : -180, 0));
+			bTouched = true;
+		}
+	}
+
+	const uint8 Key = ResolveKey(Velocity, bIsFalling, bIsDashing);
+	if (Key != NoChange)
+	{
+		AppliedKey = Key;
+		// Blueprints and effects may have swapped the flipbook behind our back, so compare against the sprite itself
+		if (Sprite->GetFlipbook() != Flipbooks[Key])
+		{
+			Sprite->SetFlipbook(Flipbooks[Key]);
+			bTouched = true;
+		}
+	}
+
+	return bTouched;
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PAnimationResolver.generated.h"
+
+class UPaperFlipbook;
+class UPaperFlipbookComponent;
+
+UENUM(BlueprintType)
+enum class EPAnimationState : uint8
+{
+	Idle,
+	Run,
+	Jump,
+	Fall,
+	Dash,
+	Num		UMETA(Hidden)
+};
+
+/**
+ * Picks the flipbook and facing of a sprite from its movement and only touches the sprite when either changes.
+ * Driven by a flipbook per animation state, so every character set (Wizard, Frog, ...) goes through the same code.
+ */
+class PLATFORMER2D_API FPAnimationResolver
+{
+public:
+	/** A null flipbook keeps whatever the sprite shows when its state is entered. */
+	void SetFlipbook(EPAnimationState State, UPaperFlipbook* Flipbook);
+
+	/** Forgets the applied key and facing, so the next Update writes the sprite again. */
+	void Reset();
+
+	/** Keeps the flipbooks alive, the owner forwards its own AddReferencedObjects here. */
+	void AddReferencedObjects(FReferenceCollector& Collector);
+
+	/**
+	 * Resolves the animation state and facing and applies them to Sprite if they differ from what it shows.
+	 * @return true if the sprite was touched
+	 */
+	bool Update(UPaperFlipbookComponent* Sprite, const FVector& Velocity, bool bIsFalling, bool bIsDashing);
+
+	EPAnimationState GetState() const { return static_cast<EPAnimationState>(AppliedKey); }
+
+	int8 GetFacing() const { return Facing; }
+	/** Turns the sprite to a facing saved earlier, Facing is 1, -1 or 0 for unknown. */
+	void SetFacing(UPaperFlipbookComponent* Sprite, int8 InFacing);
+
+private:
+	/** Keeps the current state. */
+	static constexpr uint8 NoChange = static_cast<uint8>(EPAnimationState::Num);
+
+	uint8 ResolveKey(const FVector& Velocity, bool bIsFalling, bool bIsDashing) const;
+
+	UPaperFlipbook* Flipbooks[static_cast<int32>(EPAnimationState::Num)] = {};
+
+	uint8 AppliedKey = NoChange;
+	/** 1 facing +X, -1 facing -X, 0 before the first horizontal movement. */
+	int8 Facing = 0;
+};
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PAnimationSet.h"
+#include "PaperFlipbook.h"
+
+const FName UPAnimationSet::AnimationsBundle(TEXT("Animations"));
+
+UPaperFlipbook* UPAnimationSet::GetFlipbook(EPAnimationState State) const
+{
+	switch (State)
+	{
+	case EPAnimationState::Idle:	return Idle.Get();
+	case EPAnimationState::Run:		return Run.Get();
+	case EPAnimationState::Jump:	return Jump.Get();
+	case EPAnimationState::Fall:	return Fall.Get();
+	case EPAnimationState::Dash:	return Dash.Get();
+	default:						return nullptr;
+	}
+}
+
+TSoftObjectPtr<UPaperFlipbook>& UPAnimationSet::GetFlipbookReference(EPAnimationState State)
+{
+	switch (State)
+	{
+	case EPAnimationState::Idle:	return Idle;
+	case EPAnimationState::Run:		return Run;
+	case EPAnimationState::Jump:	return Jump;
+	case EPAnimationState::Fall:	return Fall;
+	default:
+		checkf(State == EPAnimationState::Dash, TEXT("No flipbook for animation state %d"), static_cast<int32>(State));
+		return Dash;
+	}
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "PAnimationResolver.h"
+#include "PAnimationSet.generated.h"
+
+class UPaperFlipbook;
+
+/**
+ * The flipbooks of one character skin. They are soft references in the Animations bundle, so a character class only
+ * costs its flipbooks once UPAnimationSetSubsystem loads the set for a world that uses it.
+ */
+UCLASS(BlueprintType)
+class PLATFORMER2D_API UPAnimationSet : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	static const FName AnimationsBundle;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Animations, meta = (AssetBundles = "Animations"))
+	TSoftObjectPtr<UPaperFlipbook> Idle;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Animations, meta = (AssetBundles = "Animations"))
+	TSoftObjectPtr<UPaperFlipbook> Run;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Animations, meta = (AssetBundles = "Animations"))
+	TSoftObjectPtr<UPaperFlipbook> Jump;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Animations, meta = (AssetBundles = "Animations"))
+	TSoftObjectPtr<UPaperFlipbook> Fall;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Animations, meta = (AssetBundles = "Animations"))
+	TSoftObjectPtr<UPaperFlipbook> Dash;
+
+	/** @return the flipbook of a state if it is loaded, null if it isn't or the set has none */
+	UFUNCTION(BlueprintPure, Category = Animations)
+	UPaperFlipbook* GetFlipbook(EPAnimationState State) const;
+
+	/** The soft reference of a state's flipbook, e.g. for tools filling the set. */
+	TSoftObjectPtr<UPaperFlipbook>& GetFlipbookReference(EPAnimationState State);
+};
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PAnimationSetSubsystem.h"
+#include "PAnimationSet.h"
+#include "Platformer2D.h"
+#include "Engine/AssetManager.h"
+
+void UPAnimationSetSubsystem::Deinitialize()
+{
+	UAssetManager* AssetManager = UAssetManager::GetIfValid();
+	for (TPair<TObjectKey<UPAnimationSet>, FLoadingSet>& Pair : Sets)
+	{
+		if (Pair.Value.Handle)
+		{
+			Pair.Value.Handle->CancelHandle();
+		}
+		if (AssetManager && Pair.Key.ResolveObjectPtr())
+		{
+			AssetManager->UnloadPrimaryAsset(Pair.Key.ResolveObjectPtr()->GetPrimaryAssetId());
+		}
+	}
+	Sets.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPAnimationSetSubsystem::RequestAnimationSet(UPAnimationSet* AnimationSet, FSimpleDelegate OnLoaded)
+{
+	if (!AnimationSet)
+	{
+		return;
+	}
+
+	const TObjectKey<UPAnimationSet> Key(AnimationSet);
+	if (FLoadingSet* Set = Sets.Find(Key))
+	{
+		if (Set->Handle && Set->Handle->IsLoadingInProgress())
+		{
+			Set->Waiting.Add(MoveTemp(OnLoaded));
+		}
+		else
+		{
+			OnLoaded.ExecuteIfBound();
+		}
+		return;
+	}
+
+	Sets.Add(Key).Waiting.Add(MoveTemp(OnLoaded));
+	TSharedPtr<FStreamableHandle> Handle = UAssetManager::Get().LoadPrimaryAsset(AnimationSet->GetPrimaryAssetId(), { UPAnimationSet::AnimationsBundle },
+		FStreamableDelegate::CreateUObject(this, &UPAnimationSetSubsystem::OnSetLoaded, Key));
+	if (!Handle)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s is not a known primary asset, check the asset manager settings"), *AnimationSet->GetPathName());
+	}
+
+	// The delegate may already have run and requested other sets, so look the entry up again
+	Sets.FindChecked(Key).Handle = Handle;
+	// A set that is already in memory, or one the asset manager can't load, has nothing to wait for
+	if (!Handle || !Handle->IsLoadingInProgress())
+	{
+		OnSetLoaded(Key);
+	}
+}
+
+bool UPAnimationSetSubsystem::IsLoaded(const UPAnimationSet* AnimationSet) const
+{
+	const FLoadingSet* Set = Sets.Find(TObjectKey<UPAnimationSet>(AnimationSet));
+	return Set && Set->Waiting.Num() == 0;
+}
+
+bool UPAnimationSetSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPAnimationSetSubsystem::OnSetLoaded(TObjectKey<UPAnimationSet> AnimationSet)
+{
+	FLoadingSet* Set = Sets.Find(AnimationSet);
+	if (!Set)
+	{
+		return;
+	}
+	TArray<FSimpleDelegate> Waiting = MoveTemp(Set->Waiting);
+	for (FSimpleDelegate& Delegate : Waiting)
+	{
+		Delegate.ExecuteIfBound();
+	}
+}
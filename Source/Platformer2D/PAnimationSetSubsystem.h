@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PAnimationSetSubsystem.generated.h"
+
+class UPAnimationSet;
+struct FStreamableHandle;
+
+/**
+ * Loads the Animations bundle of the animation sets a world's characters use, once per set however many characters
+ * share it. Characters request their set while the level loads and are called back when its flipbooks are in.
+ * The sets are released with the world, so memory follows the sets in use instead of every set that exists.
+ */
+UCLASS()
+class PLATFORMER2D_API UPAnimationSetSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/**
+	 * Starts loading the set if nobody asked for it yet. OnLoaded runs once its flipbooks are loaded,
+	 * right away if they already are.
+	 */
+	void RequestAnimationSet(UPAnimationSet* AnimationSet, FSimpleDelegate OnLoaded);
+
+	bool IsLoaded(const UPAnimationSet* AnimationSet) const;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FLoadingSet
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+		TArray<FSimpleDelegate> Waiting;
+	};
+
+	void OnSetLoaded(TObjectKey<UPAnimationSet> AnimationSet);
+
+	TMap<TObjectKey<UPAnimationSet>, FLoadingSet> Sets;
+};
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PBakedTileCollisionComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "PhysicsEngine/BodySetup.h"
+
+UPBakedTileCollisionComponent::UPBakedTileCollisionComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	Mobility = EComponentMobility::Static;
+	SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	SetGenerateOverlapEvents(false);
+	bHiddenInGame = true;
+}
+
+void UPBakedTileCollisionComponent::SetBoxes(TArray<FBox> InBoxes, float InTileSize)
+{
+	Boxes = MoveTemp(InBoxes);
+	TileSize = InTileSize;
+
+	RebuildBodySetup();
+	if (IsPhysicsStateCreated())
+	{
+		RecreatePhysicsState();
+	}
+	UpdateBounds();
+}
+
+UBodySetup* UPBakedTileCollisionComponent::GetBodySetup()
+{
+	if (!BodySetup && Boxes.Num() > 0)
+	{
+		RebuildBodySetup();
+	}
+	return BodySetup;
+}
+
+FBoxSphereBounds UPBakedTileCollisionComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	FBox LocalBounds(ForceInit);
+	for (const FBox& Box : Boxes)
+	{
+		LocalBounds += Box;
+	}
+	if (!LocalBounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.f);
+	}
+	return FBoxSphereBounds(LocalBounds.TransformBy(LocalToWorld));
+}
+
+void UPBakedTileCollisionComponent::RebuildBodySetup()
+{
+	if (!BodySetup)
+	{
+		BodySetup = NewObject<UBodySetup>(this, NAME_None, RF_Transient);
+		BodySetup->BodySetupGuid = FGuid::NewGuid();
+		BodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
+		BodySetup->bGenerateMirroredCollision = false;
+		// Boxes only, there is nothing to cook, so cooked builds must not go looking for cooked data
+		BodySetup->bNeverNeedsCookedCollisionData = true;
+	}
+
+	BodySetup->AggGeom.EmptyElements();
+	for (const FBox& Box : Boxes)
+	{
+		const FVector Size = Box.GetSize();
+		FKBoxElem& Element = BodySetup->AggGeom.BoxElems.Add_GetRef(FKBoxElem(Size.X, Size.Y, Size.Z));
+		Element.Center = Box.GetCenter();
+	}
+	BodySetup->InvalidatePhysicsData();
+	BodySetup->CreatePhysicsMeshes();
+}
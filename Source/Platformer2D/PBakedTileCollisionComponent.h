@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "PBakedTileCollisionComponent.generated.h"
+
+class UBodySetup;
+
+/**
+ * Collision of a chunk of a tile map, baked in the editor into a few merged boxes instead of one shape per tile.
+ * Attached to the tile map component it was baked from, whose own collision is turned off by the bake.
+ */
+UCLASS(ClassGroup = Collision, meta = (BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPBakedTileCollisionComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPBakedTileCollisionComponent();
+
+	/** Replaces the collision boxes, given in component space. TileSize is the edge length of a single tile. */
+	void SetBoxes(TArray<FBox> InBoxes, float InTileSize);
+
+	const TArray<FBox>& GetBoxes() const { return Boxes; }
+	float GetTileSize() const { return TileSize; }
+
+	/** Collision the source tile map component had before the bake, restored when the bake is cleared. */
+	UPROPERTY(VisibleAnywhere, Category = Collision)
+	TEnumAsByte<ECollisionEnabled::Type> SourceCollisionEnabled = ECollisionEnabled::QueryAndPhysics;
+
+	/** Number of tiles merged into the boxes. */
+	UPROPERTY(VisibleAnywhere, Category = Collision)
+	int32 NumSourceTiles = 0;
+
+	// UPrimitiveComponent
+	virtual UBodySetup* GetBodySetup() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+
+private:
+	void RebuildBodySetup();
+
+	UPROPERTY(VisibleAnywhere, Category = Collision)
+	TArray<FBox> Boxes;
+
+	UPROPERTY(VisibleAnywhere, Category = Collision)
+	float TileSize = 0.f;
+
+	/** Built from Boxes when first needed, boxes need no cooking so it is never saved. */
+	UPROPERTY(Transient, DuplicateTransient)
+	TObjectPtr<UBodySetup> BodySetup;
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PCameraRig2DComponent.h"
+#include "Platformer2D.h"
+#include "PCharacterMovementComponent.h"
+#include "GameFramework/Character.h"
+#include "DrawDebugHelpers.h"
+
+UPCameraRig2DComponent::UPCameraRig2DComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// After the owner and its movement have ticked
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	SetUsingAbsoluteLocation(true);
+	SetUsingAbsoluteRotation(true);
+	SetUsingAbsoluteScale(true);
+}
+
+void UPCameraRig2DComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	OwnerMovement = Character ? Cast<UPCharacterMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+	Snap();
+}
+
+void UPCameraRig2DComponent::SetLevelBounds(const FBox2D& Bounds)
+{
+	LevelBounds = Bounds;
+	bClampToLevelBounds = Bounds.bIsValid;
+	P2D_LOG(Camera, Log, TEXT("Level bounds set to %s"), bClampToLevelBounds ? *LevelBounds.ToString() : TEXT("none"));
+}
+
+void UPCameraRig2DComponent::Snap()
+{
+	const AActor* Owner = GetOwner();
+	if (!Owner)
+	{
+		return;
+	}
+
+	const FVector Location = GetOwnerLocation();
+	DeadZoneCenter = FVector2D(Location.X, Location.Z);
+	LookAhead = FVector2D::ZeroVector;
+	Focus = ClampToLevelBounds(DeadZoneCenter);
+	bGoalClamped = !Focus.Equals(DeadZoneCenter);
+	ApplyFocus(Location);
+	P2D_LOG(Camera, Log, TEXT("Snapped to %s"), *Focus.ToString());
+}
+
+void UPCameraRig2DComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const AActor* Owner = GetOwner();
+	const FVector Location = GetOwnerLocation();
+	const FVector2D Target(Location.X, Location.Z);
+
+	// The dead zone is dragged along by the part of the owner's motion that leaves it
+	const FVector2D Offset = Target - DeadZoneCenter;
+	DeadZoneCenter.X += Offset.X - FMath::Clamp(Offset.X, -DeadZoneExtent.X, DeadZoneExtent.X);
+	DeadZoneCenter.Y += Offset.Y - FMath::Clamp(Offset.Y, -DeadZoneExtent.Y, DeadZoneExtent.Y);
+
+	const FVector Velocity = Owner->GetVelocity();
+	const FVector2D DesiredLookAhead(
+		FMath::Clamp(Velocity.X * LookAheadTime, -MaxLookAhead.X, MaxLookAhead.X),
+		FMath::Clamp(Velocity.Z * LookAheadTime, -MaxLookAhead.Y, MaxLookAhead.Y));
+	LookAhead = FMath::Vector2DInterpTo(LookAhead, DesiredLookAhead, DeltaTime, LookAheadSpeed);
+
+	const FVector2D Goal = ClampToLevelBounds(DeadZoneCenter + LookAhead);
+	const bool bClamped = !Goal.Equals(DeadZoneCenter + LookAhead);
+	if (bClamped != bGoalClamped)
+	{
+		bGoalClamped = bClamped;
+		P2D_LOG(Camera, Log, TEXT("%s the level bounds at %s"), bClamped ? TEXT("Reached") : TEXT("Left"), *Goal.ToString());
+	}
+	Focus = FMath::Vector2DInterpTo(Focus, Goal, DeltaTime, FollowSpeed);
+	ApplyFocus(Location);
+
+	P2D_DRAW(Camera, DrawDebugBox(GetWorld(), FVector(DeadZoneCenter.X, Location.Y, DeadZoneCenter.Y),
+		FVector(DeadZoneExtent.X, 0.f, DeadZoneExtent.Y), FColor::Cyan, false, -1.f, SDPG_Foreground));
+	P2D_DRAW(Camera, DrawDebugPoint(GetWorld(), FVector(Goal.X, Location.Y, Goal.Y), 8.f, FColor::Yellow, false, -1.f, SDPG_Foreground));
+}
+
+FVector UPCameraRig2DComponent::GetOwnerLocation() const
+{
+	return OwnerMovement ? OwnerMovement->GetInterpolatedLocation() : GetOwner()->GetActorLocation();
+}
+
+FVector2D UPCameraRig2DComponent::GetViewExtent() const
+{
+	const float SafeAspectRatio = FMath::Max(AspectRatio, SMALL_NUMBER);
+	const float HalfWidth = ProjectionMode == ECameraProjectionMode::Orthographic
+		? OrthoWidth * 0.5f
+		: CameraDistance * FMath::Tan(FMath::DegreesToRadians(FieldOfView * 0.5f));
+	return FVector2D(HalfWidth, HalfWidth / SafeAspectRatio);
+}
+
+FVector2D UPCameraRig2DComponent::ClampToLevelBounds(const FVector2D& InFocus) const
+{
+	if (!bClampToLevelBounds || !LevelBounds.bIsValid)
+	{
+		return InFocus;
+	}
+
+	// A level smaller than the view keeps the view centered on it
+	const FVector2D ViewExtent = GetViewExtent();
+	const FVector2D Min = LevelBounds.Min + ViewExtent;
+	const FVector2D Max = LevelBounds.Max - ViewExtent;
+	const FVector2D Center = LevelBounds.GetCenter();
+	return FVector2D(
+		Min.X <= Max.X ? FMath::Clamp(InFocus.X, Min.X, Max.X) : Center.X,
+		Min.Y <= Max.Y ? FMath::Clamp(InFocus.Y, Min.Y, Max.Y) : Center.Y);
+}
+
+void UPCameraRig2DComponent::ApplyFocus(const FVector& OwnerLocation)
+{
+	const FVector FocusLocation(Focus.X, OwnerLocation.Y, Focus.Y);
+	SetWorldLocationAndRotation(FocusLocation - ViewRotation.Vector() * CameraDistance, ViewRotation);
+}
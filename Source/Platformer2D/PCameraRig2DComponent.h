@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Camera/CameraComponent.h"
+#include "PCameraRig2DComponent.generated.h"
+
+class UPCharacterMovementComponent;
+
+/**
+ * Side view camera that follows its owner on the X/Z plane, replacing a spring arm.
+ *
+ * The position is computed from the owner's location and velocity alone: the owner moves freely inside a dead zone,
+ * the view leads in the direction of motion, stays inside the level bounds and eases towards its goal.
+ * The camera uses an absolute transform, so it runs no collision queries and does not move when the sprite flips.
+ * Owners moved by a UPCharacterMovementComponent are followed where they are drawn, between two simulation steps.
+ */
+UCLASS(ClassGroup=(Camera), meta=(BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPCameraRig2DComponent : public UCameraComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPCameraRig2DComponent();
+
+	/** Distance from the owner's plane to the camera. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig", meta = (ClampMin = "0"))
+	float CameraDistance = 1200.f;
+
+	/** World rotation of the view, the camera sits CameraDistance behind the focus along it. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig")
+	FRotator ViewRotation = FRotator(0.f, -90.f, 0.f);
+
+	/** Half size on X/Z of the box the owner can move in without moving the camera. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig")
+	FVector2D DeadZoneExtent = FVector2D(100.f, 80.f);
+
+	/** The view leads the owner by its velocity times this. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig", meta = (ClampMin = "0"))
+	float LookAheadTime = 0.3f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig")
+	FVector2D MaxLookAhead = FVector2D(300.f, 150.f);
+
+	/** How fast the look ahead follows a change of velocity, 0 applies it at once. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig", meta = (ClampMin = "0"))
+	float LookAheadSpeed = 3.f;
+
+	/** How fast the camera eases towards its goal, 0 snaps. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig", meta = (ClampMin = "0"))
+	float FollowSpeed = 6.f;
+
+	/** Keeps the edges of the view inside LevelBounds. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig")
+	bool bClampToLevelBounds = false;
+
+	/** Bounds of the level on the X/Z plane. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig", meta = (EditCondition = "bClampToLevelBounds"))
+	FBox2D LevelBounds = FBox2D(FVector2D(-10000.f, -10000.f), FVector2D(10000.f, 10000.f));
+
+	UFUNCTION(BlueprintCallable, Category = "Camera Rig")
+	void SetLevelBounds(const FBox2D& Bounds);
+
+	/** Moves the camera straight to the owner, e.g. after a teleport or a rollback. */
+	UFUNCTION(BlueprintCallable, Category = "Camera Rig")
+	void Snap();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	/** Location of the owner as drawn this frame. */
+	FVector GetOwnerLocation() const;
+	/** Half the size of the view on the owner's plane. */
+	FVector2D GetViewExtent() const;
+	FVector2D ClampToLevelBounds(const FVector2D& Focus) const;
+	void ApplyFocus(const FVector& OwnerLocation);
+
+	UPROPERTY(Transient)
+	UPCharacterMovementComponent* OwnerMovement = nullptr;
+
+	/** Center of the dead zone. */
+	FVector2D DeadZoneCenter = FVector2D::ZeroVector;
+	FVector2D LookAhead = FVector2D::ZeroVector;
+	/** Point of the plane the camera looks at. */
+	FVector2D Focus = FVector2D::ZeroVector;
+	/** The level bounds held the goal back last frame, only logged when it changes. */
+	bool bGoalClamped = false;
+};
@@ -3,8 +3,17 @@
 
 #include "PCharacter.h"
 
+#include "Platformer2D.h"
+#include "PCameraRig2DComponent.h"
+#include "PCharacterMovementComponent.h"
+#include "PCharacterProfiler.h"
+#include "PEnvironmentSensorComponent.h"
+#include "PInputRecorderComponent.h"
+#include "PActorPoolSubsystem.h"
+#include "PPooledEffect.h"
+#include "PTileCollisionSubsystem.h"
 #include "PaperFlipbookComponent.h"
-#include "Camera/CameraComponent.h"
+#include "DrawDebugHelpers.h"
 #include "Components/BoxComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -13,28 +22,34 @@
 
 
 // Sets default values
-APCharacter::APCharacter()
+APCharacter::APCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UPCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
 	GetCapsuleComponent()->SetCapsuleHalfHeight(53.0f);
 	GetCapsuleComponent()->SetCapsuleRadius(53.0f);
+	CameraComponent = CreateDefaultSubobject<UPCameraRig2DComponent>(TEXT("Camera"));
+	CameraComponent->SetupAttachment(RootComponent);
+
 	SpringArm = CreateDefaultSubobject<USpringArmComponent>(TEXT("Spring Arm"));
-	SpringArm->TargetArmLength = 1200.0f;
 	SpringArm->SetupAttachment(GetSprite());
-
-	CameraComponent = CreateDefaultSubobject<UCameraComponent>(TEXT("Camera"));
-	CameraComponent->SetupAttachment(SpringArm);
+	SpringArm->TargetArmLength = 1200.0f;
+	SpringArm->bDoCollisionTest = false;
+	SpringArm->PrimaryComponentTick.bCanEverTick = false;
 
 	StaticMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh Component"));
 	StaticMesh->SetupAttachment(GetSprite());
 
+	EnvironmentSensor = CreateDefaultSubobject<UPEnvironmentSensorComponent>(TEXT("Environment Sensor"));
+
 	SetupMovementComponent();
 	bCanDoubleJump = true;
 	bHasDoubleJumped = false;
-	bJumpBuffered = false;
-	bWallJumpInCooldown = false;
+	InputRecorder = nullptr;
+	LeftGroundFrame = INDEX_NONE;
+	WallJumpFrame = INDEX_NONE;
 	CoyoteTime = 0.25f;
 	JumpBufferDuration = 0.1f;
 	DetectionRange = 10.0f;
@@ -45,21 +60,47 @@ APCharacter::APCharacter()
 // Called when the game starts or when spawned
 void APCharacter::BeginPlay()
 {
+	// Blueprints and levels saved with the spring arm may still override its length, handed over before the camera snaps
+	const float DefaultArmLength = GetDefault<APCharacter>()->SpringArm->TargetArmLength;
+	if(!FMath::IsNearlyEqual(SpringArm->TargetArmLength, DefaultArmLength))
+	{
+		CameraComponent->CameraDistance = SpringArm->TargetArmLength;
+	}
+
 	Super::BeginPlay();
-	
+
+	// Same reach and sweep radius as the synchronous DetectWall
+	EnvironmentSensor->WallProbeDistance = DetectionRange;
+	EnvironmentSensor->WallProbeRadius = GetCapsuleComponent()->GetScaledCapsuleRadius() / 2;
+
+	UPCharacterMovementComponent* MovementComponent = CastChecked<UPCharacterMovementComponent>(GetCharacterMovement());
+	MovementComponent->OnSimulationStep.AddUObject(this, &APCharacter::SimulationStep);
+	MovementComponent->SetInterpolatedComponent(GetSprite());
+
+	if (UPActorPoolSubsystem* ActorPool = GetWorld()->GetSubsystem<UPActorPoolSubsystem>())
+	{
+		ActorPool->Prewarm(WallJumpEffectClass, 2);
+	}
 }
 
 // Called every frame
 void APCharacter::Tick(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_PCharacter_Tick);
+	TRACE_CPUPROFILER_EVENT_SCOPE(APCharacter::Tick);
+	PCHARACTER_COST_SCOPE(Tick);
 	Super::Tick(DeltaTime);
+}
+
+void APCharacter::SimulationStep(float DeltaTime)
+{
+	SimulationClock.Advance(DeltaTime);
 
 	if(GetMovementComponent()->Velocity.Z < MaxFallSpeed)
 	{
 		GetMovementComponent()->Velocity.Z = MaxFallSpeed;
-		UE_LOG(LogTemp, Warning, TEXT("Velocity: %d, %d"), GetVelocity().X, GetVelocity().Z);
+		P2D_LOG(Movement, Log, TEXT("Velocity clamped to max fall speed: %f, %f"), GetVelocity().X, GetVelocity().Z);
 	}
-	
 }
 
 // Called to bind functionality to input
@@ -67,10 +108,12 @@ void APCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponen
 {
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
 
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &APCharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &APaperCharacter::StopJumping);
+	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &APCharacter::OnJumpPressed);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &APCharacter::OnJumpReleased);
 	PlayerInputComponent->BindAxis("MoveRight", this, &APCharacter::MoveRight);
 	PlayerInputComponent->BindAction("Test", IE_Pressed, this, &APCharacter::Test);
+
+	InputRecorder = UPInputRecorderComponent::CreateIfRequested(this);
 }
 
 void APCharacter::SetupMovementComponent()
@@ -94,27 +137,93 @@ void APCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 Pr
 
 	if(PrevMovementMode == EMovementMode::MOVE_Walking && GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Falling)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Coyote Timer Started"));
-		GetWorldTimerManager().SetTimer(CoyoteJumpTimerHandle, this, &APCharacter::CoyoteTimerElapsed, CoyoteTime);
+		P2D_LOG(Movement, Log, TEXT("Left the ground on frame %d, coyote time started"), SimulationClock.GetFrame());
+		LeftGroundFrame = SimulationClock.GetFrame();
 	}
 	else if(PrevMovementMode == EMovementMode::MOVE_Falling && GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Walking)
 	{
-		GetWorldTimerManager().ClearTimer(CoyoteJumpTimerHandle);
-		UE_LOG(LogTemp, Warning, TEXT("Landed, clearing coyote timer"));
+		LeftGroundFrame = INDEX_NONE;
+		P2D_LOG(Movement, Log, TEXT("Landed on frame %d, clearing coyote time"), SimulationClock.GetFrame());
 		bHasDoubleJumped = false;
 
-		if(bJumpBuffered)
+		// A jump pressed shortly before landing is taken now, Jump records it again if it has to wait
+		const int32 Frame = SimulationClock.GetFrame();
+		const int32 JumpBufferFrames = FPSimulationClock::SecondsToFrames(JumpBufferDuration);
+		const int32 PressedFrame = InputCommands.FindRecent(Frame, JumpBufferFrames, EPInputCommand::JumpPressed);
+		if(PressedFrame != INDEX_NONE)
 		{
+			const int32 ReleasedFrame = InputCommands.FindRecent(Frame, JumpBufferFrames, EPInputCommand::JumpReleased);
+			InputCommands.Consume(Frame, JumpBufferFrames, EPInputCommand::JumpPressed | EPInputCommand::JumpReleased);
 			Jump();
-			bJumpBuffered = false;
+			if(ReleasedFrame >= PressedFrame && bPressedJump)
+			{
+				// Released since the press, so the button is already up. The hold force is only given for as long as it was held,
+				// JumpKeyHoldTime counts up to the max hold time before the jump input is cleared.
+				const float HeldTime = static_cast<float>(ReleasedFrame - PressedFrame) / FPSimulationClock::GetFramesPerSecond();
+				JumpKeyHoldTime = GetJumpMaxHoldTime() - FMath::Min(HeldTime, GetJumpMaxHoldTime());
+			}
 		}
 	}
 }
 
+void APCharacter::SaveState(FPCharacterSnapshot& OutSnapshot) const
+{
+	static_assert(std::is_trivially_copyable_v<FPCharacterSnapshot>, "Snapshots are copied around as plain memory");
+
+	CastChecked<UPCharacterMovementComponent>(GetCharacterMovement())->SaveState(OutSnapshot.Movement);
+	OutSnapshot.SimulationClock = SimulationClock;
+	OutSnapshot.InputCommands = InputCommands;
+	OutSnapshot.LeftGroundFrame = LeftGroundFrame;
+	OutSnapshot.WallJumpFrame = WallJumpFrame;
+	OutSnapshot.bHasDoubleJumped = bHasDoubleJumped;
+}
+
+void APCharacter::RestoreState(const FPCharacterSnapshot& Snapshot)
+{
+	CastChecked<UPCharacterMovementComponent>(GetCharacterMovement())->RestoreState(Snapshot.Movement);
+	SimulationClock = Snapshot.SimulationClock;
+	InputCommands = Snapshot.InputCommands;
+	LeftGroundFrame = Snapshot.LeftGroundFrame;
+	WallJumpFrame = Snapshot.WallJumpFrame;
+	bHasDoubleJumped = Snapshot.bHasDoubleJumped;
+	// The sensed state belongs to the position before the rollback
+	EnvironmentSensor->Invalidate();
+}
+
+void APCharacter::LaunchCharacter(FVector LaunchVelocity, bool bXYOverride, bool bZOverride)
+{
+	PCHARACTER_COST_SCOPE(LaunchCharacter);
+	Super::LaunchCharacter(LaunchVelocity, bXYOverride, bZOverride);
+}
+
+void APCharacter::OnJumpPressed()
+{
+	if (InputRecorder)
+	{
+		InputRecorder->AddCommands(EPInputCommand::JumpPressed);
+	}
+	Jump();
+}
+
+void APCharacter::OnJumpReleased()
+{
+	if (InputRecorder)
+	{
+		InputRecorder->AddCommands(EPInputCommand::JumpReleased);
+	}
+	StopJumping();
+}
+
+void APCharacter::StopJumping()
+{
+	InputCommands.Record(SimulationClock.GetFrame(), EPInputCommand::JumpReleased);
+	Super::StopJumping();
+}
+
 void APCharacter::Jump()
 {
 	bool RightWall = false;
-	if(DetectWall(RightWall) && GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Falling && !bWallJumpInCooldown)
+	if(DetectWall(RightWall) && GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Falling && !IsWallJumpInCooldown())
 	{
 		WallJump(RightWall);
 		return;
@@ -129,8 +238,8 @@ void APCharacter::Jump()
 	}
 	else if(GetCharacterMovement()->MovementMode == EMovementMode::MOVE_Falling)
 	{
-		bJumpBuffered = true;
-		GetWorldTimerManager().SetTimer(JumpBufferTimerHandle, this, &APCharacter::JumpBufferTimerElapsed, JumpBufferDuration);
+		// Buffered, landing within JumpBufferDuration takes the jump
+		InputCommands.Record(SimulationClock.GetFrame(), EPInputCommand::JumpPressed);
 	}
 }
 
@@ -141,16 +250,20 @@ void APCharacter::WallJump(bool RightWall)
 	FVector Velocity = Direction * WallJumpForce;
 
 	FVector TraceEnd = GetActorLocation() + Velocity;
-	DrawDebugLine(GetWorld(), GetActorLocation(), TraceEnd, FColor::Green, false,2.0f, 0, 10.f);
+	P2D_DRAW(WallDetection, DrawDebugLine(GetWorld(), GetActorLocation(), TraceEnd, FColor::Green, false,2.0f, 0, 10.f));
 
 	LaunchCharacter(Velocity, true, true);
-	bWallJumpInCooldown = true;
-	GetWorldTimerManager().SetTimer(WallJumpCooldownTimerHandle, this, &APCharacter::WallJumpCooldownTimerElapsed, WallJumpCooldown);
+	WallJumpFrame = SimulationClock.GetFrame();
+	APPooledEffect::Play(this, WallJumpEffectClass, GetSprite()->GetComponentTransform());
 	
 }
 
 void APCharacter::MoveRight(float X)
 {
+	if (InputRecorder)
+	{
+		InputRecorder->SetMoveRight(X);
+	}
 	AddMovementInput(FVector(1.0, 0, 0), X);
 }
 
@@ -177,31 +290,46 @@ bool APCharacter::CanJumpInternal_Implementation() const
 		}
 	}
 	
-	const bool timerElapsed = GetWorldTimerManager().GetTimerRemaining(CoyoteJumpTimerHandle) > 0.0f;
-	return timerElapsed || bJumpIsAllowed;
+	return bJumpIsAllowed || IsInCoyoteTime();
 }
 
-void APCharacter::CoyoteTimerElapsed()
+bool APCharacter::IsInCoyoteTime() const
 {
-	UE_LOG(LogTemp, Warning, TEXT("Coyote Timer Elapsed"));
+	return FPSimulationClock::IsWithin(SimulationClock.GetFrame(), LeftGroundFrame, FPSimulationClock::SecondsToFrames(CoyoteTime));
 }
 
-void APCharacter::JumpBufferTimerElapsed()
+bool APCharacter::IsWallJumpInCooldown() const
 {
-	bJumpBuffered = false;
+	return FPSimulationClock::IsWithin(SimulationClock.GetFrame(), WallJumpFrame, FPSimulationClock::SecondsToFrames(WallJumpCooldown));
 }
 
-void APCharacter::WallJumpCooldownTimerElapsed()
+float APCharacter::GetWallSweepRadius() const
 {
-	bWallJumpInCooldown = false;
+	return GetCapsuleComponent()->GetScaledCapsuleRadius() / 2;
+}
+
+float APCharacter::GetWallSweepReach() const
+{
+	return GetCapsuleComponent()->GetScaledCapsuleRadius() + DetectionRange;
 }
 
 bool APCharacter::DetectWall(bool& OutRightHit) const
 {
+	SCOPE_CYCLE_COUNTER(STAT_PCharacter_DetectWall);
+	TRACE_CPUPROFILER_EVENT_SCOPE(APCharacter::DetectWall);
+	PCHARACTER_COST_SCOPE(DetectWall);
+	if (EnvironmentSensor->HasFreshState())
+	{
+		const FPEnvironmentSensorState& Sensed = EnvironmentSensor->GetState();
+		OutRightHit = Sensed.IsBlocked(EPEnvironmentProbe::WallRight);
+		return Sensed.IsTouchingWall();
+	}
+	INC_DWORD_STAT(STAT_EnvironmentSensor_SyncFallbacks);
+
 	FHitResult HitRight;
 	FHitResult HitLeft;
 	
-	float Radius = GetCapsuleComponent()->GetScaledCapsuleRadius() / 2;
+	float Radius = GetWallSweepRadius();
 	FCollisionShape shape;
 	shape.SetSphere(Radius);
 	
@@ -213,14 +341,34 @@ bool APCharacter::DetectWall(bool& OutRightHit) const
 	FVector TraceEndLeft = TraceEndRight;
 	// Setting Trace end to Actor Loc + Capsule Radius + range
 	{
-		TraceEndRight.X += GetCapsuleComponent()->GetScaledCapsuleRadius() + DetectionRange;
-		TraceEndLeft.X -= GetCapsuleComponent()->GetScaledCapsuleRadius() + DetectionRange;
+		TraceEndRight.X += GetWallSweepReach();
+		TraceEndLeft.X -= GetWallSweepReach();
 	}
 	
-	bool blockingHitRight = GetWorld()->SweepSingleByChannel(HitRight, TraceStart, TraceEndRight, FQuat::Identity, ECC_WorldStatic, shape, Params);
-	bool blockingHitLeft = GetWorld()->SweepSingleByChannel(HitLeft, TraceStart, TraceEndLeft, FQuat::Identity, ECC_WorldStatic, shape, Params);
-	DrawDebugLine(GetWorld(), TraceStart, TraceEndLeft, FColor::Red, false, 2.0f, 0, 5);
-	DrawDebugLine(GetWorld(), TraceStart, TraceEndRight, FColor::Green, false, 2.0f, 0, 5);
+	bool blockingHitRight = false;
+	bool blockingHitLeft = false;
+	const UPTileCollisionSubsystem* TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+	if (TileCollision && TileCollision->Contains(TraceStart))
+	{
+		// Static tiles come from the baked grid, only geometry the grid doesn't know about needs a real sweep
+		const float ProbeDistance = TraceEndRight.X - TraceStart.X + Radius;
+		float WallDistance;
+		blockingHitRight = TileCollision->Probe(TraceStart, EPTileProbeDirection::Right, ProbeDistance, Radius, WallDistance);
+		blockingHitLeft = TileCollision->Probe(TraceStart, EPTileProbeDirection::Left, ProbeDistance, Radius, WallDistance);
+
+		TileCollision->AddIgnoredBakedComponents(Params);
+		if (!blockingHitRight)
+			blockingHitRight = GetWorld()->SweepSingleByChannel(HitRight, TraceStart, TraceEndRight, FQuat::Identity, ECC_WorldStatic, shape, Params);
+		if (!blockingHitLeft)
+			blockingHitLeft = GetWorld()->SweepSingleByChannel(HitLeft, TraceStart, TraceEndLeft, FQuat::Identity, ECC_WorldStatic, shape, Params);
+	}
+	else
+	{
+		blockingHitRight = GetWorld()->SweepSingleByChannel(HitRight, TraceStart, TraceEndRight, FQuat::Identity, ECC_WorldStatic, shape, Params);
+		blockingHitLeft = GetWorld()->SweepSingleByChannel(HitLeft, TraceStart, TraceEndLeft, FQuat::Identity, ECC_WorldStatic, shape, Params);
+	}
+	P2D_DRAW(WallDetection, DrawDebugLine(GetWorld(), TraceStart, TraceEndLeft, FColor::Red, false, 2.0f, 0, 5));
+	P2D_DRAW(WallDetection, DrawDebugLine(GetWorld(), TraceStart, TraceEndRight, FColor::Green, false, 2.0f, 0, 5));
 
 	OutRightHit = blockingHitRight;
 	return blockingHitLeft || blockingHitRight;
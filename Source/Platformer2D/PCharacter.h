@@ -5,21 +5,41 @@
 #include "CoreMinimal.h"
 #include "PaperCharacter.h"
 #include "GameFramework/Character.h"
+#include "PCharacterMovementComponent.h"
+#include "PInputCommandBuffer.h"
 #include "PCharacter.generated.h"
 
+class APPooledEffect;
+
+/** Simulation state of an APCharacter for rollback. Trivially copyable, see APCharacter::SaveState. */
+struct FPCharacterSnapshot
+{
+	FPMovementSnapshot Movement;
+	FPSimulationClock SimulationClock;
+	FPInputCommandBuffer InputCommands;
+	int32 LeftGroundFrame;
+	int32 WallJumpFrame;
+	bool bHasDoubleJumped;
+};
+
 UCLASS()
 class PLATFORMER2D_API APCharacter : public APaperCharacter
 {
 	GENERATED_BODY()
 protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
+	class UPCameraRig2DComponent* CameraComponent;
+	/** The old camera arm, the camera follows through CameraComponent now. It never ticks and is only kept so blueprints and levels referencing it still load, its TargetArmLength is handed to the camera. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (DeprecatedProperty, DeprecationMessage = "The camera follows through CameraComponent, set its CameraDistance and ViewRotation instead."))
 	class USpringArmComponent* SpringArm;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
-	class UCameraComponent* CameraComponent;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Primitives)
 	class UStaticMeshComponent* StaticMesh;
 
+	/** Walls, ground and ledges around the capsule, sampled once per frame so Jump doesn't have to trace. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Wall Jump")
+	class UPEnvironmentSensorComponent* EnvironmentSensor;
+
 	UPROPERTY(EditAnywhere, Category="Jump")
 	float CoyoteTime;
 	UPROPERTY(EditDefaultsOnly, Category="Jump")
@@ -36,35 +56,54 @@ protected:
 	float WallJumpForce;
 	UPROPERTY(EditDefaultsOnly, Category="Wall Jump")
 	float WallJumpCooldown;
+	/** Played from the world's actor pool on each wall jump, nothing is played while unset. */
+	UPROPERTY(EditDefaultsOnly, Category="Wall Jump")
+	TSubclassOf<APPooledEffect> WallJumpEffectClass;
+
+	/** Simulation frames the character has lived through, every input and window is stamped with these. Advanced by each movement step. */
+	FPSimulationClock SimulationClock;
+	FPInputCommandBuffer InputCommands;
 
-	FTimerHandle JumpBufferTimerHandle;
-	FTimerHandle CoyoteJumpTimerHandle;
-	FTimerHandle WallJumpCooldownTimerHandle;
+	/** Frame the character last walked off or jumped off the ground, INDEX_NONE while on the ground. */
+	int32 LeftGroundFrame;
+	/** Frame of the last wall jump, INDEX_NONE before the first. */
+	int32 WallJumpFrame;
 
-	bool bWallJumpInCooldown;
-	bool bJumpBuffered;
+	/** Records the player's input when the game runs with -RecordInput, null otherwise. */
+	UPROPERTY(Transient)
+	class UPInputRecorderComponent* InputRecorder;
 public:
 	// Sets default values for this character's properties
-	APCharacter();
+	APCharacter(const FObjectInitializer& ObjectInitializer);
 
 	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode) override;
+	virtual void LaunchCharacter(FVector LaunchVelocity, bool bXYOverride, bool bZOverride) override;
+	virtual void StopJumping() override;
+
+	void SaveState(FPCharacterSnapshot& OutSnapshot) const;
+	/** Puts the character back into a saved state, without running any landing or jump logic. */
+	void RestoreState(const FPCharacterSnapshot& Snapshot);
+
+	/** Radius of the spheres DetectWall sweeps, half the capsule radius. */
+	float GetWallSweepRadius() const;
+	/** How far DetectWall sweeps on either side of the actor location, the capsule radius plus DetectionRange. */
+	float GetWallSweepReach() const;
+
+	// Input handlers, public so headless commandlets can drive the character without a controller
+	/** Bound to the Jump action, records the press and jumps. Jump itself is also called internally, e.g. for buffered jumps. */
+	void OnJumpPressed();
+	void OnJumpReleased();
+	void Jump();
+	void MoveRight(float X);
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
-	void Jump();
 
 	void WallJump(bool RightWall);
-	void MoveRight(float X);
 	virtual bool CanJumpInternal_Implementation() const override;
 
-	UFUNCTION()
-	void CoyoteTimerElapsed();
-
-	UFUNCTION()
-	void JumpBufferTimerElapsed();
-
-	UFUNCTION()
-	void WallJumpCooldownTimerElapsed();
+	bool IsInCoyoteTime() const;
+	bool IsWallJumpInCooldown() const;
 
 	UFUNCTION()
 	bool DetectWall(bool& OutRightHit) const;
@@ -80,6 +119,8 @@ public:
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 private:
 	void SetupMovementComponent();
+	/** Gameplay logic of one movement step, see UPCharacterMovementComponent::OnSimulationStep. */
+	void SimulationStep(float DeltaTime);
 	bool bHasDoubleJumped;
 	
 };
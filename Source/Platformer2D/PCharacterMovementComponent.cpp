@@ -0,0 +1,366 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PCharacterMovementComponent.h"
+#include "Platformer2D.h"
+#include "PCharacterProfiler.h"
+#include "PTileCollisionSubsystem.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+
+namespace PCharacterMovement
+{
+	/** Slack for the float error of adding up frame times, so 1/60 s frames reliably take two 1/120 s steps. */
+	constexpr float FixedStepTolerance = 1.e-6f;
+}
+
+void UPCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+	ResetInterpolation();
+}
+
+void UPCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	PCHARACTER_COST_SCOPE(CharacterMovement);
+
+	if (!UpdatedComponent || !ShouldUseFixedTimestep())
+	{
+		TickSimulation(DeltaTime, TickType, ThisTickFunction);
+		OnSimulationStep.Broadcast(DeltaTime);
+		ResetInterpolation();
+		return;
+	}
+
+	// Moved outside of the simulation, e.g. teleported, there is nothing to interpolate from
+	if (!UpdatedComponent->GetComponentLocation().Equals(SimulatedLocation))
+	{
+		ResetInterpolation();
+	}
+
+	const float StepTime = 1.f / GetFixedStepRate();
+	FixedStepTime += FMath::Max(DeltaTime, 0.f);
+	// Input of a frame too short for a step stays pending on the pawn and adds up with the next frame's
+	if (FixedStepTime + PCharacterMovement::FixedStepTolerance >= StepTime)
+	{
+		FixedStepInputVector = Super::ConsumeInputVector();
+	}
+	bIsFixedStepping = true;
+	int32 NumSteps = 0;
+	while (UpdatedComponent && FixedStepTime + PCharacterMovement::FixedStepTolerance >= StepTime && NumSteps < MaxFixedStepsPerFrame)
+	{
+		PreviousSimulatedLocation = UpdatedComponent->GetComponentLocation();
+		TickSimulation(StepTime, TickType, ThisTickFunction);
+		OnSimulationStep.Broadcast(StepTime);
+		FixedStepTime -= StepTime;
+		++NumSteps;
+	}
+	bIsFixedStepping = false;
+	INC_DWORD_STAT_BY(STAT_PCharacterMovement_FixedSteps, NumSteps);
+
+	if (FixedStepTime >= StepTime)
+	{
+		P2D_LOG(Movement, Verbose, TEXT("Dropped %f s of simulation after %d steps"), FixedStepTime - FMath::Fmod(FixedStepTime, StepTime), NumSteps);
+		FixedStepTime = FMath::Fmod(FixedStepTime, StepTime);
+	}
+	FixedStepTime = FMath::Max(FixedStepTime, 0.f);
+
+	if (UpdatedComponent)
+	{
+		SimulatedLocation = UpdatedComponent->GetComponentLocation();
+	}
+	ApplyInterpolation();
+}
+
+void UPCharacterMovementComponent::TickSimulation(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	if (!bUseKinematicMover2D || !TickKinematic2D(DeltaTime, TickType, ThisTickFunction))
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	}
+}
+
+FVector UPCharacterMovementComponent::ConsumeInputVector()
+{
+	// Every fixed step of a frame moves with the input of that frame
+	return bIsFixedStepping ? FixedStepInputVector : Super::ConsumeInputVector();
+}
+
+bool UPCharacterMovementComponent::ShouldUseFixedTimestep() const
+{
+	// Simulated proxies follow the server's updates with the engine's own smoothing
+	return bUseFixedTimestep && CharacterOwner && CharacterOwner->GetLocalRole() != ROLE_SimulatedProxy;
+}
+
+void UPCharacterMovementComponent::SetInterpolatedComponent(USceneComponent* Component)
+{
+	if (InterpolatedComponent)
+	{
+		InterpolatedComponent->SetRelativeLocation(InterpolatedComponentLocation);
+	}
+	InterpolatedComponent = Component;
+	InterpolatedComponentLocation = Component ? Component->GetRelativeLocation() : FVector::ZeroVector;
+	ApplyInterpolation();
+}
+
+FVector UPCharacterMovementComponent::GetInterpolatedLocation() const
+{
+	return UpdatedComponent ? UpdatedComponent->GetComponentLocation() + InterpolationOffset : FVector::ZeroVector;
+}
+
+void UPCharacterMovementComponent::ResetInterpolation()
+{
+	if (UpdatedComponent)
+	{
+		PreviousSimulatedLocation = SimulatedLocation = UpdatedComponent->GetComponentLocation();
+	}
+	ApplyInterpolation();
+}
+
+void UPCharacterMovementComponent::ApplyInterpolation()
+{
+	// The drawn location trails the simulated one by the time left over after the last step
+	const float Alpha = bUseFixedTimestep ? FMath::Clamp(FixedStepTime * GetFixedStepRate(), 0.f, 1.f) : 1.f;
+	InterpolationOffset = (PreviousSimulatedLocation - SimulatedLocation) * (1.f - Alpha);
+
+	if (InterpolatedComponent)
+	{
+		const USceneComponent* Parent = InterpolatedComponent->GetAttachParent();
+		const FVector RelativeOffset = Parent ? Parent->GetComponentTransform().InverseTransformVector(InterpolationOffset) : InterpolationOffset;
+		InterpolatedComponent->SetRelativeLocation(InterpolatedComponentLocation + RelativeOffset);
+	}
+}
+
+bool UPCharacterMovementComponent::StartDash(const FVector& TargetLocation, float Duration)
+{
+	if (!UpdatedComponent || Duration <= 0.f)
+	{
+		return false;
+	}
+
+	const FVector Offset = ConstrainDirectionToPlane(TargetLocation - UpdatedComponent->GetComponentLocation());
+	const float Distance = Offset.Size();
+	if (Distance < KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	DashTargetLocation = UpdatedComponent->GetComponentLocation() + Offset;
+	DashDirection = Offset / Distance;
+	DashSpeed = Distance / Duration;
+	DashDistanceRemaining = Distance;
+	Velocity = DashDirection * DashSpeed;
+	SetMovementMode(MOVE_Custom, CMOVE_Dash);
+
+	P2D_LOG(Dash, Log, TEXT("Dash from %s to %s at %f u/s"), *UpdatedComponent->GetComponentLocation().ToString(), *DashTargetLocation.ToString(), DashSpeed);
+	return true;
+}
+
+void UPCharacterMovementComponent::StopDash()
+{
+	if (IsDashing())
+	{
+		SetMovementMode(MOVE_Falling);
+	}
+}
+
+void UPCharacterMovementComponent::SaveState(FPMovementSnapshot& OutSnapshot) const
+{
+	OutSnapshot.Location = UpdatedComponent ? UpdatedComponent->GetComponentLocation() : FVector::ZeroVector;
+	OutSnapshot.Velocity = Velocity;
+	OutSnapshot.MovementMode = MovementMode;
+	OutSnapshot.CustomMovementMode = CustomMovementMode;
+
+	OutSnapshot.DashTargetLocation = DashTargetLocation;
+	OutSnapshot.DashDirection = DashDirection;
+	OutSnapshot.DashSpeed = DashSpeed;
+	OutSnapshot.DashDistanceRemaining = DashDistanceRemaining;
+
+	OutSnapshot.bPressedJump = CharacterOwner && CharacterOwner->bPressedJump;
+	OutSnapshot.bWasJumping = CharacterOwner && CharacterOwner->bWasJumping;
+	OutSnapshot.JumpCurrentCount = CharacterOwner ? CharacterOwner->JumpCurrentCount : 0;
+	OutSnapshot.JumpCurrentCountPreJump = CharacterOwner ? CharacterOwner->JumpCurrentCountPreJump : 0;
+	OutSnapshot.JumpKeyHoldTime = CharacterOwner ? CharacterOwner->JumpKeyHoldTime : 0.f;
+	OutSnapshot.JumpForceTimeRemaining = CharacterOwner ? CharacterOwner->JumpForceTimeRemaining : 0.f;
+
+	OutSnapshot.FixedStepTime = FixedStepTime;
+}
+
+void UPCharacterMovementComponent::RestoreState(const FPMovementSnapshot& Snapshot)
+{
+	if (!UpdatedComponent || !CharacterOwner)
+	{
+		return;
+	}
+
+	UpdatedComponent->SetWorldLocation(Snapshot.Location, false, nullptr, ETeleportType::TeleportPhysics);
+	Velocity = Snapshot.Velocity;
+	// Assigned directly, a restore must not run the landing and coyote time logic of a mode change
+	MovementMode = static_cast<EMovementMode>(Snapshot.MovementMode);
+	CustomMovementMode = Snapshot.CustomMovementMode;
+
+	DashTargetLocation = Snapshot.DashTargetLocation;
+	DashDirection = Snapshot.DashDirection;
+	DashSpeed = Snapshot.DashSpeed;
+	DashDistanceRemaining = Snapshot.DashDistanceRemaining;
+
+	CharacterOwner->bPressedJump = Snapshot.bPressedJump;
+	CharacterOwner->bWasJumping = Snapshot.bWasJumping;
+	CharacterOwner->JumpCurrentCount = Snapshot.JumpCurrentCount;
+	CharacterOwner->JumpCurrentCountPreJump = Snapshot.JumpCurrentCountPreJump;
+	CharacterOwner->JumpKeyHoldTime = Snapshot.JumpKeyHoldTime;
+	CharacterOwner->JumpForceTimeRemaining = Snapshot.JumpForceTimeRemaining;
+
+	ConsumeInputVector();
+	ClearAccumulatedForces();
+	PendingLaunchVelocity = FVector::ZeroVector;
+	UpdateComponentVelocity();
+	LastUpdateLocation = Snapshot.Location;
+	LastUpdateVelocity = Snapshot.Velocity;
+
+	FixedStepTime = Snapshot.FixedStepTime;
+	ResetInterpolation();
+}
+
+void UPCharacterMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == CMOVE_Dash)
+	{
+		PhysDash(deltaTime, Iterations);
+		return;
+	}
+
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void UPCharacterMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	if (PreviousMovementMode == MOVE_Custom && PreviousCustomMode == CMOVE_Dash && !IsDashing())
+	{
+		P2D_LOG(Dash, Log, TEXT("Dash over at %s, %f units short of the target"), *UpdatedComponent->GetComponentLocation().ToString(), DashDistanceRemaining);
+		DashDistanceRemaining = 0.f;
+		OnDashEnded.Broadcast();
+	}
+
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+}
+
+void UPCharacterMovementComponent::PhysDash(float deltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PCharacterMovement_PhysDash);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCharacterMovementComponent::PhysDash);
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	// Only the part of the frame that is left of the dash is spent dashing, the rest goes to the next movement mode
+	const float DashTime = FMath::Min(deltaTime, DashDistanceRemaining / DashSpeed);
+	const float FrameDistance = DashSpeed * DashTime;
+	const int32 NumSubsteps = FMath::Clamp(FMath::CeilToInt(FrameDistance / MaxDashSubstepDistance), 1, MaxDashSubsteps);
+	const FVector SubstepDelta = DashDirection * (FrameDistance / NumSubsteps);
+
+	Velocity = DashDirection * DashSpeed;
+	bool bBlocked = false;
+	for (int32 Substep = 0; Substep < NumSubsteps && !bBlocked; ++Substep)
+	{
+		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+		FHitResult Hit(1.f);
+		SafeMoveUpdatedComponent(SubstepDelta, UpdatedComponent->GetComponentQuat(), true, Hit);
+		if (Hit.IsValidBlockingHit())
+		{
+			HandleImpact(Hit, DashTime / NumSubsteps, SubstepDelta);
+			SlideAlongSurface(SubstepDelta, 1.f - Hit.Time, Hit.Normal, Hit, true);
+
+			// Slopes and ledges are slid along, a wall head on stops the dash
+			const float Progress = (UpdatedComponent->GetComponentLocation() - OldLocation) | DashDirection;
+			bBlocked = Progress < SubstepDelta.Size() * 0.1f;
+		}
+		DashDistanceRemaining -= SubstepDelta.Size();
+	}
+
+	if (!bBlocked && DashDistanceRemaining > KINDA_SMALL_NUMBER)
+	{
+		return;
+	}
+
+	if (bBlocked)
+	{
+		Velocity = FVector::ZeroVector;
+	}
+	SetMovementMode(MOVE_Falling);
+	StartNewPhysics(deltaTime - DashTime, Iterations);
+}
+
+bool UPCharacterMovementComponent::TickKinematic2D(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PCharacterMovement_Kinematic2D);
+
+	if (!CharacterOwner || !UpdatedComponent || !TileCollision || !TileCollision->HasGrid()
+		|| (MovementMode != MOVE_Walking && MovementMode != MOVE_Falling)
+		|| CharacterOwner->GetLocalRole() != ROLE_Authority
+		|| (!CharacterOwner->Controller && !bRunPhysicsWithNoController)
+		|| !TileCollision->Contains(UpdatedComponent->GetComponentLocation()))
+	{
+		return false;
+	}
+
+	// The movement component bookkeeping below UCharacterMovementComponent, i.e. Blueprint ticks and stale component checks
+	UPawnMovementComponent::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (!UpdatedComponent)
+	{
+		return true;
+	}
+
+	// Same order as the regular update: input, jump, forces, launch, then the move itself
+	const FVector InputVector = ConsumeInputVector();
+	CharacterOwner->CheckJumpInput(DeltaTime);
+	Acceleration = ScaleInputAcceleration(ConstrainInputAcceleration(InputVector));
+	ApplyAccumulatedForces(DeltaTime);
+	HandlePendingLaunch();
+	ClearAccumulatedForces();
+	if (MovementMode != MOVE_Walking && MovementMode != MOVE_Falling)
+	{
+		CharacterOwner->ClearJumpInput(DeltaTime);
+		return true;
+	}
+
+	const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
+	FPKinematicBody2D Body;
+	Body.Location = UpdatedComponent->GetComponentLocation();
+	Body.Velocity = Velocity;
+	Body.HalfExtent = FVector2D(Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleHalfHeight());
+	Body.bOnGround = MovementMode == MOVE_Walking;
+
+	KinematicMover.Params = FPKinematicMoveParams2D::FromMovementComponent(*this);
+	const float MoveInput = GetMaxAcceleration() > 0.f ? Acceleration.X / GetMaxAcceleration() : 0.f;
+	const bool bGroundChanged = KinematicMover.Step(*TileCollision, Body, MoveInput, DeltaTime);
+
+	UpdatedComponent->SetWorldLocation(Body.Location);
+	Velocity = FVector(Body.Velocity.X, Velocity.Y, Body.Velocity.Z);
+	if (bGroundChanged)
+	{
+		if (Body.bOnGround)
+		{
+			FHitResult Hit(1.f);
+			Hit.bBlockingHit = true;
+			Hit.Location = Hit.ImpactPoint = Body.Location - FVector(0.f, 0.f, Body.HalfExtent.Y);
+			Hit.Normal = Hit.ImpactNormal = FVector::UpVector;
+			CharacterOwner->Landed(Hit);
+			SetMovementMode(MOVE_Walking);
+		}
+		else
+		{
+			SetMovementMode(MOVE_Falling);
+		}
+	}
+
+	UpdateComponentVelocity();
+	LastUpdateLocation = Body.Location;
+	LastUpdateVelocity = Velocity;
+	CharacterOwner->ClearJumpInput(DeltaTime);
+	return true;
+}
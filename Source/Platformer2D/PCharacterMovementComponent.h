@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "PInputCommandBuffer.h"
+#include "PKinematicMover2D.h"
+#include "PCharacterMovementComponent.generated.h"
+
+class UPTileCollisionSubsystem;
+
+/** Called after each step of the simulation with the time it covered. */
+DECLARE_MULTICAST_DELEGATE_OneParam(FPOnSimulationStep, float /*DeltaTime*/);
+/** Called when a dash ends, whether it reached its target, hit something or was stopped. */
+DECLARE_MULTICAST_DELEGATE(FPOnDashEnded);
+
+UENUM(BlueprintType)
+enum EPCustomMovementMode
+{
+	CMOVE_None	UMETA(Hidden),
+	CMOVE_Dash	UMETA(DisplayName = "Dash"),
+	CMOVE_MAX	UMETA(Hidden),
+};
+
+/**
+ * Movement state of a character for rollback: its location, velocity, movement mode, dash and jump input state,
+ * and the time carried over to the next fixed step.
+ * Trivially copyable, see UPCharacterMovementComponent::SaveState.
+ */
+struct FPMovementSnapshot
+{
+	FVector Location;
+	FVector Velocity;
+	uint8 MovementMode;
+	uint8 CustomMovementMode;
+
+	FVector DashTargetLocation;
+	FVector DashDirection;
+	float DashSpeed;
+	float DashDistanceRemaining;
+
+	bool bPressedJump;
+	bool bWasJumping;
+	int32 JumpCurrentCount;
+	int32 JumpCurrentCountPreJump;
+	float JumpKeyHoldTime;
+	float JumpForceTimeRemaining;
+
+	float FixedStepTime;
+};
+
+/**
+ * Character movement with the platformer's custom movement modes.
+ *
+ * Dash moves the character in a straight line to a target location over a fixed duration, ignoring gravity and input.
+ * The move is split into swept sub-steps no longer than MaxDashSubstepDistance, so the distance covered does not depend
+ * on the frame rate and a fast dash cannot skip over thin tiles.
+ *
+ * With bUseKinematicMover2D, walking and falling skip the physics based update and move the capsule's bounding box
+ * through the tile collision grid with FPKinematicMover2D, using this component's tuning. Dashes, and characters
+ * outside the grid, still take the regular path.
+ *
+ * With bUseFixedTimestep, the frame's time is split into steps of 1 / GetFixedStepRate() seconds, so jump heights, dash
+ * distances and wall jump arcs come out the same at any frame rate. OnSimulationStep lets the owner run its gameplay
+ * logic at the same rate. The leftover time of a frame is carried over, and the InterpolatedComponent (the sprite)
+ * is drawn between the last two simulated locations by that fraction of a step, see GetInterpolatedLocation.
+ */
+UCLASS()
+class PLATFORMER2D_API UPCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Longest distance covered by a single swept move while dashing. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Dash", meta = (ClampMin = "1", UIMin = "1"))
+	float MaxDashSubstepDistance = 32.f;
+
+	/** Upper bound for the number of swept moves of a single dash update. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Dash", meta = (ClampMin = "1", UIMin = "1"))
+	int32 MaxDashSubsteps = 16;
+
+	/**
+	 * Walk and fall with the kinematic 2D mover instead of physics sweeps. Much cheaper, but only static tile collision
+	 * blocks the character and there is no network prediction, so it is meant for AI, ghosts and other non-replicated characters.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Character Movement: Kinematic 2D")
+	bool bUseKinematicMover2D = false;
+
+	/** Simulate in steps of 1 / FixedStepRate seconds. Simulated proxies always move once per frame. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Character Movement: Fixed Timestep")
+	bool bUseFixedTimestep = true;
+
+	/** Simulation steps per second, 0 steps at the simulation clock's rate (p2d.Simulation.FramesPerSecond). */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Character Movement: Fixed Timestep", meta = (ClampMin = "0", UIMin = "0", EditCondition = "bUseFixedTimestep"))
+	float FixedStepRate = 0.f;
+
+	/** Upper bound for the steps of one frame. Time beyond it is dropped, so a long hitch slows the game down instead of stalling it further. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Character Movement: Fixed Timestep", meta = (ClampMin = "1", UIMin = "1", EditCondition = "bUseFixedTimestep"))
+	int32 MaxFixedStepsPerFrame = 8;
+
+	FPOnSimulationStep OnSimulationStep;
+	FPOnDashEnded OnDashEnded;
+
+	/**
+	 * Starts dashing from the current location to TargetLocation over Duration seconds.
+	 * @return false if the target is not reachable, i.e. there is nowhere to dash to
+	 */
+	bool StartDash(const FVector& TargetLocation, float Duration);
+
+	/** Ends a dash early. The character keeps its dash velocity and continues falling. */
+	void StopDash();
+
+	/** Offsets Component by the interpolation of each frame, its current relative location is the one at the simulated location. */
+	void SetInterpolatedComponent(USceneComponent* Component);
+
+	/** Where the owner is drawn this frame, between the last two simulated locations. */
+	FVector GetInterpolatedLocation() const;
+
+	/** @return the steps per second of the fixed timestep, FixedStepRate or the simulation clock's rate */
+	float GetFixedStepRate() const { return FixedStepRate > 0.f ? FixedStepRate : FPSimulationClock::GetFramesPerSecond(); }
+
+	bool IsDashing() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_Dash; }
+	const FVector& GetDashTargetLocation() const { return DashTargetLocation; }
+
+	/** Saves the movement state and the owner's jump input state. */
+	void SaveState(FPMovementSnapshot& OutSnapshot) const;
+	/**
+	 * Teleports the character back to a saved state. The movement mode is set without any mode change callbacks,
+	 * pending input and launches are dropped. The floor is found again by the next walking update.
+	 */
+	void RestoreState(const FPMovementSnapshot& Snapshot);
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual FVector ConsumeInputVector() override;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+private:
+	void PhysDash(float deltaTime, int32 Iterations);
+
+	/**
+	 * Moves the character by one step, a fixed one or the whole frame. Outside the kinematic mover this is a full
+	 * Super::TickComponent, so with fixed steps everything it drives runs once per step: root motion, the owner's
+	 * movement callbacks and ReceiveTick of the component's Blueprint.
+	 */
+	void TickSimulation(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction);
+
+	bool ShouldUseFixedTimestep() const;
+
+	/** Draws the owner at its simulated location until the next step. */
+	void ResetInterpolation();
+	void ApplyInterpolation();
+
+	/** Runs the update with the kinematic mover. @return false if the regular update has to run instead */
+	bool TickKinematic2D(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction);
+
+	UPROPERTY(Transient)
+	UPTileCollisionSubsystem* TileCollision = nullptr;
+	FPKinematicMover2D KinematicMover;
+
+	FVector DashTargetLocation = FVector::ZeroVector;
+	FVector DashDirection = FVector::ZeroVector;
+	float DashSpeed = 0.f;
+	float DashDistanceRemaining = 0.f;
+
+	/** Time not yet simulated by a whole fixed step. */
+	float FixedStepTime = 0.f;
+	/** Input of the frame, given to each of its fixed steps. */
+	FVector FixedStepInputVector = FVector::ZeroVector;
+	bool bIsFixedStepping = false;
+
+	UPROPERTY(Transient)
+	USceneComponent* InterpolatedComponent = nullptr;
+	FVector InterpolatedComponentLocation = FVector::ZeroVector;
+	/** Location before and after the last step. */
+	FVector PreviousSimulatedLocation = FVector::ZeroVector;
+	FVector SimulatedLocation = FVector::ZeroVector;
+	/** World space offset of the drawn location from the simulated one. */
+	FVector InterpolationOffset = FVector::ZeroVector;
+};
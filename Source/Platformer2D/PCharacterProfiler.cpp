@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PCharacterProfiler.h"
+
+bool FPCharacterProfiler::bEnabled = false;
+FPCharacterCostScope* FPCharacterProfiler::CurrentScope = nullptr;
+uint64 FPCharacterProfiler::Cycles[static_cast<int32>(EPCharacterCost::Num)] = {};
+uint32 FPCharacterProfiler::Calls[static_cast<int32>(EPCharacterCost::Num)] = {};
+
+void FPCharacterProfiler::ResetFrame()
+{
+	FMemory::Memzero(Cycles, sizeof(Cycles));
+	FMemory::Memzero(Calls, sizeof(Calls));
+}
+
+void FPCharacterProfiler::Add(EPCharacterCost Cost, uint64 InCycles)
+{
+	Cycles[static_cast<int32>(Cost)] += InCycles;
+	++Calls[static_cast<int32>(Cost)];
+}
+
+const TCHAR* FPCharacterProfiler::GetName(EPCharacterCost Cost)
+{
+	switch (Cost)
+	{
+	case EPCharacterCost::Tick:				return TEXT("Tick");
+	case EPCharacterCost::DetectWall:		return TEXT("DetectWall");
+	case EPCharacterCost::LaunchCharacter:	return TEXT("LaunchCharacter");
+	case EPCharacterCost::StateMachineTick:	return TEXT("StateMachineTickComponent");
+	case EPCharacterCost::CharacterMovement:	return TEXT("CharacterMovementTickComponent");
+	default:								return TEXT("Unknown");
+	}
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FPCharacterCostScope;
+
+/** Character code paths timed by the movement benchmark. */
+enum class EPCharacterCost : uint8
+{
+	Tick,
+	DetectWall,
+	LaunchCharacter,
+	StateMachineTick,
+	CharacterMovement,
+	Num
+};
+
+/**
+ * Accumulates the cost of the character hot paths for the current frame.
+ * Scopes only read the clock while the profiler is enabled, so in normal play they cost a single branch.
+ *
+ * Costs are exclusive: the time of a scope nested in another, e.g. a LaunchCharacter inside a Tick, is only counted
+ * for the inner one, so the categories of a frame add up to at most the frame. Scopes are for the game thread only.
+ */
+class PLATFORMER2D_API FPCharacterProfiler
+{
+public:
+	static void SetEnabled(bool bInEnabled) { bEnabled = bInEnabled; }
+	static bool IsEnabled() { return bEnabled; }
+
+	/** Clears the accumulated cycles and call counts, called once per benchmark frame. */
+	static void ResetFrame();
+	static void Add(EPCharacterCost Cost, uint64 InCycles);
+
+	static uint64 GetCycles(EPCharacterCost Cost) { return Cycles[static_cast<int32>(Cost)]; }
+	static uint32 GetCalls(EPCharacterCost Cost) { return Calls[static_cast<int32>(Cost)]; }
+	static const TCHAR* GetName(EPCharacterCost Cost);
+
+private:
+	friend struct FPCharacterCostScope;
+
+	static bool bEnabled;
+	/** Innermost open scope, null outside of any. */
+	static FPCharacterCostScope* CurrentScope;
+	static uint64 Cycles[static_cast<int32>(EPCharacterCost::Num)];
+	static uint32 Calls[static_cast<int32>(EPCharacterCost::Num)];
+};
+
+struct FPCharacterCostScope
+{
+	explicit FPCharacterCostScope(EPCharacterCost InCost)
+		: Cost(InCost)
+		, StartCycles(0)
+		, ChildCycles(0)
+		, Parent(nullptr)
+	{
+		if (FPCharacterProfiler::IsEnabled())
+		{
+			checkSlow(IsInGameThread());
+			Parent = FPCharacterProfiler::CurrentScope;
+			FPCharacterProfiler::CurrentScope = this;
+			StartCycles = FPlatformTime::Cycles64();
+		}
+	}
+
+	~FPCharacterCostScope()
+	{
+		if (StartCycles != 0)
+		{
+			const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+			FPCharacterProfiler::Add(Cost, Cycles - FMath::Min(ChildCycles, Cycles));
+			if (Parent)
+			{
+				Parent->ChildCycles += Cycles;
+			}
+			FPCharacterProfiler::CurrentScope = Parent;
+		}
+	}
+
+private:
+	EPCharacterCost Cost;
+	uint64 StartCycles;
+	/** Time spent in the scopes nested in this one. */
+	uint64 ChildCycles;
+	FPCharacterCostScope* Parent;
+};
+
+#if UE_BUILD_SHIPPING
+#define PCHARACTER_COST_SCOPE(Cost)
+#else
+#define PCHARACTER_COST_SCOPE(Cost) FPCharacterCostScope PREPROCESSOR_JOIN(PCharacterCostScope_, __LINE__)(EPCharacterCost::Cost)
+#endif
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PCommandletWorld.h"
+
+#include "Platformer2D.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+
+namespace PCommandletWorld
+{
+	UWorld* Create(const FString& MapName)
+	{
+		UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+		UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (!World)
+		{
+			UE_LOG(LogPlatformer2D, Error, TEXT("Could not load map %s"), *MapName);
+			return nullptr;
+		}
+
+		World->WorldType = EWorldType::Game;
+		World->AddToRoot();
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		if (!World->bIsWorldInitialized)
+		{
+			World->InitWorld(UWorld::InitializationValues()
+				.AllowAudioPlayback(false)
+				.RequiresHitProxies(false)
+				.CreatePhysicsScene(true)
+				.CreateNavigation(false)
+				.CreateAISystem(false)
+				.ShouldSimulatePhysics(true)
+				.SetTransactional(false));
+		}
+		World->UpdateWorldComponents(true, false);
+
+		FURL URL;
+		World->InitializeActorsForPlay(URL);
+		// There is no game instance in a commandlet, so dispatch BeginPlay directly instead of going through a game mode.
+		World->GetWorldSettings()->NotifyBeginPlay();
+		return World;
+	}
+
+	void Destroy(UWorld* World)
+	{
+		World->DestroyWorld(false);
+		GEngine->DestroyWorldContext(World);
+		World->RemoveFromRoot();
+		CollectGarbage(RF_NoFlags);
+	}
+}
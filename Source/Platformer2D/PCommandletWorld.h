@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/** Game worlds for headless commandlets, which have no game instance to load maps for them. */
+namespace PCommandletWorld
+{
+	/** Loads MapName and brings it up for play, BeginPlay included. @return nullptr if the map could not be loaded */
+	PLATFORMER2D_API UWorld* Create(const FString& MapName);
+	PLATFORMER2D_API void Destroy(UWorld* World);
+}
@@ -2,16 +2,16 @@
 
 
 #include "PDashComponent.h"
+#include "PCharacterMovementComponent.h"
+#include "Platformer2D.h"
+#include "GameFramework/Character.h"
 
 
 // Sets default values for this component's properties
 UPDashComponent::UPDashComponent()
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
-
-	// ...
+	// The dash is simulated by the movement component, nothing to do here every frame
+	PrimaryComponentTick.bCanEverTick = false;
 }
 
 
@@ -20,16 +20,45 @@ void UPDashComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// ...
-	
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	MovementComponent = Character ? Cast<UPCharacterMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+	if (!MovementComponent)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s needs a character with a UPCharacterMovementComponent to dash"), *GetOwner()->GetName());
+		return;
+	}
+	MovementComponent->OnDashEnded.AddUObject(this, &UPDashComponent::OnDashEnded);
 }
 
+void UPDashComponent::OnDashEnded()
+{
+	// A dash stopped early by a wall, a grapple or StopDash starts its cooldown right away
+	NextDashTime = GetWorld()->GetTimeSeconds() + Cooldown;
+}
 
-// Called every frame
-void UPDashComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+bool UPDashComponent::CanDash() const
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	return MovementComponent && !MovementComponent->IsDashing() && GetWorld()->GetTimeSeconds() >= NextDashTime;
+}
 
-	// ...
+bool UPDashComponent::IsDashing() const
+{
+	return MovementComponent && MovementComponent->IsDashing();
 }
 
+bool UPDashComponent::TryDash(FVector Direction)
+{
+	if (!CanDash())
+	{
+		return false;
+	}
+
+	const FVector TargetLocation = GetOwner()->GetActorLocation() + Direction.GetSafeNormal() * DashDistance;
+	if (!MovementComponent->StartDash(TargetLocation, DashDuration))
+	{
+		return false;
+	}
+
+	NextDashTime = GetWorld()->GetTimeSeconds() + DashDuration + Cooldown;
+	return true;
+}
@@ -6,7 +6,12 @@
 #include "Components/ActorComponent.h"
 #include "PDashComponent.generated.h"
 
+class UPCharacterMovementComponent;
 
+/**
+ * Dash ability of a character. The dash itself is a movement mode of the owner's UPCharacterMovementComponent,
+ * this component only decides when a dash may start. It never ticks, the cooldown is a timestamp.
+ */
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class PLATFORMER2D_API UPDashComponent : public UActorComponent
 {
@@ -16,12 +21,43 @@ public:
 	// Sets default values for this component's properties
 	UPDashComponent();
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Dash)
+	float DashDistance = 1000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Dash)
+	float DashDuration = 0.5f;
+
+	/** Time after a dash ends before the next one can start. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Dash)
+	float Cooldown = 0.5f;
+
+	/**
+	 * Dashes DashDistance along Direction if the cooldown is over.
+	 * @return true if the dash started
+	 */
+	UFUNCTION(BlueprintCallable, Category = Dash)
+	bool TryDash(FVector Direction);
+
+	UFUNCTION(BlueprintPure, Category = Dash)
+	bool CanDash() const;
+
+	UFUNCTION(BlueprintPure, Category = Dash)
+	bool IsDashing() const;
+
+	/** World time from which the next dash may start, part of the owner's snapshots. */
+	double GetNextDashTime() const { return NextDashTime; }
+	void SetNextDashTime(double InNextDashTime) { NextDashTime = InNextDashTime; }
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
-public:
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
-	                           FActorComponentTickFunction* ThisTickFunction) override;
+private:
+	void OnDashEnded();
+
+	UPROPERTY(Transient)
+	TObjectPtr<UPCharacterMovementComponent> MovementComponent;
+
+	/** World time at which the cooldown of the last dash is over. Assumes the full duration until the dash actually ends. */
+	double NextDashTime = 0.0;
 };
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PDecorationBatchComponent.h"
+#include "Platformer2D.h"
+
+#include "EngineUtils.h"
+#include "PaperFlipbook.h"
+#include "PaperFlipbookComponent.h"
+
+void UPDecorationBatchComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ResetItems();
+
+	const int32 NumGathered = GatherTaggedDecorations();
+	UE_LOG(LogPlatformer2D, Log, TEXT("%s: %d decorations (%d from tagged actors) with %d flipbooks"),
+		*GetOwner()->GetName(), Decorations.Num(), NumGathered, GetNumFlipbooks());
+}
+
+void UPDecorationBatchComponent::AddDecoration(UPaperFlipbook* Flipbook, const FTransform& Transform, FLinearColor Color)
+{
+	const int32 FlipbookIndex = FindOrAddFlipbook(Flipbook);
+	if (FlipbookIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	FDecoration& Decoration = Decorations.AddDefaulted_GetRef();
+	Decoration.Transform = Transform;
+	Decoration.Location = FVector2D(Transform.GetLocation().X, Transform.GetLocation().Z);
+	Decoration.Color = Color;
+	Decoration.FlipbookIndex = FlipbookIndex;
+	Decoration.Phase = FMath::FRand() * Flipbook->GetTotalDuration();
+}
+
+int32 UPDecorationBatchComponent::GatherTaggedDecorations()
+{
+	const int32 NumBefore = Decorations.Num();
+	TArray<AActor*> TaggedActors;
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		if (*It != GetOwner() && It->ActorHasTag(DecorationTag))
+		{
+			TaggedActors.Add(*It);
+		}
+	}
+
+	for (AActor* Actor : TaggedActors)
+	{
+		TInlineComponentArray<UPaperFlipbookComponent*> Components(Actor);
+		for (const UPaperFlipbookComponent* Component : Components)
+		{
+			AddDecoration(Component->GetFlipbook(), Component->GetComponentTransform(), Component->GetSpriteColor());
+		}
+		Actor->Destroy();
+	}
+	return Decorations.Num() - NumBefore;
+}
+
+void UPDecorationBatchComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	Time += DeltaTime;
+	FVector2D Center;
+	FVector2D Extent;
+	if (!GetCameraView(GetOwner()->GetActorLocation().Y, Center, Extent))
+	{
+		return;
+	}
+
+	Extent += FVector2D(ViewMargin);
+	const FBox2D Area(Center - Extent, Center + Extent);
+	const float RateFalloff = FMath::Max(Extent.Size() - FullRateDistance, 1.f);
+
+	BeginShowItems();
+	for (int32 Index = 0; Index < Decorations.Num(); ++Index)
+	{
+		FDecoration& Decoration = Decorations[Index];
+		if (!Area.IsInside(Decoration.Location))
+		{
+			continue;
+		}
+
+		const FFlipbookFrames& Frames = GetFlipbookFrames(Decoration.FlipbookIndex);
+		if (Time >= Decoration.NextUpdateTime)
+		{
+			Decoration.Frame = Frames.GetFrame(Time + Decoration.Phase);
+
+			const float Distance = FVector2D::Distance(Decoration.Location, Center);
+			Decoration.NextUpdateTime = Time + FMath::Clamp((Distance - FullRateDistance) / RateFalloff, 0.f, 1.f) * MaxUpdateInterval;
+		}
+
+		// Decorations never move
+		ShowItem(Index, Decoration.Transform, Frames.Sprites[Decoration.Frame], Decoration.Color, false);
+	}
+	EndShowItems();
+}
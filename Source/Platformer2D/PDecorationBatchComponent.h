@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PFlipbookBatchComponent.h"
+#include "PDecorationBatchComponent.generated.h"
+
+class UPaperFlipbook;
+
+/**
+ * Animates many decorative flipbooks, like scattered plants, as the instances of one grouped sprite component.
+ *
+ * Decorations are a flat array without components of their own. One tick walks the array once: every decoration's frame
+ * comes from a shared clock plus its own random phase, only decorations inside the camera's view plus ViewMargin get an instance,
+ * and decorations further from the view center switch frames less often.
+ *
+ * Actors tagged with DecorationTag are turned into decorations at begin play, so decorations can be placed as ordinary flipbook actors.
+ */
+UCLASS(ClassGroup=(Paper2D), meta=(BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPDecorationBatchComponent : public UPFlipbookBatchComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Flipbook components of actors with this tag are taken over at begin play, and the actors destroyed. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Decorations)
+	FName DecorationTag = TEXT("Decoration");
+
+	/** Decorations this far outside the view are still shown, so they don't pop in at the edge. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Decorations, meta = (ClampMin = "0"))
+	float ViewMargin = 200.f;
+
+	/** Decorations closer than this to the view center animate at their flipbook's frame rate. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Decorations, meta = (ClampMin = "0"))
+	float FullRateDistance = 600.f;
+
+	/** Time between frame changes at the edge of the shown area, reached linearly from FullRateDistance. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Decorations, meta = (ClampMin = "0"))
+	float MaxUpdateInterval = 0.25f;
+
+	/** Adds a decoration at a world transform, with a random phase. */
+	UFUNCTION(BlueprintCallable, Category = Decorations)
+	void AddDecoration(UPaperFlipbook* Flipbook, const FTransform& Transform, FLinearColor Color = FLinearColor::White);
+
+	/** Takes over the flipbook components of every actor with DecorationTag. @return the number of decorations added */
+	int32 GatherTaggedDecorations();
+
+	int32 GetNumDecorations() const { return Decorations.Num(); }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	struct FDecoration
+	{
+		FTransform Transform;
+		FVector2D Location;
+		FLinearColor Color;
+		int32 FlipbookIndex;
+		/** Seconds added to the shared clock, so neighbours don't animate in lockstep. */
+		float Phase;
+		float NextUpdateTime = 0.f;
+		int32 Frame = INDEX_NONE;
+	};
+
+	TArray<FDecoration> Decorations;
+
+	float Time = 0.f;
+};
@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PEnemyCrowdBenchmarkCommandlet.h"
+
+#include "PCommandletWorld.h"
+#include "PEnemyCrowdComponent.h"
+#include "PTileCollisionSubsystem.h"
+#include "PaperFlipbook.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPEnemyCrowdBenchmark, Log, All);
+
+namespace PEnemyCrowdBenchmark
+{
+	const TCHAR* DefaultPatrolFlipbook = TEXT("/Game/Assets/PlatformerAssets/Knight/Colour2/Outline/120x80_PNGSheets/FB_Knight_Idle.FB_Knight_Idle");
+	const TCHAR* DefaultHopFlipbook = TEXT("/Game/Flipbooks/FB_Player_Run.FB_Player_Run");
+
+	/** Shown area without a player camera, a 1080p screen at one unit per pixel. */
+	const FVector2D ViewExtent(960.f, 540.f);
+
+	struct FSamples
+	{
+		const TCHAR* Category;
+		TArray<double> Microseconds;
+	};
+
+	double Percentile(const TArray<double>& Sorted, double Fraction)
+	{
+		if (Sorted.Num() == 0)
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	}
+
+	UPaperFlipbook* LoadFlipbook(const FString& Params, const TCHAR* Key, const TCHAR* DefaultPath)
+	{
+		FString Path = DefaultPath;
+		FParse::Value(*Params, Key, Path);
+		UPaperFlipbook* Flipbook = LoadObject<UPaperFlipbook>(nullptr, *Path);
+		if (!Flipbook)
+		{
+			UE_LOG(LogPEnemyCrowdBenchmark, Warning, TEXT("Could not load %s, those enemies are simulated without sprites"), *Path);
+		}
+		return Flipbook;
+	}
+}
+
+UPEnemyCrowdBenchmarkCommandlet::UPEnemyCrowdBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPEnemyCrowdBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString MapName = TEXT("/Game/Maps/Map");
+	FParse::Value(*Params, TEXT("Map="), MapName);
+
+	int32 NumEnemies = 10000;
+	FParse::Value(*Params, TEXT("Enemies="), NumEnemies);
+	NumEnemies = FMath::Clamp(NumEnemies, 1, 1000000);
+
+	int32 NumFrames = 600;
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	NumFrames = FMath::Max(NumFrames, 1);
+
+	int32 NumWarmupFrames = 60;
+	FParse::Value(*Params, TEXT("Warmup="), NumWarmupFrames);
+	NumWarmupFrames = FMath::Max(NumWarmupFrames, 0);
+
+	float FPS = 60.f;
+	FParse::Value(*Params, TEXT("FPS="), FPS);
+	const float DeltaTime = 1.f / FMath::Max(FPS, 1.f);
+
+	int32 Seed = 1337;
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	double Budget = 2000.0;
+	FParse::Value(*Params, TEXT("Budget="), Budget);
+
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("EnemyCrowdBenchmark-%s.csv"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	UWorld* World = PCommandletWorld::Create(MapName);
+	if (!World)
+	{
+		return 1;
+	}
+
+	UPTileCollisionSubsystem* TileCollision = World->GetSubsystem<UPTileCollisionSubsystem>();
+	if (TileCollision && !TileCollision->HasGrid())
+	{
+		TileCollision->Rebuild();
+	}
+	if (!TileCollision || !TileCollision->HasGrid())
+	{
+		UE_LOG(LogPEnemyCrowdBenchmark, Error, TEXT("%s has no tile collision for the enemies to walk on"), *MapName);
+		PCommandletWorld::Destroy(World);
+		return 1;
+	}
+	const FBox2D GridBounds = TileCollision->GetBounds();
+
+	FPEnemyCrowdType Patrol;
+	Patrol.Name = TEXT("Knight");
+	Patrol.Behavior = EPEnemyCrowdBehavior::Patrol;
+	Patrol.GroundFlipbook = PEnemyCrowdBenchmark::LoadFlipbook(Params, TEXT("PatrolFlipbook="), PEnemyCrowdBenchmark::DefaultPatrolFlipbook);
+
+	FPEnemyCrowdType Hop;
+	Hop.Name = TEXT("Frog");
+	Hop.Behavior = EPEnemyCrowdBehavior::Hop;
+	Hop.GroundFlipbook = PEnemyCrowdBenchmark::LoadFlipbook(Params, TEXT("HopFlipbook="), PEnemyCrowdBenchmark::DefaultHopFlipbook);
+
+	AActor* Host = World->SpawnActor<AActor>();
+	UPEnemyCrowdComponent* Crowd = NewObject<UPEnemyCrowdComponent>(Host, TEXT("EnemyCrowd"));
+	Crowd->Types = { Patrol, Hop };
+	Crowd->FallbackViewArea = FBox2D(GridBounds.GetCenter() - PEnemyCrowdBenchmark::ViewExtent, GridBounds.GetCenter() + PEnemyCrowdBenchmark::ViewExtent);
+	// Ticked by hand below so its cost can be separated from the world tick
+	Crowd->PrimaryComponentTick.bStartWithTickEnabled = false;
+	Crowd->RegisterComponent();
+
+	FMath::RandInit(Seed);
+	FRandomStream Random(Seed);
+	const int32 NumPatrolling = Crowd->AddEnemiesInArea(0, GridBounds, NumEnemies / 2, Random);
+	const int32 NumHopping = Crowd->AddEnemiesInArea(1, GridBounds, NumEnemies - NumEnemies / 2, Random);
+	UE_LOG(LogPEnemyCrowdBenchmark, Display, TEXT("Benchmarking %d patrolling and %d hopping enemies on %s for %d frames at %.0f FPS"),
+		NumPatrolling, NumHopping, *MapName, NumFrames, FPS);
+
+	PEnemyCrowdBenchmark::FSamples Samples[] = { { TEXT("Tick") }, { TEXT("Simulate") }, { TEXT("Render") }, { TEXT("EndOfFrame") } };
+	int64 TotalShown = 0;
+	for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; ++Frame)
+	{
+		FApp::SetDeltaTime(DeltaTime);
+		FApp::SetCurrentTime(FApp::GetCurrentTime() + DeltaTime);
+		World->Tick(LEVELTICK_All, DeltaTime);
+		// Flushes what the world tick left dirty, so only the crowd's own updates are sent below
+		World->SendAllEndOfFrameUpdates();
+
+		// The instance changes the crowd makes are only sent to the render state at the end of the frame, which is part of its cost
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Crowd->TickComponent(DeltaTime, LEVELTICK_All, &Crowd->PrimaryComponentTick);
+		const uint64 TickEndCycles = FPlatformTime::Cycles64();
+		World->SendAllEndOfFrameUpdates();
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+		++GFrameCounter;
+
+		if (Frame < NumWarmupFrames)
+		{
+			continue;
+		}
+		Samples[0].Microseconds.Add(FPlatformTime::ToMilliseconds64(EndCycles - StartCycles) * 1000.0);
+		Samples[1].Microseconds.Add(Crowd->GetLastSimulateMicroseconds());
+		Samples[2].Microseconds.Add(Crowd->GetLastRenderMicroseconds());
+		Samples[3].Microseconds.Add(FPlatformTime::ToMilliseconds64(EndCycles - TickEndCycles) * 1000.0);
+		TotalShown += Crowd->GetNumShown();
+	}
+
+	FString Csv = TEXT("Category,Enemies,Frames,MeanShown,MeanUs,P50Us,P99Us,MaxUs\n");
+	for (PEnemyCrowdBenchmark::FSamples& Entry : Samples)
+	{
+		TArray<double>& Sorted = Entry.Microseconds;
+		Sorted.Sort();
+		double Sum = 0.0;
+		for (const double Sample : Sorted)
+		{
+			Sum += Sample;
+		}
+		Csv += FString::Printf(TEXT("%s,%d,%d,%.1f,%.3f,%.3f,%.3f,%.3f\n"),
+			Entry.Category, Crowd->GetNumEnemies(), NumFrames, static_cast<double>(TotalShown) / NumFrames, Sum / NumFrames,
+			PEnemyCrowdBenchmark::Percentile(Sorted, 0.5), PEnemyCrowdBenchmark::Percentile(Sorted, 0.99), Sorted.Last());
+	}
+
+	const TArray<double>& SortedTicks = Samples[0].Microseconds;
+	const double P99 = PEnemyCrowdBenchmark::Percentile(SortedTicks, 0.99);
+	UE_LOG(LogPEnemyCrowdBenchmark, Display, TEXT("Updating %d enemies took %.1fus at p50 and %.1fus at p99 (%.1fus simulating, %.1fus rendering, %.1fus sending the render state at p99)"),
+		Crowd->GetNumEnemies(), PEnemyCrowdBenchmark::Percentile(SortedTicks, 0.5), P99,
+		PEnemyCrowdBenchmark::Percentile(Samples[1].Microseconds, 0.99), PEnemyCrowdBenchmark::Percentile(Samples[2].Microseconds, 0.99),
+		PEnemyCrowdBenchmark::Percentile(Samples[3].Microseconds, 0.99));
+	const bool bOverBudget = P99 > Budget;
+	if (bOverBudget)
+	{
+		UE_LOG(LogPEnemyCrowdBenchmark, Error, TEXT("Crowd update p99 of %.1fus is over the %.0fus budget"), P99, Budget);
+	}
+
+	Host->Destroy();
+	PCommandletWorld::Destroy(World);
+
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(OutputPath));
+	if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+	{
+		UE_LOG(LogPEnemyCrowdBenchmark, Error, TEXT("Failed to write %s"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogPEnemyCrowdBenchmark, Display, TEXT("Wrote %s"), *OutputPath);
+	// The CSV is still written so an over budget run can be looked at
+	return bOverBudget ? 1 : 0;
+}
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PEnemyCrowdBenchmarkCommandlet.generated.h"
+
+/**
+ * Headless enemy crowd benchmark.
+ *
+ * Loads a map, scatters N enemies, half patrolling and half hopping, over its tile collision grid and writes the
+ * game thread cost of the crowd's update per frame to a CSV file. The update is the crowd's tick plus the end of frame
+ * update that sends its instance changes to the render state, its p99 is checked against Budget microseconds and the commandlet returns 1 if it is over. Without a player camera, the enemies inside a screen sized area at the center of the grid are shown.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=PEnemyCrowdBenchmark -nullrhi -unattended
+ *     [-Map=/Game/Maps/Map] [-Enemies=10000] [-Frames=600] [-Warmup=60] [-FPS=60] [-Seed=1337] [-Budget=2000]
+ *     [-PatrolFlipbook=<path>] [-HopFlipbook=<path>] [-Output=<csv path>]
+ */
+UCLASS()
+class PLATFORMER2D_API UPEnemyCrowdBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPEnemyCrowdBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,480 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PEnemyCrowdComponent.h"
+#include "Platformer2D.h"
+#include "PActorPoolSubsystem.h"
+#include "PTileCollisionSubsystem.h"
+
+#include "Async/ParallelFor.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "UObject/UObjectIterator.h"
+
+namespace PEnemyCrowd
+{
+	/** Gap under an enemy's box that still counts as standing on the ground. */
+	constexpr float GroundTolerance = 1.f;
+	/** Probes are a little thinner than the box, so the ground under it isn't found as a wall and the other way round. */
+	constexpr float ProbeThickness = 0.9f;
+
+	void ReleaseActor(UPActorPoolSubsystem* ActorPool, AActor* Actor)
+	{
+		if (ActorPool)
+		{
+			ActorPool->Release(Actor);
+		}
+		else
+		{
+			Actor->Destroy();
+		}
+	}
+
+	static FAutoConsoleCommandWithWorld ReportCommand(
+		TEXT("p2d.EnemyCrowd.Report"),
+		TEXT("Logs the enemies of every enemy crowd by state and the cost of its last update."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			for (TObjectIterator<UPEnemyCrowdComponent> It; It; ++It)
+			{
+				if (It->GetWorld() == World)
+				{
+					It->LogReport();
+				}
+			}
+		}));
+}
+
+void UPEnemyCrowdComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ResetItems();
+	PlaneY = GetOwner()->GetActorLocation().Y;
+
+	if (Types.Num() > MAX_uint8 + 1)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s: only the first %d of %d enemy types are used"), *GetOwner()->GetName(), MAX_uint8 + 1, Types.Num());
+	}
+
+	UPActorPoolSubsystem* ActorPool = GetWorld()->GetSubsystem<UPActorPoolSubsystem>();
+	TypeParams.Reset();
+	for (int32 TypeIndex = 0; TypeIndex < FMath::Min(Types.Num(), MAX_uint8 + 1); ++TypeIndex)
+	{
+		const FPEnemyCrowdType& Type = Types[TypeIndex];
+		FTypeParams& Params = TypeParams.AddDefaulted_GetRef();
+		Params.Behavior = Type.Behavior;
+		Params.HalfExtent = FVector2f(Type.HalfExtent.X, Type.HalfExtent.Y);
+		Params.Speed = Type.Speed;
+		Params.HopVelocity = Type.HopVelocity;
+		Params.HopInterval = Type.HopInterval;
+		Params.GroundAnimation = FindOrAddFlipbook(Type.GroundFlipbook);
+		Params.AirAnimation = FindOrAddFlipbook(Type.AirFlipbook);
+		Params.bPromotable = Type.ActorClass != nullptr && MaxPromoted > 0;
+
+		if (Params.bPromotable)
+		{
+			ReservedClasses.AddUnique(Type.ActorClass);
+		}
+	}
+
+	// Crowds sharing an actor class each get their own MaxPromoted actors, and never recycle each other's
+	if (ActorPool)
+	{
+		for (const TSubclassOf<AActor>& ActorClass : ReservedClasses)
+		{
+			ActorPool->Reserve(ActorClass, MaxPromoted);
+		}
+	}
+
+	FRandomStream Random(GetFName());
+	const FVector2D Origin(GetOwner()->GetActorLocation().X, GetOwner()->GetActorLocation().Z);
+	for (const FPEnemyCrowdSpawnArea& SpawnArea : SpawnAreas)
+	{
+		AddEnemiesInArea(SpawnArea.Type, SpawnArea.Area.ShiftBy(Origin), SpawnArea.Count, Random);
+	}
+	UE_LOG(LogPlatformer2D, Log, TEXT("%s: %d enemies of %d types"), *GetOwner()->GetName(), Positions.Num(), TypeParams.Num());
+}
+
+void UPEnemyCrowdComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UPActorPoolSubsystem* ActorPool = GetWorld()->GetSubsystem<UPActorPoolSubsystem>();
+	for (const FPromotedEnemy& Entry : Promoted)
+	{
+		if (AActor* Actor = Entry.Actor.Get())
+		{
+			PEnemyCrowd::ReleaseActor(ActorPool, Actor);
+		}
+	}
+	DEC_DWORD_STAT_BY(STAT_EnemyCrowd_Promoted, Promoted.Num());
+	DEC_DWORD_STAT_BY(STAT_EnemyCrowd_Enemies, Positions.Num());
+	Promoted.Reset();
+
+	if (ActorPool)
+	{
+		for (const TSubclassOf<AActor>& ActorClass : ReservedClasses)
+		{
+			ActorPool->Unreserve(ActorClass, MaxPromoted);
+		}
+	}
+	ReservedClasses.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 UPEnemyCrowdComponent::AddEnemy(int32 Type, const FVector& Location)
+{
+	if (!TypeParams.IsValidIndex(Type))
+	{
+		return INDEX_NONE;
+	}
+
+	const FTypeParams& Params = TypeParams[Type];
+	const float AnimationDuration = Params.GroundAnimation != INDEX_NONE ? GetFlipbookFrames(Params.GroundAnimation).GetDuration() : 0.f;
+
+	const int32 Index = Positions.Add(FVector2f(Location.X, Location.Z));
+	Velocities.Add(FVector2f::ZeroVector);
+	EnemyTypes.Add(static_cast<uint8>(Type));
+	States.Add(EEnemyState::Air);
+	Facings.Add(FMath::RandBool() ? int8(1) : int8(-1));
+	HopTimers.Add(FMath::FRand() * Params.HopInterval);
+	AnimationPhases.Add(FMath::FRand() * AnimationDuration);
+	AnimationFrames.Add(0);
+	INC_DWORD_STAT(STAT_EnemyCrowd_Enemies);
+	return Index;
+}
+
+int32 UPEnemyCrowdComponent::AddEnemiesInArea(int32 Type, const FBox2D& Area, int32 Count, FRandomStream& Random)
+{
+	if (!TypeParams.IsValidIndex(Type) || !Area.bIsValid)
+	{
+		return 0;
+	}
+
+	const UPTileCollisionSubsystem* TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+	int32 NumAdded = 0;
+	// Areas that are mostly wall get fewer enemies rather than an endless search
+	for (int32 Attempt = 0; Attempt < Count * 4 && NumAdded < Count; ++Attempt)
+	{
+		const FVector Location(Random.FRandRange(Area.Min.X, Area.Max.X), PlaneY, Random.FRandRange(Area.Min.Y, Area.Max.Y));
+		if (TileCollision && TileCollision->IsSolid(Location))
+		{
+			continue;
+		}
+		AddEnemy(Type, Location);
+		++NumAdded;
+	}
+	return NumAdded;
+}
+
+void UPEnemyCrowdComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	AnimationTime += DeltaTime;
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_EnemyCrowd_Simulate);
+		TRACE_CPUPROFILER_EVENT_SCOPE(UPEnemyCrowdComponent::Simulate);
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		UpdatePromotions();
+
+		const UPTileCollisionSubsystem* TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+		if (TileCollision && TileCollision->HasGrid())
+		{
+			const float GravityZ = GetWorld()->GetGravityZ() * GravityScale;
+			const int32 NumEnemies = Positions.Num();
+			const int32 NumBatches = FMath::DivideAndRoundUp(NumEnemies, BatchSize);
+			ParallelFor(NumBatches, [this, NumEnemies, DeltaTime, GravityZ, TileCollision](int32 Batch)
+			{
+				const int32 End = FMath::Min((Batch + 1) * BatchSize, NumEnemies);
+				for (int32 Index = Batch * BatchSize; Index < End; ++Index)
+				{
+					SimulateEnemy(Index, DeltaTime, GravityZ, *TileCollision);
+				}
+			});
+		}
+		LastSimulateMicroseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0;
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_EnemyCrowd_Render);
+		TRACE_CPUPROFILER_EVENT_SCOPE(UPEnemyCrowdComponent::Render);
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		UpdateInstances();
+		LastRenderMicroseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0;
+	}
+}
+
+void UPEnemyCrowdComponent::SimulateEnemy(int32 Index, float DeltaTime, float GravityZ, const UPTileCollisionSubsystem& TileCollision)
+{
+	EEnemyState& State = States[Index];
+	if (State == EEnemyState::Promoted)
+	{
+		return;
+	}
+
+	FVector2f& Position = Positions[Index];
+	if (!TileCollision.Contains(FVector(Position.X, 0.f, Position.Y)))
+	{
+		State = EEnemyState::Dormant;
+		return;
+	}
+	if (State == EEnemyState::Dormant)
+	{
+		State = EEnemyState::Air;
+	}
+
+	const FTypeParams& Type = TypeParams[EnemyTypes[Index]];
+	FVector2f& Velocity = Velocities[Index];
+	int8& Facing = Facings[Index];
+	const float HalfX = Type.HalfExtent.X;
+	const float HalfZ = Type.HalfExtent.Y;
+	float Distance;
+
+	if (State == EEnemyState::Ground
+		&& !TileCollision.Probe(FVector(Position.X, 0.f, Position.Y), EPTileProbeDirection::Down, HalfZ + PEnemyCrowd::GroundTolerance, HalfX * PEnemyCrowd::ProbeThickness, Distance))
+	{
+		State = EEnemyState::Air;
+	}
+
+	if (State == EEnemyState::Ground)
+	{
+		if (Type.Behavior == EPEnemyCrowdBehavior::Patrol)
+		{
+			// Turns around instead of walking off a ledge
+			const FVector GroundAhead(Position.X + Facing * (HalfX + PEnemyCrowd::GroundTolerance), 0.f, Position.Y - HalfZ - PEnemyCrowd::GroundTolerance);
+			if (!TileCollision.IsSolid(GroundAhead))
+			{
+				Facing = static_cast<int8>(-Facing);
+			}
+			Velocity = FVector2f(Facing * Type.Speed, 0.f);
+		}
+		else
+		{
+			Velocity = FVector2f::ZeroVector;
+			HopTimers[Index] -= DeltaTime;
+			if (HopTimers[Index] <= 0.f)
+			{
+				HopTimers[Index] = Type.HopInterval;
+				Velocity = FVector2f(Facing * Type.Speed, Type.HopVelocity);
+				State = EEnemyState::Air;
+			}
+		}
+	}
+	else
+	{
+		Velocity.Y = FMath::Max(Velocity.Y + GravityZ * DeltaTime, -MaxFallSpeed);
+	}
+
+	const float DeltaX = Velocity.X * DeltaTime;
+	if (DeltaX != 0.f)
+	{
+		const float Direction = DeltaX > 0.f ? 1.f : -1.f;
+		if (TileCollision.Probe(FVector(Position.X, 0.f, Position.Y), DeltaX > 0.f ? EPTileProbeDirection::Right : EPTileProbeDirection::Left,
+			HalfX + FMath::Abs(DeltaX), HalfZ * PEnemyCrowd::ProbeThickness, Distance))
+		{
+			// Walls turn every behavior around
+			Position.X += Direction * FMath::Max(Distance - HalfX, 0.f);
+			Velocity.X = 0.f;
+			Facing = DeltaX > 0.f ? int8(-1) : int8(1);
+		}
+		else
+		{
+			Position.X += DeltaX;
+		}
+	}
+
+	const float DeltaZ = Velocity.Y * DeltaTime;
+	if (DeltaZ != 0.f)
+	{
+		const float Direction = DeltaZ > 0.f ? 1.f : -1.f;
+		if (TileCollision.Probe(FVector(Position.X, 0.f, Position.Y), DeltaZ > 0.f ? EPTileProbeDirection::Up : EPTileProbeDirection::Down,
+			HalfZ + FMath::Abs(DeltaZ), HalfX * PEnemyCrowd::ProbeThickness, Distance))
+		{
+			Position.Y += Direction * FMath::Max(Distance - HalfZ, 0.f);
+			Velocity.Y = 0.f;
+			if (DeltaZ < 0.f)
+			{
+				State = EEnemyState::Ground;
+			}
+		}
+		else
+		{
+			Position.Y += DeltaZ;
+		}
+	}
+
+	const int32 AnimationIndex = Type.GetAnimation(State);
+	if (AnimationIndex != INDEX_NONE)
+	{
+		AnimationFrames[Index] = static_cast<uint16>(GetFlipbookFrames(AnimationIndex).GetFrame(AnimationTime + AnimationPhases[Index]));
+	}
+}
+
+void UPEnemyCrowdComponent::UpdatePromotions()
+{
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	UPActorPoolSubsystem* ActorPool = GetWorld()->GetSubsystem<UPActorPoolSubsystem>();
+	const FVector PlayerLocation = Player ? Player->GetActorLocation() : FVector::ZeroVector;
+	const FVector2f PlayerPosition(PlayerLocation.X, PlayerLocation.Z);
+
+	for (int32 Slot = Promoted.Num() - 1; Slot >= 0; --Slot)
+	{
+		const FPromotedEnemy Entry = Promoted[Slot];
+		AActor* Actor = Entry.Actor.Get();
+		if (!IsValid(Actor) || Actor->IsHidden())
+		{
+			Promoted.RemoveAtSwap(Slot, 1, false);
+			DEC_DWORD_STAT(STAT_EnemyCrowd_Promoted);
+			RemoveEnemy(Entry.Enemy);
+			continue;
+		}
+
+		const FVector Location = Actor->GetActorLocation();
+		const FVector2f Position(Location.X, Location.Z);
+		if (Player && FVector2f::DistSquared(Position, PlayerPosition) <= FMath::Square(DemotionDistance))
+		{
+			continue;
+		}
+
+		// The crowd picks up where the actor left off
+		const FVector Velocity = Actor->GetVelocity();
+		Positions[Entry.Enemy] = Position;
+		Velocities[Entry.Enemy] = FVector2f(Velocity.X, Velocity.Z);
+		if (Velocity.X != 0.f)
+		{
+			Facings[Entry.Enemy] = Velocity.X > 0.f ? int8(1) : int8(-1);
+		}
+		States[Entry.Enemy] = EEnemyState::Air;
+
+		Promoted.RemoveAtSwap(Slot, 1, false);
+		DEC_DWORD_STAT(STAT_EnemyCrowd_Promoted);
+		PEnemyCrowd::ReleaseActor(ActorPool, Actor);
+	}
+
+	if (!Player || !ActorPool || Promoted.Num() >= MaxPromoted)
+	{
+		return;
+	}
+
+	const float PromotionDistanceSquared = FMath::Square(PromotionDistance);
+	for (int32 Index = 0; Index < Positions.Num() && Promoted.Num() < MaxPromoted; ++Index)
+	{
+		const EEnemyState State = States[Index];
+		if (State != EEnemyState::Promoted && State != EEnemyState::Dormant && TypeParams[EnemyTypes[Index]].bPromotable
+			&& FVector2f::DistSquared(Positions[Index], PlayerPosition) <= PromotionDistanceSquared
+			&& !Promote(Index))
+		{
+			break;
+		}
+	}
+}
+
+bool UPEnemyCrowdComponent::Promote(int32 Index)
+{
+	const FVector2f& Position = Positions[Index];
+	const FTransform Transform(FRotator(0.f, Facings[Index] > 0 ? 0.f : -180.f, 0.f), FVector(Position.X, PlaneY, Position.Y));
+	// Recycling would take an actor another crowd, or this one, still simulates an enemy with
+	AActor* Actor = GetWorld()->GetSubsystem<UPActorPoolSubsystem>()->Acquire(Types[EnemyTypes[Index]].ActorClass, Transform, false);
+	if (!Actor)
+	{
+		return false;
+	}
+
+	if (ACharacter* Character = Cast<ACharacter>(Actor))
+	{
+		Character->GetCharacterMovement()->Velocity = FVector(Velocities[Index].X, 0.f, Velocities[Index].Y);
+	}
+	States[Index] = EEnemyState::Promoted;
+	Promoted.Add({ Index, Actor });
+	INC_DWORD_STAT(STAT_EnemyCrowd_Promoted);
+	return true;
+}
+
+void UPEnemyCrowdComponent::RemoveEnemy(int32 Index)
+{
+	const int32 LastIndex = Positions.Num() - 1;
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	EnemyTypes.RemoveAtSwap(Index, 1, false);
+	States.RemoveAtSwap(Index, 1, false);
+	Facings.RemoveAtSwap(Index, 1, false);
+	HopTimers.RemoveAtSwap(Index, 1, false);
+	AnimationPhases.RemoveAtSwap(Index, 1, false);
+	AnimationFrames.RemoveAtSwap(Index, 1, false);
+	DEC_DWORD_STAT(STAT_EnemyCrowd_Enemies);
+
+	// The last enemy moved into the hole
+	for (FPromotedEnemy& Entry : Promoted)
+	{
+		if (Entry.Enemy == LastIndex)
+		{
+			Entry.Enemy = Index;
+		}
+	}
+}
+
+void UPEnemyCrowdComponent::UpdateInstances()
+{
+	FBox2D Area;
+	const bool bHasArea = GetShownArea(Area);
+
+	BeginShowItems();
+	for (int32 Index = 0; bHasArea && Index < Positions.Num(); ++Index)
+	{
+		const FVector2f& Position = Positions[Index];
+		if (States[Index] == EEnemyState::Promoted || !Area.IsInside(FVector2D(Position.X, Position.Y)))
+		{
+			continue;
+		}
+
+		const FTransform Transform(FRotator(0.f, Facings[Index] > 0 ? 0.f : -180.f, 0.f), FVector(Position.X, PlaneY, Position.Y));
+		ShowItem(Index, Transform, GetEnemySprite(Index), FLinearColor::White, true);
+	}
+	EndShowItems();
+}
+
+bool UPEnemyCrowdComponent::GetShownArea(FBox2D& OutArea) const
+{
+	FVector2D Center;
+	FVector2D Extent;
+	if (!GetCameraView(PlaneY, Center, Extent))
+	{
+		OutArea = FallbackViewArea.ExpandBy(ViewMargin);
+		return FallbackViewArea.bIsValid;
+	}
+
+	Extent += FVector2D(ViewMargin);
+	OutArea = FBox2D(Center - Extent, Center + Extent);
+	return true;
+}
+
+UPaperSprite* UPEnemyCrowdComponent::GetEnemySprite(int32 Index) const
+{
+	const int32 AnimationIndex = TypeParams[EnemyTypes[Index]].GetAnimation(States[Index]);
+	if (AnimationIndex == INDEX_NONE)
+	{
+		return nullptr;
+	}
+	// The frame may still be from the other animation of the type, e.g. right after a demotion
+	const TArray<UPaperSprite*>& Sprites = GetFlipbookFrames(AnimationIndex).Sprites;
+	return Sprites[AnimationFrames[Index] % Sprites.Num()];
+}
+
+void UPEnemyCrowdComponent::LogReport() const
+{
+	int32 NumByState[4] = {};
+	for (const EEnemyState State : States)
+	{
+		++NumByState[static_cast<int32>(State)];
+	}
+	UE_LOG(LogPlatformer2D, Display, TEXT("%s: %d enemies (%d on the ground, %d in the air, %d dormant, %d promoted), %d shown, last update %.0fus simulating and %.0fus rendering"),
+		*GetOwner()->GetName(), Positions.Num(),
+		NumByState[static_cast<int32>(EEnemyState::Ground)], NumByState[static_cast<int32>(EEnemyState::Air)],
+		NumByState[static_cast<int32>(EEnemyState::Dormant)], NumByState[static_cast<int32>(EEnemyState::Promoted)],
+		GetNumShown(), LastSimulateMicroseconds, LastRenderMicroseconds);
+}
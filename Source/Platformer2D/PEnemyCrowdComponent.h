@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PFlipbookBatchComponent.h"
+#include "PEnemyCrowdComponent.generated.h"
+
+class UPaperFlipbook;
+class UPaperSprite;
+class UPTileCollisionSubsystem;
+
+UENUM()
+enum class EPEnemyCrowdBehavior : uint8
+{
+	/** Walks and turns around at walls and ledges. */
+	Patrol,
+	/** Hops forward every HopInterval and turns around at walls. */
+	Hop
+};
+
+/** One kind of enemy of a crowd, e.g. a patrolling Knight or a hopping Ninja Frog. */
+USTRUCT()
+struct PLATFORMER2D_API FPEnemyCrowdType
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = Enemy)
+	FName Name;
+
+	UPROPERTY(EditAnywhere, Category = Enemy)
+	EPEnemyCrowdBehavior Behavior = EPEnemyCrowdBehavior::Patrol;
+
+	UPROPERTY(EditAnywhere, Category = Enemy)
+	UPaperFlipbook* GroundFlipbook = nullptr;
+
+	/** Shown while in the air, the ground flipbook keeps playing while unset. */
+	UPROPERTY(EditAnywhere, Category = Enemy)
+	UPaperFlipbook* AirFlipbook = nullptr;
+
+	/** Half size of the enemy's box on the X/Z plane, collides with the tile grid. */
+	UPROPERTY(EditAnywhere, Category = Enemy)
+	FVector2D HalfExtent = FVector2D(16.f, 16.f);
+
+	/** Walking speed of a patrol, horizontal speed of a hop. */
+	UPROPERTY(EditAnywhere, Category = Enemy, meta = (ClampMin = "0"))
+	float Speed = 80.f;
+
+	UPROPERTY(EditAnywhere, Category = Enemy, meta = (ClampMin = "0"))
+	float HopVelocity = 450.f;
+
+	/** Time on the ground between two hops. */
+	UPROPERTY(EditAnywhere, Category = Enemy, meta = (ClampMin = "0"))
+	float HopInterval = 1.2f;
+
+	/** Takes over enemies close to the player, from the world's actor pool. Enemies of a type without one are never promoted. */
+	UPROPERTY(EditAnywhere, Category = Enemy)
+	TSubclassOf<AActor> ActorClass;
+};
+
+/** Enemies scattered over an area at begin play. */
+USTRUCT()
+struct PLATFORMER2D_API FPEnemyCrowdSpawnArea
+{
+	GENERATED_BODY()
+
+	/** Index into the crowd's Types. */
+	UPROPERTY(EditAnywhere, Category = Spawn, meta = (ClampMin = "0"))
+	int32 Type = 0;
+
+	/** Area on the X/Z plane, relative to the owner. */
+	UPROPERTY(EditAnywhere, Category = Spawn)
+	FBox2D Area = FBox2D(FVector2D(-500.f, 0.f), FVector2D(500.f, 500.f));
+
+	UPROPERTY(EditAnywhere, Category = Spawn, meta = (ClampMin = "0"))
+	int32 Count = 10;
+};
+
+/**
+ * Thousands of simple enemies without an actor each, drawn as the instances of one grouped sprite component.
+ *
+ * Enemy state lives in parallel arrays, one per field, and is updated by ParallelFor against the static tile collision grid.
+ * Enemies outside the grid, e.g. in a tile map chunk that is not streamed in, stay dormant until it covers them again.
+ * Only enemies inside the camera's view plus ViewMargin get an instance.
+ *
+ * The few enemies closer than PromotionDistance to the player are handed to an actor of their type's ActorClass
+ * for full interaction, and taken back once further than DemotionDistance. An actor that is destroyed or hidden
+ * (e.g. released back to its pool) kills its enemy.
+ * p2d.EnemyCrowd.Report logs the enemies of every crowd and the cost of its last update.
+ */
+UCLASS(ClassGroup=(Paper2D), meta=(BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPEnemyCrowdComponent : public UPFlipbookBatchComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = Crowd)
+	TArray<FPEnemyCrowdType> Types;
+
+	UPROPERTY(EditAnywhere, Category = Crowd)
+	TArray<FPEnemyCrowdSpawnArea> SpawnAreas;
+
+	/** Multiplies the world's gravity. */
+	UPROPERTY(EditAnywhere, Category = Crowd)
+	float GravityScale = 2.f;
+
+	UPROPERTY(EditAnywhere, Category = Crowd, meta = (ClampMin = "0"))
+	float MaxFallSpeed = 1000.f;
+
+	/** Enemies per ParallelFor task. */
+	UPROPERTY(EditAnywhere, Category = Crowd, meta = (ClampMin = "1"))
+	int32 BatchSize = 512;
+
+	/** Enemies this far outside the view still get an instance, so they don't pop in at the edge. */
+	UPROPERTY(EditAnywhere, Category = Crowd, meta = (ClampMin = "0"))
+	float ViewMargin = 200.f;
+
+	/** Area shown without a player camera, e.g. in headless benchmarks. Nothing is shown while invalid. */
+	UPROPERTY(EditAnywhere, Category = Crowd)
+	FBox2D FallbackViewArea = FBox2D(ForceInit);
+
+	/** Enemies closer than this to the player are handed to an actor. */
+	UPROPERTY(EditAnywhere, Category = Promotion, meta = (ClampMin = "0"))
+	float PromotionDistance = 500.f;
+
+	/** Promoted enemies go back to the crowd once further than this, should be larger than PromotionDistance. */
+	UPROPERTY(EditAnywhere, Category = Promotion, meta = (ClampMin = "0"))
+	float DemotionDistance = 700.f;
+
+	UPROPERTY(EditAnywhere, Category = Promotion, meta = (ClampMin = "0"))
+	int32 MaxPromoted = 8;
+
+	/** Adds an enemy of Types[Type] with its center at Location. @return its index, INDEX_NONE for an unknown type */
+	int32 AddEnemy(int32 Type, const FVector& Location);
+
+	/** Scatters Count enemies over free cells of a world space area on the X/Z plane. @return the number added */
+	int32 AddEnemiesInArea(int32 Type, const FBox2D& Area, int32 Count, FRandomStream& Random);
+
+	int32 GetNumEnemies() const { return Positions.Num(); }
+	int32 GetNumPromoted() const { return Promoted.Num(); }
+
+	/** Cost of the parts of the last tick on the game thread, in microseconds. */
+	double GetLastSimulateMicroseconds() const { return LastSimulateMicroseconds; }
+	double GetLastRenderMicroseconds() const { return LastRenderMicroseconds; }
+
+	void LogReport() const;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	enum class EEnemyState : uint8
+	{
+		Ground,
+		Air,
+		/** Outside the tile grid, not simulated. */
+		Dormant,
+		/** Simulated by its actor. */
+		Promoted
+	};
+
+	/** What the parallel update needs of an FPEnemyCrowdType. */
+	struct FTypeParams
+	{
+		EPEnemyCrowdBehavior Behavior;
+		FVector2f HalfExtent;
+		float Speed;
+		float HopVelocity;
+		float HopInterval;
+		int32 GroundAnimation;
+		int32 AirAnimation;
+		bool bPromotable;
+
+		int32 GetAnimation(EEnemyState State) const { return State == EEnemyState::Air && AirAnimation != INDEX_NONE ? AirAnimation : GroundAnimation; }
+	};
+
+	struct FPromotedEnemy
+	{
+		int32 Enemy;
+		TWeakObjectPtr<AActor> Actor;
+	};
+
+	/** Moves one enemy. Only touches that enemy's elements, so any number of them can run at once. */
+	void SimulateEnemy(int32 Index, float DeltaTime, float GravityZ, const UPTileCollisionSubsystem& TileCollision);
+
+	void UpdatePromotions();
+	/** @return false if no actor was free, the pool is then at this crowd's share of its cap */
+	bool Promote(int32 Index);
+	void RemoveEnemy(int32 Index);
+
+	void UpdateInstances();
+	/** Shown area on the X/Z plane, ViewMargin included. @return false without a player camera or FallbackViewArea */
+	bool GetShownArea(FBox2D& OutArea) const;
+	UPaperSprite* GetEnemySprite(int32 Index) const;
+
+	TArray<FTypeParams> TypeParams;
+
+	// Enemy state, one element per enemy in every array
+	/** Center on the X/Z plane. */
+	TArray<FVector2f> Positions;
+	TArray<FVector2f> Velocities;
+	TArray<uint8> EnemyTypes;
+	TArray<EEnemyState> States;
+	/** 1 facing +X, -1 facing -X. */
+	TArray<int8> Facings;
+	/** Time left until the next hop. */
+	TArray<float> HopTimers;
+	/** Seconds added to the shared animation clock, so neighbours don't animate in lockstep. */
+	TArray<float> AnimationPhases;
+	TArray<uint16> AnimationFrames;
+
+	TArray<FPromotedEnemy> Promoted;
+	/** Actor classes this crowd reserved MaxPromoted actors of in the pool. */
+	UPROPERTY(Transient)
+	TArray<TSubclassOf<AActor>> ReservedClasses;
+
+	/** Y of every enemy, the owner's at begin play. */
+	float PlaneY = 0.f;
+	float AnimationTime = 0.f;
+	double LastSimulateMicroseconds = 0.0;
+	double LastRenderMicroseconds = 0.0;
+};
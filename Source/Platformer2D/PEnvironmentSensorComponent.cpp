@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PEnvironmentSensorComponent.h"
+#include "Platformer2D.h"
+#include "PTileCollisionSubsystem.h"
+
+#include "Components/CapsuleComponent.h"
+#include "DrawDebugHelpers.h"
+
+namespace PEnvironmentSensor
+{
+	/** Trace user data is the sample id above the probe index. */
+	constexpr uint32 ProbeBits = 3;
+	constexpr uint32 ProbeMask = (1u << ProbeBits) - 1;
+	constexpr uint32 SampleIdMask = MAX_uint32 >> ProbeBits;
+	static_assert(static_cast<uint32>(EPEnvironmentProbe::Num) <= ProbeMask + 1, "Probe indices must fit into ProbeBits");
+}
+
+FPEnvironmentSensorState::FPEnvironmentSensorState()
+{
+	for (float& Distance : Distances)
+	{
+		Distance = -1.f;
+	}
+}
+
+bool FPEnvironmentSensorState::IsAtLedge(float Facing) const
+{
+	return IsBlocked(EPEnvironmentProbe::Ground) && !IsBlocked(Facing >= 0.f ? EPEnvironmentProbe::GroundAheadRight : EPEnvironmentProbe::GroundAheadLeft);
+}
+
+bool FPEnvironmentSensorState::GetWallHit(float Facing, FHitResult& OutHit) const
+{
+	const float Direction = Facing >= 0.f ? 1.f : -1.f;
+	const float Distance = GetDistance(Direction > 0.f ? EPEnvironmentProbe::WallRight : EPEnvironmentProbe::WallLeft);
+	if (Distance < 0.f)
+	{
+		return false;
+	}
+
+	OutHit = FHitResult();
+	OutHit.bBlockingHit = true;
+	OutHit.TraceStart = Origin;
+	OutHit.Location = OutHit.ImpactPoint = Origin + FVector(Direction * Distance, 0.f, 0.f);
+	OutHit.Normal = OutHit.ImpactNormal = FVector(-Direction, 0.f, 0.f);
+	OutHit.Distance = Distance;
+	return true;
+}
+
+UPEnvironmentSensorComponent::UPEnvironmentSensorComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// After the owner has moved, the probes describe where the capsule ends the frame
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UPEnvironmentSensorComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Capsule = Cast<UCapsuleComponent>(GetOwner()->GetRootComponent());
+	if (!Capsule)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s: the environment sensor needs a capsule as root component"), *GetOwner()->GetName());
+		SetComponentTickEnabled(false);
+		return;
+	}
+	TraceDelegate.BindUObject(this, &UPEnvironmentSensorComponent::OnTraceDone);
+}
+
+bool UPEnvironmentSensorComponent::HasFreshState() const
+{
+	return State.IsValid() && GFrameCounter <= State.Frame + 1;
+}
+
+void UPEnvironmentSensorComponent::Invalidate()
+{
+	State = FPEnvironmentSensorState();
+	NumPendingTraces = 0;
+	SampleId = (SampleId + 1) & PEnvironmentSensor::SampleIdMask;
+}
+
+void UPEnvironmentSensorComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	IssueProbes();
+}
+
+void UPEnvironmentSensorComponent::IssueProbes()
+{
+	UWorld* World = GetWorld();
+	const UPTileCollisionSubsystem* TileCollision = World->GetSubsystem<UPTileCollisionSubsystem>();
+
+	// Traces of a sample that didn't complete in time are dropped with it
+	SampleId = (SampleId + 1) & PEnvironmentSensor::SampleIdMask;
+	NumPendingTraces = 0;
+	Pending = FPEnvironmentSensorState();
+	Pending.Origin = Capsule->GetComponentLocation();
+	Pending.Frame = GFrameCounter;
+	Pending.Time = World->GetTimeSeconds();
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(EnvironmentSensor), false, GetOwner());
+	FCollisionQueryParams FallbackParams = Params;
+	if (TileCollision)
+	{
+		TileCollision->AddIgnoredBakedComponents(FallbackParams);
+	}
+
+	auto IssueProbe = [&](EPEnvironmentProbe Probe, EPTileProbeDirection Direction, const FVector& Start, float Reach, float Radius)
+	{
+		const FVector DirectionVector = Direction == EPTileProbeDirection::Left ? FVector(-1.f, 0.f, 0.f)
+			: Direction == EPTileProbeDirection::Right ? FVector(1.f, 0.f, 0.f)
+			: Direction == EPTileProbeDirection::Down ? FVector(0.f, 0.f, -1.f)
+			: FVector(0.f, 0.f, 1.f);
+		const FVector End = Start + DirectionVector * Reach;
+		P2D_DRAW(WallDetection, DrawDebugLine(World, Start, End, FColor::Cyan));
+
+		const bool bUseGrid = TileCollision && TileCollision->Contains(Start);
+		float Distance;
+		if (bUseGrid && TileCollision->Probe(Start, Direction, Reach + Radius, Radius, Distance))
+		{
+			Pending.Distances[static_cast<int32>(Probe)] = Distance;
+			return;
+		}
+
+		const uint32 UserData = (SampleId << PEnvironmentSensor::ProbeBits) | static_cast<uint32>(Probe);
+		const FCollisionShape Shape = FCollisionShape::MakeSphere(Radius);
+		// Static tiles are settled by the grid, the trace then skips the baked tile maps and only finds what the grid doesn't know about
+		const FCollisionQueryParams& TraceParams = bUseGrid ? FallbackParams : Params;
+		if (Radius > 0.f)
+		{
+			World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, TraceChannel, Shape, TraceParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, UserData);
+		}
+		else
+		{
+			World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, TraceChannel, TraceParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, UserData);
+		}
+		++NumPendingTraces;
+		INC_DWORD_STAT(STAT_EnvironmentSensor_AsyncTraces);
+	};
+
+	const FVector& Origin = Pending.Origin;
+	const float Radius = Capsule->GetScaledCapsuleRadius();
+	const float HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+	const float LedgeOffset = Radius + LedgeProbeOffset;
+
+	IssueProbe(EPEnvironmentProbe::WallLeft, EPTileProbeDirection::Left, Origin, Radius + WallProbeDistance, WallProbeRadius);
+	IssueProbe(EPEnvironmentProbe::WallRight, EPTileProbeDirection::Right, Origin, Radius + WallProbeDistance, WallProbeRadius);
+	if (!bProbeGround)
+	{
+		TryPublish();
+		return;
+	}
+	IssueProbe(EPEnvironmentProbe::Ground, EPTileProbeDirection::Down, Origin, HalfHeight + VerticalProbeDistance, 0.f);
+	IssueProbe(EPEnvironmentProbe::Ceiling, EPTileProbeDirection::Up, Origin, HalfHeight + VerticalProbeDistance, 0.f);
+	IssueProbe(EPEnvironmentProbe::GroundAheadLeft, EPTileProbeDirection::Down, Origin - FVector(LedgeOffset, 0.f, 0.f), HalfHeight + LedgeProbeDepth, 0.f);
+	IssueProbe(EPEnvironmentProbe::GroundAheadRight, EPTileProbeDirection::Down, Origin + FVector(LedgeOffset, 0.f, 0.f), HalfHeight + LedgeProbeDepth, 0.f);
+
+	TryPublish();
+}
+
+void UPEnvironmentSensorComponent::OnTraceDone(const FTraceHandle& Handle, FTraceDatum& Data)
+{
+	if ((Data.UserData >> PEnvironmentSensor::ProbeBits) != SampleId || NumPendingTraces == 0)
+	{
+		return;
+	}
+
+	const int32 Probe = static_cast<int32>(Data.UserData & PEnvironmentSensor::ProbeMask);
+	if (const FHitResult* Hit = Data.OutHits.FindByPredicate([](const FHitResult& Result) { return Result.bBlockingHit; }))
+	{
+		Pending.Distances[Probe] = Hit->Distance;
+	}
+	--NumPendingTraces;
+	TryPublish();
+}
+
+void UPEnvironmentSensorComponent::TryPublish()
+{
+	if (NumPendingTraces == 0 && Pending.IsValid())
+	{
+		State = Pending;
+		Pending = FPEnvironmentSensorState();
+	}
+}
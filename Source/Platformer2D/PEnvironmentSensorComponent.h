@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "WorldCollision.h"
+#include "PEnvironmentSensorComponent.generated.h"
+
+class UCapsuleComponent;
+
+enum class EPEnvironmentProbe : uint8
+{
+	WallLeft,
+	WallRight,
+	Ground,
+	Ceiling,
+	/** Ground a step ahead of the capsule, missing while grounded means a ledge. */
+	GroundAheadLeft,
+	GroundAheadRight,
+	Num
+};
+
+/** What the probes of one sample found around the capsule. Trivially copyable. */
+struct FPEnvironmentSensorState
+{
+	/** Capsule center the probes started from. */
+	FVector Origin = FVector::ZeroVector;
+	/** GFrameCounter and world time the probes were issued on, 0 for a state that was never sampled. */
+	uint64 Frame = 0;
+	double Time = 0.0;
+	/** Distance from Origin to the hit per probe, negative without a hit. */
+	float Distances[static_cast<int32>(EPEnvironmentProbe::Num)];
+
+	FPEnvironmentSensorState();
+
+	bool IsValid() const { return Frame != 0; }
+	bool IsBlocked(EPEnvironmentProbe Probe) const { return Distances[static_cast<int32>(Probe)] >= 0.f; }
+	float GetDistance(EPEnvironmentProbe Probe) const { return Distances[static_cast<int32>(Probe)]; }
+
+	bool IsTouchingWall() const { return IsBlocked(EPEnvironmentProbe::WallLeft) || IsBlocked(EPEnvironmentProbe::WallRight); }
+	/** On the ground with no ground a step ahead in the direction of Facing (1 or -1). */
+	bool IsAtLedge(float Facing) const;
+
+	/** The wall probe on the side of Facing as a hit result, for code written against a trace. @return false without a wall */
+	bool GetWallHit(float Facing, FHitResult& OutHit) const;
+};
+
+/**
+ * Probes the surroundings of the owner's capsule once per frame, walls left and right and, with bProbeGround, ground, ceiling
+ * and the ground a step ahead on both sides, and keeps the result as a timestamped state that Jump, WallJump and animation code read without tracing.
+ *
+ * Static tiles come from the UPTileCollisionSubsystem grid right away. Everything else is an async trace issued after physics
+ * and gathered at the start of the next frame, so the state input sees is the one the capsule ended the last frame in.
+ * Callers fall back to their own synchronous query while HasFreshState() is false, e.g. on the first frame or after a rollback.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPEnvironmentSensorComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPEnvironmentSensorComponent();
+
+	/** Reach of the wall probes past the capsule radius. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sensor, meta = (ClampMin = "0"))
+	float WallProbeDistance = 15.f;
+
+	/** Radius of the sphere swept by the wall probes, 0 for line traces. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sensor, meta = (ClampMin = "0"))
+	float WallProbeRadius = 0.f;
+
+	/** Reach of the ground and ceiling probes past the capsule half height. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sensor, meta = (ClampMin = "0"))
+	float VerticalProbeDistance = 10.f;
+
+	/** How far past the capsule radius the ledge probes look for ground. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sensor, meta = (ClampMin = "0"))
+	float LedgeProbeOffset = 10.f;
+
+	/** Drop below the capsule bottom that still counts as ground ahead. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sensor, meta = (ClampMin = "0"))
+	float LedgeProbeDepth = 30.f;
+
+	/**
+	 * Also probes the ground, the ceiling and the ground a step ahead, for code reading IsOnGround, IsUnderCeiling or IsAtLedge.
+	 * Off by default, the characters only read the wall probes so far.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sensor)
+	bool bProbeGround = false;
+
+	/** Channel of the async traces, also used where the tile grid covers the capsule, with the baked tile maps ignored. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sensor)
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_WorldStatic;
+
+	/** Last complete sample, see HasFreshState() before trusting it. */
+	const FPEnvironmentSensorState& GetState() const { return State; }
+
+	/** True if the state was sampled at the end of the last frame or later. */
+	bool HasFreshState() const;
+
+	/** Drops the state and the traces in flight, e.g. when the owner was teleported or rolled back. */
+	void Invalidate();
+
+	UFUNCTION(BlueprintPure, Category = Sensor)
+	bool IsOnGround() const { return State.IsBlocked(EPEnvironmentProbe::Ground); }
+
+	UFUNCTION(BlueprintPure, Category = Sensor)
+	bool IsUnderCeiling() const { return State.IsBlocked(EPEnvironmentProbe::Ceiling); }
+
+	UFUNCTION(BlueprintPure, Category = Sensor)
+	bool IsTouchingWall(bool bRight) const { return State.IsBlocked(bRight ? EPEnvironmentProbe::WallRight : EPEnvironmentProbe::WallLeft); }
+
+	UFUNCTION(BlueprintPure, Category = Sensor)
+	bool IsAtLedge(bool bRight) const { return State.IsAtLedge(bRight ? 1.f : -1.f); }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	/** Probes the tile grid and issues the async traces for everything it doesn't settle. */
+	void IssueProbes();
+	void OnTraceDone(const FTraceHandle& Handle, FTraceDatum& Data);
+	/** Makes the pending sample the state once none of its traces is outstanding. */
+	void TryPublish();
+
+	UPROPERTY(Transient)
+	TObjectPtr<UCapsuleComponent> Capsule;
+
+	FPEnvironmentSensorState State;
+	/** Sample whose async traces are still in flight. */
+	FPEnvironmentSensorState Pending;
+	int32 NumPendingTraces = 0;
+	/** Tags the traces of a sample, results of an older sample are dropped. */
+	uint32 SampleId = 0;
+
+	FTraceDelegate TraceDelegate;
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PFlipbookBatchComponent.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+
+UPFlipbookBatchComponent::UPFlipbookBatchComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// After the camera has moved, so the shown area is this frame's
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	// Instances are in world space
+	SetUsingAbsoluteLocation(true);
+	SetUsingAbsoluteRotation(true);
+	SetUsingAbsoluteScale(true);
+
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+	CanCharacterStepUpOn = ECB_No;
+	SetCastShadow(false);
+}
+
+int32 UPFlipbookBatchComponent::FindOrAddFlipbook(UPaperFlipbook* Flipbook)
+{
+	if (!Flipbook || Flipbook->GetNumFrames() == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	int32 FlipbookIndex = Flipbooks.Find(Flipbook);
+	if (FlipbookIndex == INDEX_NONE)
+	{
+		FlipbookIndex = Flipbooks.Add(Flipbook);
+		FFlipbookFrames& Frames = FlipbookFrames.AddDefaulted_GetRef();
+		Frames.FramesPerSecond = Flipbook->GetFramesPerSecond();
+		for (int32 Frame = 0; Frame < Flipbook->GetNumFrames(); ++Frame)
+		{
+			Frames.Sprites.Add(Flipbook->GetSpriteAtFrame(Frame));
+		}
+	}
+	return FlipbookIndex;
+}
+
+bool UPFlipbookBatchComponent::GetCameraView(float PlaneY, FVector2D& OutCenter, FVector2D& OutExtent) const
+{
+	const APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0);
+	if (!CameraManager)
+	{
+		return false;
+	}
+
+	const FMinimalViewInfo& View = CameraManager->GetCameraCachePOV();
+	const float HalfWidth = View.ProjectionMode == ECameraProjectionMode::Orthographic
+		? View.OrthoWidth * 0.5f
+		: FMath::Abs(View.Location.Y - PlaneY) * FMath::Tan(FMath::DegreesToRadians(View.FOV * 0.5f));
+	OutCenter = FVector2D(View.Location.X, View.Location.Z);
+	OutExtent = FVector2D(HalfWidth, HalfWidth / FMath::Max(View.AspectRatio, SMALL_NUMBER));
+	return true;
+}
+
+void UPFlipbookBatchComponent::ResetItems()
+{
+	SetWorldTransform(FTransform::Identity);
+	ClearInstances();
+	ShownItems.Reset();
+}
+
+void UPFlipbookBatchComponent::BeginShowItems()
+{
+	NumShown = 0;
+	bInstancesChanged = false;
+}
+
+void UPFlipbookBatchComponent::ShowItem(int32 Item, const FTransform& Transform, UPaperSprite* Sprite, const FLinearColor& Color, bool bMoved)
+{
+	if (NumShown == ShownItems.Num())
+	{
+		AddInstance(Transform, Sprite, true, Color);
+		ShownItems.Add(Item);
+		bInstancesChanged = true;
+	}
+	else
+	{
+		// The instance showed another item last update
+		const bool bOtherItem = ShownItems[NumShown] != Item;
+		if (bOtherItem)
+		{
+			ShownItems[NumShown] = Item;
+			UpdateInstanceColor(NumShown, Color, false);
+		}
+		if (bOtherItem || bMoved)
+		{
+			UpdateInstanceTransform(NumShown, Transform, true, false, true);
+			bInstancesChanged = true;
+		}
+		if (PerInstanceSpriteData[NumShown].SourceSprite != Sprite)
+		{
+			SetInstanceSprite(NumShown, Sprite);
+			bInstancesChanged = true;
+		}
+	}
+	++NumShown;
+}
+
+void UPFlipbookBatchComponent::EndShowItems()
+{
+	while (ShownItems.Num() > NumShown)
+	{
+		RemoveInstance(ShownItems.Num() - 1);
+		ShownItems.Pop(false);
+		bInstancesChanged = true;
+	}
+
+	// Instance updates don't touch the render state, it is rebuilt once for all of them
+	if (bInstancesChanged)
+	{
+		UpdateBounds();
+		MarkRenderStateDirty();
+	}
+}
+
+void UPFlipbookBatchComponent::SetInstanceSprite(int32 InstanceIndex, UPaperSprite* Sprite)
+{
+	FSpriteInstanceData& Instance = PerInstanceSpriteData[InstanceIndex];
+	Instance.SourceSprite = Sprite;
+	// Instances draw with the material of their slot, the flipbooks of other items may use another one
+	if (Sprite)
+	{
+		Instance.MaterialIndex = InstanceMaterials.AddUnique(Sprite->GetDefaultMaterial());
+	}
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PaperGroupedSpriteComponent.h"
+#include "PFlipbookBatchComponent.generated.h"
+
+class UPaperFlipbook;
+class UPaperSprite;
+
+/**
+ * Base of the components drawing many animated flipbooks as the instances of one grouped sprite component.
+ *
+ * Flipbooks are unpacked into arrays of frames once, so an item's sprite is an array lookup. Every update the subclass
+ * walks its items and calls ShowItem for those in view, between BeginShowItems and EndShowItems. An instance keeps
+ * its item from one update to the next, so it is only touched when its item, sprite or transform changed, and the render
+ * state is rebuilt once for the whole update.
+ */
+UCLASS(Abstract)
+class PLATFORMER2D_API UPFlipbookBatchComponent : public UPaperGroupedSpriteComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPFlipbookBatchComponent();
+
+	int32 GetNumShown() const { return ShownItems.Num(); }
+
+protected:
+	/** Frames of a flipbook by frame index. */
+	struct FFlipbookFrames
+	{
+		TArray<UPaperSprite*> Sprites;
+		float FramesPerSecond = 0.f;
+
+		/** @return the frame shown Time seconds into the looping flipbook */
+		int32 GetFrame(float Time) const { return FMath::FloorToInt(Time * FramesPerSecond) % Sprites.Num(); }
+		float GetDuration() const { return Sprites.Num() / FMath::Max(FramesPerSecond, 1.f); }
+	};
+
+	/** @return the index of the flipbook's frames, INDEX_NONE for a missing or empty flipbook */
+	int32 FindOrAddFlipbook(UPaperFlipbook* Flipbook);
+	const FFlipbookFrames& GetFlipbookFrames(int32 FlipbookIndex) const { return FlipbookFrames[FlipbookIndex]; }
+	int32 GetNumFlipbooks() const { return Flipbooks.Num(); }
+
+	/** Half size of the player camera's view on the X/Z plane at a depth of PlaneY, and its center. @return false without a player camera */
+	bool GetCameraView(float PlaneY, FVector2D& OutCenter, FVector2D& OutExtent) const;
+
+	/** Removes every instance, for subclasses starting over at begin play. */
+	void ResetItems();
+
+	void BeginShowItems();
+	/**
+	 * Shows an item in the next instance.
+	 * @param bMoved false for an item known to be where it was last update, its instance then keeps its transform
+	 */
+	void ShowItem(int32 Item, const FTransform& Transform, UPaperSprite* Sprite, const FLinearColor& Color, bool bMoved);
+	/** Removes the instances left over from the last update and rebuilds the render state if any instance changed. */
+	void EndShowItems();
+
+private:
+	void SetInstanceSprite(int32 InstanceIndex, UPaperSprite* Sprite);
+
+	UPROPERTY(Transient)
+	TArray<UPaperFlipbook*> Flipbooks;
+	TArray<FFlipbookFrames> FlipbookFrames;
+
+	/** Item shown by each instance. */
+	TArray<int32> ShownItems;
+	int32 NumShown = 0;
+	bool bInstancesChanged = false;
+};
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PGhostActor.h"
+
+#include "PaperFlipbook.h"
+#include "PaperFlipbookComponent.h"
+
+APGhostActor::APGhostActor()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	Sprite = CreateDefaultSubobject<UPaperFlipbookComponent>(TEXT("Sprite"));
+	Sprite->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Sprite->SetGenerateOverlapEvents(false);
+	Sprite->CanCharacterStepUpOn = ECB_No;
+	Sprite->SetCastShadow(false);
+	RootComponent = Sprite;
+
+	SetActorEnableCollision(false);
+}
+
+void APGhostActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Sprite->SetSpriteColor(GhostColor);
+	if (!TrajectoryFile.IsEmpty())
+	{
+		OpenTrajectory(TrajectoryFile);
+	}
+}
+
+void APGhostActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Trajectory.Close();
+	Super::EndPlay(EndPlayReason);
+}
+
+bool APGhostActor::OpenTrajectory(const FString& Filename)
+{
+	SetActorTickEnabled(false);
+	if (!Trajectory.Open(Filename))
+	{
+		return false;
+	}
+
+	Flipbooks.Reset();
+	for (const FString& Path : Trajectory.GetFlipbookPaths())
+	{
+		Flipbooks.Add(LoadObject<UPaperFlipbook>(nullptr, *Path));
+	}
+	StateNames.Reset();
+	for (const FString& Name : Trajectory.GetStateNames())
+	{
+		StateNames.Add(FName(*Name));
+	}
+
+	AppliedFlipbook = FPGhostPose::NoFlipbook;
+	AppliedState = FPGhostPose::NoState;
+	AppliedFacing = 0;
+	SetPlaybackTime(0.f);
+	return true;
+}
+
+void APGhostActor::SetPlaybackTime(float Time)
+{
+	const float Duration = Trajectory.GetDuration();
+	PlaybackTime = bLoop && Duration > 0.f ? FMath::Fmod(FMath::Fmod(Time, Duration) + Duration, Duration) : FMath::Clamp(Time, 0.f, Duration);
+	ApplyPose();
+
+	// Without looping, the ghost stops ticking at the end it plays towards, seeking away from it plays on
+	const bool bFinished = !bLoop && (PlaybackRate >= 0.f ? PlaybackTime >= Duration : PlaybackTime <= 0.f);
+	SetActorTickEnabled(Trajectory.IsOpen() && !bFinished);
+}
+
+FName APGhostActor::GetStateName() const
+{
+	return StateNames.IsValidIndex(AppliedState) ? StateNames[AppliedState] : NAME_None;
+}
+
+void APGhostActor::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SetPlaybackTime(PlaybackTime + DeltaTime * PlaybackRate);
+}
+
+void APGhostActor::ApplyPose()
+{
+	if (!Trajectory.IsOpen())
+	{
+		return;
+	}
+
+	const float FrameTime = PlaybackTime * Trajectory.GetFrameRate();
+	const int32 Frame = FMath::FloorToInt(FrameTime);
+	const FPGhostPose Pose = Trajectory.GetPose(Frame);
+	const FPGhostPose NextPose = Trajectory.GetPose(Frame + 1);
+	const FVector2D Location = FMath::Lerp(Pose.Location, NextPose.Location, FrameTime - Frame);
+	SetActorLocation(FVector(Location.X, Trajectory.GetPlaneY(), Location.Y));
+
+	// Like the characters' animation resolver, only touch the sprite when something changed
+	if (Pose.Facing != AppliedFacing)
+	{
+		AppliedFacing = Pose.Facing;
+		Sprite->SetWorldRotation(FRotator(0, AppliedFacing > 0 ? 0 : -180, 0));
+	}
+	if (Pose.FlipbookIndex != AppliedFlipbook)
+	{
+		AppliedFlipbook = Pose.FlipbookIndex;
+		if (Flipbooks.IsValidIndex(AppliedFlipbook) && Flipbooks[AppliedFlipbook])
+		{
+			Sprite->SetFlipbook(Flipbooks[AppliedFlipbook]);
+		}
+	}
+	AppliedState = Pose.StateIndex;
+}
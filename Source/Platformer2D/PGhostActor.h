@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "PGhostTrajectory.h"
+#include "PGhostActor.generated.h"
+
+class UPaperFlipbook;
+class UPaperFlipbookComponent;
+
+/**
+ * Plays back a ghost trajectory on a bare flipbook sprite. There is no movement component, capsule or collision,
+ * a tick reads two frames from the mapped file and moves the sprite between them.
+ */
+UCLASS()
+class PLATFORMER2D_API APGhostActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	APGhostActor();
+
+	/** Trajectory opened at BeginPlay, if set. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Ghost)
+	FString TrajectoryFile;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Ghost)
+	float PlaybackRate = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Ghost)
+	bool bLoop = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Ghost)
+	FLinearColor GhostColor = FLinearColor(1.f, 1.f, 1.f, 0.4f);
+
+	/** Opens a trajectory and shows its first frame. */
+	UFUNCTION(BlueprintCallable, Category = Ghost)
+	bool OpenTrajectory(const FString& Filename);
+
+	/** Jumps to a time of the trajectory, forwards or backwards. Resumes a playback that had reached its end. */
+	UFUNCTION(BlueprintCallable, Category = Ghost)
+	void SetPlaybackTime(float Time);
+
+	UFUNCTION(BlueprintPure, Category = Ghost)
+	float GetPlaybackTime() const { return PlaybackTime; }
+
+	UFUNCTION(BlueprintPure, Category = Ghost)
+	float GetDuration() const { return Trajectory.GetDuration(); }
+
+	/** @return the state the recorded character was in at the current time, None if it had no state machine */
+	UFUNCTION(BlueprintPure, Category = Ghost)
+	FName GetStateName() const;
+
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void ApplyPose();
+
+	UPROPERTY(VisibleAnywhere, Category = Ghost)
+	UPaperFlipbookComponent* Sprite;
+
+	/** Flipbooks of the trajectory's table, loaded when it is opened. */
+	UPROPERTY(Transient)
+	TArray<UPaperFlipbook*> Flipbooks;
+	TArray<FName> StateNames;
+
+	FPGhostTrajectory Trajectory;
+	float PlaybackTime = 0.f;
+
+	uint8 AppliedFlipbook = FPGhostPose::NoFlipbook;
+	uint8 AppliedState = FPGhostPose::NoState;
+	int8 AppliedFacing = 0;
+};
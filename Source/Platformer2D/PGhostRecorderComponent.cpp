@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PGhostRecorderComponent.h"
+
+#include "Platformer2D.h"
+#include "PaperCharacter.h"
+#include "PaperFlipbook.h"
+#include "PaperFlipbookComponent.h"
+#include "StateMachineComponent.h"
+
+UPGhostRecorderComponent::UPGhostRecorderComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	// After movement and the sprite update, so a frame sees the pose that was drawn
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void UPGhostRecorderComponent::StartRecording()
+{
+	const APaperCharacter* Character = Cast<APaperCharacter>(GetOwner());
+	Sprite = Character ? Character->GetSprite() : GetOwner()->FindComponentByClass<UPaperFlipbookComponent>();
+	StateMachine = GetOwner()->FindComponentByClass<UStateMachineComponent>();
+	Flipbooks.Reset();
+	States.Reset();
+
+	Writer.Begin(FrameRate, GetOwner()->GetActorLocation().Y);
+	Writer.AddFrame(CapturePose());
+	RecordedTime = 0.f;
+	bRecording = true;
+	SetComponentTickEnabled(true);
+}
+
+bool UPGhostRecorderComponent::StopRecording(const FString& Filename)
+{
+	if (!bRecording)
+	{
+		return false;
+	}
+	bRecording = false;
+	SetComponentTickEnabled(false);
+
+	TArray<FString> FlipbookPaths;
+	for (const UPaperFlipbook* Flipbook : Flipbooks)
+	{
+		FlipbookPaths.Add(Flipbook->GetPathName());
+	}
+	TArray<FString> StateNames;
+	for (const FName& State : States)
+	{
+		StateNames.Add(State.ToString());
+	}
+
+	if (!Writer.Save(Filename, FlipbookPaths, StateNames))
+	{
+		UE_LOG(LogPlatformer2D, Error, TEXT("Failed to write ghost trajectory %s"), *Filename);
+		return false;
+	}
+	return true;
+}
+
+void UPGhostRecorderComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// One sample per elapsed ghost frame, the ghost plays back at its own rate whatever the game ran at
+	RecordedTime += DeltaTime;
+	const int32 NumFrames = FMath::FloorToInt(RecordedTime * FrameRate) + 1;
+	if (Writer.GetNumFrames() < NumFrames)
+	{
+		const FPGhostPose Pose = CapturePose();
+		while (Writer.GetNumFrames() < NumFrames)
+		{
+			Writer.AddFrame(Pose);
+		}
+	}
+}
+
+FPGhostPose UPGhostRecorderComponent::CapturePose()
+{
+	const FVector Location = GetOwner()->GetActorLocation();
+
+	FPGhostPose Pose;
+	Pose.Location = FVector2D(Location.X, Location.Z);
+	if (Sprite)
+	{
+		Pose.Facing = FMath::Abs(FRotator::NormalizeAxis(Sprite->GetComponentRotation().Yaw)) > 90.f ? -1 : 1;
+		if (UPaperFlipbook* Flipbook = Sprite->GetFlipbook())
+		{
+			int32 FlipbookIndex = Flipbooks.AddUnique(Flipbook);
+			Pose.FlipbookIndex = static_cast<uint8>(FMath::Min<int32>(FlipbookIndex, FPGhostPose::NoFlipbook));
+		}
+	}
+	if (StateMachine && StateMachine->StateTag.IsValid())
+	{
+		int32 StateIndex = States.AddUnique(StateMachine->StateTag.GetTagName());
+		Pose.StateIndex = static_cast<uint8>(FMath::Min<int32>(StateIndex, FPGhostPose::NoState));
+	}
+	return Pose;
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PGhostTrajectory.h"
+#include "PGhostRecorderComponent.generated.h"
+
+class UPaperFlipbook;
+class UPaperFlipbookComponent;
+class UStateMachineComponent;
+
+/** Samples the pose of a paper character at a fixed rate while recording, for playback by APGhostActor. */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPGhostRecorderComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPGhostRecorderComponent();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Ghost, meta = (ClampMin = "1"))
+	float FrameRate = 60.f;
+
+	UFUNCTION(BlueprintCallable, Category = Ghost)
+	void StartRecording();
+
+	/**
+	 * Stops recording and writes the trajectory.
+	 * @return true if it was written
+	 */
+	UFUNCTION(BlueprintCallable, Category = Ghost)
+	bool StopRecording(const FString& Filename);
+
+	UFUNCTION(BlueprintPure, Category = Ghost)
+	bool IsRecording() const { return bRecording; }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+	FPGhostPose CapturePose();
+
+	UPROPERTY(Transient)
+	UPaperFlipbookComponent* Sprite;
+	UPROPERTY(Transient)
+	UStateMachineComponent* StateMachine;
+
+	FPGhostTrajectoryWriter Writer;
+	/** Tables the pose indices point into, built as new flipbooks and states show up. */
+	TArray<UPaperFlipbook*> Flipbooks;
+	TArray<FName> States;
+
+	bool bRecording = false;
+	float RecordedTime = 0.f;
+};
@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PGhostTrajectory.h"
+
+#include "Platformer2D.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace PGhostFormat
+{
+	static uint32 GetChunkStride(uint16 ChunkFrames)
+	{
+		return Align(sizeof(FPGhostKeyframe) + (ChunkFrames - 1) * sizeof(FPGhostDelta), 8);
+	}
+
+	static uint8 PackFlipbook(const FPGhostPose& Pose)
+	{
+		return static_cast<uint8>((Pose.FlipbookIndex & ~FacingLeftBit) | (Pose.Facing < 0 ? FacingLeftBit : 0));
+	}
+
+	static void UnpackFlipbook(uint8 Packed, FPGhostPose& OutPose)
+	{
+		OutPose.FlipbookIndex = static_cast<uint8>(Packed & ~FacingLeftBit);
+		OutPose.Facing = (Packed & FacingLeftBit) ? -1 : 1;
+	}
+}
+
+void FPGhostTrajectoryWriter::Begin(float InFrameRate, float InPlaneY)
+{
+	Chunks.Reset();
+	NumFrames = 0;
+	FrameRate = InFrameRate;
+	PlaneY = InPlaneY;
+}
+
+void FPGhostTrajectoryWriter::AddFrame(const FPGhostPose& Pose)
+{
+	const int32 X = FMath::RoundToInt(Pose.Location.X * PGhostFormat::PositionScale);
+	const int32 Z = FMath::RoundToInt(Pose.Location.Y * PGhostFormat::PositionScale);
+	const uint8 Flipbook = PGhostFormat::PackFlipbook(Pose);
+	const uint32 ChunkStride = PGhostFormat::GetChunkStride(PGhostFormat::ChunkFrames);
+	const int32 FrameInChunk = NumFrames % PGhostFormat::ChunkFrames;
+
+	if (FrameInChunk == 0)
+	{
+		const int32 ChunkOffset = Chunks.AddZeroed(ChunkStride);
+		FPGhostKeyframe& Keyframe = *reinterpret_cast<FPGhostKeyframe*>(&Chunks[ChunkOffset]);
+		Keyframe.X = X;
+		Keyframe.Z = Z;
+		Keyframe.Flipbook = Flipbook;
+		Keyframe.State = Pose.StateIndex;
+		LastX = X;
+		LastZ = Z;
+	}
+	else
+	{
+		// Steps are measured from the last encoded position, not the real one, so rounding never accumulates.
+		// A step too large for a delta (a teleport) is clamped and caught up by the following frames and the next keyframe.
+		const int32 DX = FMath::Clamp(X - LastX, MIN_int16, MAX_int16);
+		const int32 DZ = FMath::Clamp(Z - LastZ, MIN_int16, MAX_int16);
+		const int32 Offset = Chunks.Num() - ChunkStride + sizeof(FPGhostKeyframe) + (FrameInChunk - 1) * sizeof(FPGhostDelta);
+		FPGhostDelta Delta;
+		Delta.DX = static_cast<int16>(DX);
+		Delta.DZ = static_cast<int16>(DZ);
+		Delta.Flipbook = Flipbook;
+		Delta.State = Pose.StateIndex;
+		FMemory::Memcpy(&Chunks[Offset], &Delta, sizeof(Delta));
+		LastX += DX;
+		LastZ += DZ;
+	}
+	++NumFrames;
+}
+
+bool FPGhostTrajectoryWriter::Save(const FString& Filename, const TArray<FString>& FlipbookPaths, const TArray<FString>& StateNames) const
+{
+	FPGhostFileHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = PGhostFormat::Magic;
+	Header.Version = PGhostFormat::Version;
+	Header.ChunkFrames = PGhostFormat::ChunkFrames;
+	Header.NumFrames = NumFrames;
+	Header.FrameRate = FrameRate;
+	Header.PositionScale = PGhostFormat::PositionScale;
+	Header.PlaneY = PlaneY;
+	Header.TableOffset = sizeof(FPGhostFileHeader) + Chunks.Num();
+	Header.ChunkStride = PGhostFormat::GetChunkStride(PGhostFormat::ChunkFrames);
+
+	TArray<uint8> Bytes;
+	Bytes.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	Bytes.Append(Chunks);
+
+	FMemoryWriter Writer(Bytes);
+	Writer.Seek(Bytes.Num());
+	Writer << const_cast<TArray<FString>&>(FlipbookPaths) << const_cast<TArray<FString>&>(StateNames);
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+FPGhostTrajectory::FPGhostTrajectory()
+{
+	FMemory::Memzero(Header);
+}
+
+FPGhostTrajectory::~FPGhostTrajectory()
+{
+	Close();
+}
+
+bool FPGhostTrajectory::Open(const FString& Filename)
+{
+	Close();
+
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	MappedRegion.Reset(MappedFile ? MappedFile->MapRegion() : nullptr);
+	if (MappedRegion)
+	{
+		Data = MappedRegion->GetMappedPtr();
+		DataSize = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedData, *Filename, FILEREAD_Silent))
+	{
+		Data = LoadedData.GetData();
+		DataSize = LoadedData.Num();
+	}
+	else
+	{
+		UE_LOG(LogPlatformer2D, Error, TEXT("Could not open ghost trajectory %s"), *Filename);
+		Close();
+		return false;
+	}
+
+	if (DataSize >= static_cast<int64>(sizeof(Header)))
+	{
+		FMemory::Memcpy(&Header, Data, sizeof(Header));
+	}
+	const int64 NumChunks = Header.ChunkFrames > 0 ? (static_cast<int64>(Header.NumFrames) + Header.ChunkFrames - 1) / Header.ChunkFrames : 0;
+	const bool bValid = DataSize >= static_cast<int64>(sizeof(Header))
+		&& Header.Magic == PGhostFormat::Magic
+		&& Header.Version == PGhostFormat::Version
+		&& Header.ChunkFrames > 0
+		&& Header.ChunkStride == PGhostFormat::GetChunkStride(Header.ChunkFrames)
+		&& Header.PositionScale > 0
+		&& Header.TableOffset == sizeof(Header) + NumChunks * Header.ChunkStride
+		&& Header.TableOffset <= DataSize;
+	if (!bValid)
+	{
+		UE_LOG(LogPlatformer2D, Error, TEXT("%s is not a version %d ghost trajectory"), *Filename, PGhostFormat::Version);
+		Close();
+		return false;
+	}
+
+	// The name tables are the only part that is parsed, once
+	TArray<uint8> TableBytes(Data + Header.TableOffset, static_cast<int32>(DataSize - Header.TableOffset));
+	FMemoryReader Reader(TableBytes);
+	Reader << FlipbookPaths << StateNames;
+	if (Reader.IsError())
+	{
+		UE_LOG(LogPlatformer2D, Error, TEXT("Could not read the name tables of ghost trajectory %s"), *Filename);
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FPGhostTrajectory::Close()
+{
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedData.Empty();
+	Data = nullptr;
+	DataSize = 0;
+	FlipbookPaths.Reset();
+	StateNames.Reset();
+}
+
+FPGhostPose FPGhostTrajectory::GetPose(int32 Frame) const
+{
+	FPGhostPose Pose;
+	if (!IsOpen() || Header.NumFrames == 0)
+	{
+		return Pose;
+	}
+	Frame = FMath::Clamp(Frame, 0, static_cast<int32>(Header.NumFrames) - 1);
+
+	const uint8* Chunk = Data + sizeof(FPGhostFileHeader) + static_cast<int64>(Frame / Header.ChunkFrames) * Header.ChunkStride;
+	FPGhostKeyframe Keyframe;
+	FMemory::Memcpy(&Keyframe, Chunk, sizeof(Keyframe));
+
+	int32 X = Keyframe.X;
+	int32 Z = Keyframe.Z;
+	uint8 Flipbook = Keyframe.Flipbook;
+	uint8 State = Keyframe.State;
+
+	const int32 FrameInChunk = Frame % Header.ChunkFrames;
+	const uint8* Deltas = Chunk + sizeof(FPGhostKeyframe);
+	for (int32 Index = 0; Index < FrameInChunk; ++Index)
+	{
+		FPGhostDelta Delta;
+		FMemory::Memcpy(&Delta, Deltas + Index * sizeof(FPGhostDelta), sizeof(Delta));
+		X += Delta.DX;
+		Z += Delta.DZ;
+		Flipbook = Delta.Flipbook;
+		State = Delta.State;
+	}
+
+	Pose.Location = FVector2D(X, Z) / Header.PositionScale;
+	PGhostFormat::UnpackFlipbook(Flipbook, Pose);
+	Pose.StateIndex = State;
+	return Pose;
+}
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** Pose of a ghost in one frame. */
+struct FPGhostPose
+{
+	static constexpr uint8 NoFlipbook = 0x7f;
+	static constexpr uint8 NoState = 0xff;
+
+	/** Position on the X/Z plane. */
+	FVector2D Location = FVector2D::ZeroVector;
+	/** 1 facing +X, -1 facing -X. */
+	int8 Facing = 1;
+	/** Index into the trajectory's flipbook table. */
+	uint8 FlipbookIndex = NoFlipbook;
+	/** Index into the trajectory's state table. */
+	uint8 StateIndex = NoState;
+};
+
+/**
+ * On-disk layout of a ghost trajectory. Everything is fixed size, so a frame is found by arithmetic alone:
+ *
+ *     FPGhostFileHeader
+ *     chunk 0: FPGhostKeyframe, FPGhostDelta x (ChunkFrames - 1), padding to ChunkStride
+ *     chunk 1: ...
+ *     name tables (FArchive serialized flipbook paths and state tags), at TableOffset
+ *
+ * Positions are fixed point with PositionScale steps per unit. The keyframe holds the absolute position of the first
+ * frame of a chunk and each delta the step from the frame before it, so reading a frame touches at most one chunk.
+ */
+namespace PGhostFormat
+{
+	constexpr uint32 Magic = 0x54534847; // "GHST"
+	constexpr uint16 Version = 1;
+	constexpr uint16 ChunkFrames = 64;
+	constexpr int32 PositionScale = 16;
+	/** The high bit of the flipbook byte is set when facing -X. */
+	constexpr uint8 FacingLeftBit = 0x80;
+}
+
+struct FPGhostFileHeader
+{
+	uint32 Magic;
+	uint16 Version;
+	uint16 ChunkFrames;
+	uint32 NumFrames;
+	float FrameRate;
+	int32 PositionScale;
+	/** The ghost's Y, constant for a character constrained to the X/Z plane. */
+	float PlaneY;
+	uint32 TableOffset;
+	uint32 ChunkStride;
+};
+
+struct FPGhostKeyframe
+{
+	int32 X;
+	int32 Z;
+	uint8 Flipbook;
+	uint8 State;
+	uint8 Padding[6];
+};
+
+struct FPGhostDelta
+{
+	int16 DX;
+	int16 DZ;
+	uint8 Flipbook;
+	uint8 State;
+};
+
+static_assert(sizeof(FPGhostFileHeader) == 32 && sizeof(FPGhostKeyframe) == 16 && sizeof(FPGhostDelta) == 6, "The ghost file layout must not depend on the compiler");
+
+/** Builds a ghost trajectory in memory, one pose per frame at a fixed frame rate. */
+class PLATFORMER2D_API FPGhostTrajectoryWriter
+{
+public:
+	void Begin(float InFrameRate, float InPlaneY);
+	void AddFrame(const FPGhostPose& Pose);
+
+	int32 GetNumFrames() const { return NumFrames; }
+
+	bool Save(const FString& Filename, const TArray<FString>& FlipbookPaths, const TArray<FString>& StateNames) const;
+
+private:
+	TArray<uint8> Chunks;
+	int32 NumFrames = 0;
+	float FrameRate = 60.f;
+	float PlaneY = 0.f;
+	int32 LastX = 0;
+	int32 LastZ = 0;
+};
+
+/**
+ * A ghost trajectory file, memory-mapped and read in place.
+ * Opening it reads the header and name tables, after that any frame can be read in any order without touching the rest.
+ * Dozens of ghosts cost the pages they touch, the OS shares and evicts them like any other file cache.
+ */
+class PLATFORMER2D_API FPGhostTrajectory
+{
+public:
+	FPGhostTrajectory();
+	~FPGhostTrajectory();
+
+	bool Open(const FString& Filename);
+	void Close();
+	bool IsOpen() const { return Data != nullptr; }
+
+	int32 GetNumFrames() const { return IsOpen() ? Header.NumFrames : 0; }
+	float GetFrameRate() const { return Header.FrameRate; }
+	float GetPlaneY() const { return Header.PlaneY; }
+	float GetDuration() const { return IsOpen() && Header.FrameRate > 0.f ? Header.NumFrames / Header.FrameRate : 0.f; }
+
+	/** Decodes a frame, clamped to the recorded range. */
+	FPGhostPose GetPose(int32 Frame) const;
+
+	const TArray<FString>& GetFlipbookPaths() const { return FlipbookPaths; }
+	const TArray<FString>& GetStateNames() const { return StateNames; }
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	/** Used where the platform can't map files. */
+	TArray<uint8> LoadedData;
+
+	const uint8* Data = nullptr;
+	int64 DataSize = 0;
+	FPGhostFileHeader Header;
+
+	TArray<FString> FlipbookPaths;
+	TArray<FString> StateNames;
+};
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PGrappleAnchorComponent.h"
+#include "PGrappleSubsystem.h"
+
+UPGrappleAnchorComponent::UPGrappleAnchorComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	// Only moving anchors have to tell the registry
+	bWantsOnUpdateTransform = true;
+}
+
+void UPGrappleAnchorComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UPGrappleSubsystem* Subsystem = GetWorld()->GetSubsystem<UPGrappleSubsystem>())
+	{
+		AnchorId = Subsystem->RegisterAnchor(GetComponentLocation());
+	}
+}
+
+void UPGrappleAnchorComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (AnchorId != INDEX_NONE)
+	{
+		if (UPGrappleSubsystem* Subsystem = GetWorld()->GetSubsystem<UPGrappleSubsystem>())
+		{
+			Subsystem->UnregisterAnchor(AnchorId);
+		}
+		AnchorId = INDEX_NONE;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UPGrappleAnchorComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
+
+	if (AnchorId != INDEX_NONE)
+	{
+		if (UPGrappleSubsystem* Subsystem = GetWorld()->GetSubsystem<UPGrappleSubsystem>())
+		{
+			Subsystem->UpdateAnchor(AnchorId, GetComponentLocation());
+		}
+	}
+}
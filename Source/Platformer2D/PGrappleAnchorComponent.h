@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "PGrappleAnchorComponent.generated.h"
+
+/**
+ * A point characters can grapple to. Registers itself with the UPGrappleSubsystem while playing,
+ * for anchors that are spawned at runtime or are not part of a grappable component.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PLATFORMER2D_API UPGrappleAnchorComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPGrappleAnchorComponent();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport) override;
+
+private:
+	int32 AnchorId = INDEX_NONE;
+};
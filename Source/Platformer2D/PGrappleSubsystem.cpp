@@ -0,0 +1,233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PGrappleSubsystem.h"
+#include "Platformer2D.h"
+#include "EngineUtils.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/Level.h"
+
+const FName GrappleSocket = "Grapple Location";
+
+void UPGrappleSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UPGrappleSubsystem::OnLevelAdded);
+}
+
+void UPGrappleSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	for (TActorIterator<AActor> It(&InWorld); It; ++It)
+	{
+		RegisterGrappables(*It);
+	}
+	ActorSpawnedHandle = InWorld.AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPGrappleSubsystem::OnActorSpawned));
+
+	P2D_LOG(Grapple, Log, TEXT("Registered %d grapple anchors in %d cells"), GrappableAnchors.Num(), Cells.Num());
+}
+
+void UPGrappleSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	for (const TPair<TObjectKey<UPrimitiveComponent>, int32>& Grappable : GrappableAnchors)
+	{
+		if (UPrimitiveComponent* Primitive = Grappable.Key.ResolveObjectPtr())
+		{
+			Primitive->TransformUpdated.RemoveAll(this);
+		}
+	}
+
+	Anchors.Empty();
+	Cells.Empty();
+	GrappableAnchors.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPGrappleSubsystem::RegisterGrappables(AActor* Actor)
+{
+	bool bRegistered = false;
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component);
+		if (!Primitive || !Primitive->IsCollisionEnabled() || Primitive->GetCollisionObjectType() != COLLISION_GRAPPABLE || GrappableAnchors.Contains(Primitive))
+		{
+			continue;
+		}
+
+		GrappableAnchors.Add(Primitive, RegisterAnchor(Primitive->GetSocketLocation(GrappleSocket)));
+		if (Primitive->Mobility == EComponentMobility::Movable)
+		{
+			Primitive->TransformUpdated.AddUObject(this, &UPGrappleSubsystem::OnGrappableMoved);
+		}
+		bRegistered = true;
+	}
+
+	if (bRegistered)
+	{
+		// Covers destroyed actors and levels streamed out alike
+		Actor->OnEndPlay.AddUniqueDynamic(this, &UPGrappleSubsystem::OnGrappableActorEndPlay);
+	}
+}
+
+void UPGrappleSubsystem::OnLevelAdded(ULevel* Level, UWorld* InWorld)
+{
+	// Levels loaded before begin play are covered by OnWorldBeginPlay
+	if (InWorld != GetWorld() || !InWorld->HasBegunPlay())
+	{
+		return;
+	}
+
+	const int32 NumAnchors = GrappableAnchors.Num();
+	for (AActor* Actor : Level->Actors)
+	{
+		if (Actor)
+		{
+			RegisterGrappables(Actor);
+		}
+	}
+	P2D_LOG(Grapple, Log, TEXT("Registered %d grapple anchors of %s"), GrappableAnchors.Num() - NumAnchors, *Level->GetOuter()->GetName());
+}
+
+void UPGrappleSubsystem::OnActorSpawned(AActor* Actor)
+{
+	RegisterGrappables(Actor);
+}
+
+void UPGrappleSubsystem::OnGrappableActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component);
+		int32 AnchorId = INDEX_NONE;
+		if (Primitive && GrappableAnchors.RemoveAndCopyValue(Primitive, AnchorId))
+		{
+			Primitive->TransformUpdated.RemoveAll(this);
+			UnregisterAnchor(AnchorId);
+		}
+	}
+}
+
+void UPGrappleSubsystem::OnGrappableMoved(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	UPrimitiveComponent* Primitive = CastChecked<UPrimitiveComponent>(Component);
+	if (const int32* AnchorId = GrappableAnchors.Find(Primitive))
+	{
+		UpdateAnchor(*AnchorId, Primitive->GetSocketLocation(GrappleSocket));
+	}
+}
+
+bool UPGrappleSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+FIntPoint UPGrappleSubsystem::ToCell(float X, float Z) const
+{
+	return FIntPoint(FMath::FloorToInt(X / CellSize), FMath::FloorToInt(Z / CellSize));
+}
+
+void UPGrappleSubsystem::AddToCell(int32 AnchorId, const FIntPoint& Cell)
+{
+	Cells.FindOrAdd(Cell).Add(AnchorId);
+}
+
+void UPGrappleSubsystem::RemoveFromCell(int32 AnchorId, const FIntPoint& Cell)
+{
+	if (TArray<int32>* CellAnchors = Cells.Find(Cell))
+	{
+		CellAnchors->RemoveSingleSwap(AnchorId, false);
+		if (CellAnchors->Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+}
+
+int32 UPGrappleSubsystem::RegisterAnchor(const FVector& Location)
+{
+	const FIntPoint Cell = ToCell(Location.X, Location.Z);
+	const int32 AnchorId = Anchors.Add({ Location, Cell });
+	AddToCell(AnchorId, Cell);
+	return AnchorId;
+}
+
+void UPGrappleSubsystem::UpdateAnchor(int32 AnchorId, const FVector& Location)
+{
+	if (!Anchors.IsValidIndex(AnchorId))
+	{
+		return;
+	}
+
+	FAnchor& Anchor = Anchors[AnchorId];
+	Anchor.Location = Location;
+	const FIntPoint Cell = ToCell(Location.X, Location.Z);
+	if (Cell != Anchor.Cell)
+	{
+		RemoveFromCell(AnchorId, Anchor.Cell);
+		AddToCell(AnchorId, Cell);
+		Anchor.Cell = Cell;
+	}
+}
+
+void UPGrappleSubsystem::UnregisterAnchor(int32 AnchorId)
+{
+	if (Anchors.IsValidIndex(AnchorId))
+	{
+		RemoveFromCell(AnchorId, Anchors[AnchorId].Cell);
+		Anchors.RemoveAt(AnchorId);
+	}
+}
+
+bool UPGrappleSubsystem::FindBestAnchor(const FPGrappleQuery& Query, FVector& OutLocation) const
+{
+	const FVector2D Origin(Query.Origin.X, Query.Origin.Z);
+	const FBox2D Area(Origin + Query.Area.Min, Origin + Query.Area.Max);
+	const FIntPoint MinCell = ToCell(Area.Min.X, Area.Min.Y);
+	const FIntPoint MaxCell = ToCell(Area.Max.X, Area.Max.Y);
+	const bool bFilterDirection = !Query.Direction.IsNearlyZero();
+	const FVector2D Direction = FVector2D(Query.Direction.X, Query.Direction.Z).GetSafeNormal();
+
+	double BestDistanceSquared = TNumericLimits<double>::Max();
+	for (int32 CellZ = MinCell.Y; CellZ <= MaxCell.Y; ++CellZ)
+	{
+		for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+		{
+			const TArray<int32>* CellAnchors = Cells.Find(FIntPoint(CellX, CellZ));
+			if (!CellAnchors)
+			{
+				continue;
+			}
+
+			for (const int32 AnchorId : *CellAnchors)
+			{
+				const FVector& Location = Anchors[AnchorId].Location;
+				const FVector2D Location2D(Location.X, Location.Z);
+				if (!Area.IsInside(Location2D))
+				{
+					continue;
+				}
+
+				const FVector2D Offset = Location2D - Origin;
+				const double DistanceSquared = Offset.SizeSquared();
+				if (DistanceSquared >= BestDistanceSquared)
+				{
+					continue;
+				}
+				if (bFilterDirection && (Offset.GetSafeNormal() | Direction) < Query.MinDirectionCos)
+				{
+					continue;
+				}
+
+				BestDistanceSquared = DistanceSquared;
+				OutLocation = Location;
+			}
+		}
+	}
+
+	return BestDistanceSquared < TNumericLimits<double>::Max();
+}
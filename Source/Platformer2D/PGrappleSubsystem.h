@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PGrappleSubsystem.generated.h"
+
+#define COLLISION_GRAPPABLE		ECC_GameTraceChannel1
+
+/** Socket of a grappable component the character is pulled towards. */
+extern PLATFORMER2D_API const FName GrappleSocket;
+
+struct FPGrappleQuery
+{
+	FVector Origin = FVector::ZeroVector;
+	/** Search area on the X/Z plane, relative to Origin. */
+	FBox2D Area = FBox2D(ForceInit);
+	/** Only anchors within the cone around Direction are accepted. No filter while Direction is zero. */
+	FVector Direction = FVector::ZeroVector;
+	/** Cosine of the cone's half angle. */
+	float MinDirectionCos = -1.f;
+};
+
+/**
+ * Registry of every grapple anchor in the world, bucketed into a uniform grid on the X/Z plane
+ * so a character's grapple query only looks at the few cells around it.
+ *
+ * Grappable components (COLLISION_GRAPPABLE) are registered automatically: those present at begin play, those of
+ * levels streamed in and actors spawned later. They are unregistered when their actor ends play, and movable ones
+ * follow their component. Anchors that are not part of a grappable component use UPGrappleAnchorComponent.
+ */
+UCLASS()
+class PLATFORMER2D_API UPGrappleSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** @return the id to update or unregister the anchor with */
+	int32 RegisterAnchor(const FVector& Location);
+	void UpdateAnchor(int32 AnchorId, const FVector& Location);
+	void UnregisterAnchor(int32 AnchorId);
+
+	/**
+	 * Finds the anchor closest to the query origin inside the query area and direction cone.
+	 * @return true if there is one, OutLocation is then its location
+	 */
+	bool FindBestAnchor(const FPGrappleQuery& Query, FVector& OutLocation) const;
+
+	int32 GetNumAnchors() const { return Anchors.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FAnchor
+	{
+		FVector Location;
+		FIntPoint Cell;
+	};
+
+	/** Registers the grappable components of Actor that are not registered yet. */
+	void RegisterGrappables(AActor* Actor);
+	void OnLevelAdded(ULevel* Level, UWorld* InWorld);
+	void OnActorSpawned(AActor* Actor);
+	UFUNCTION()
+	void OnGrappableActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+	void OnGrappableMoved(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	FIntPoint ToCell(float X, float Z) const;
+	void AddToCell(int32 AnchorId, const FIntPoint& Cell);
+	void RemoveFromCell(int32 AnchorId, const FIntPoint& Cell);
+
+	/** Edge length of a grid cell, about the size of a typical query area. */
+	float CellSize = 512.f;
+
+	TSparseArray<FAnchor> Anchors;
+	TMap<FIntPoint, TArray<int32>> Cells;
+	/** Anchors registered from grappable components, owned by the subsystem. */
+	TMap<TObjectKey<UPrimitiveComponent>, int32> GrappableAnchors;
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle ActorSpawnedHandle;
+};
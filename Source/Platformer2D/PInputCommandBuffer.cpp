@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PInputCommandBuffer.h"
+#include "HAL/IConsoleManager.h"
+
+namespace PSimulationClock
+{
+	static TAutoConsoleVariable<int32> CVarFramesPerSecond(
+		TEXT("p2d.Simulation.FramesPerSecond"), FPSimulationClock::DefaultFramesPerSecond,
+		TEXT("Frames per second of the simulation clock and default rate of the fixed movement steps (10 to 1000). Read once at the first use."),
+		ECVF_ReadOnly);
+}
+
+int32 FPSimulationClock::GetFramesPerSecond()
+{
+	static const int32 FramesPerSecond = FMath::Clamp(PSimulationClock::CVarFramesPerSecond.GetValueOnGameThread(), 10, 1000);
+	return FramesPerSecond;
+}
+
+int32 FPSimulationClock::SecondsToFrames(float Seconds)
+{
+	return Seconds > 0.f ? FMath::Max(1, FMath::RoundToInt(Seconds * GetFramesPerSecond())) : 0;
+}
+
+void FPSimulationClock::Advance(float DeltaTime)
+{
+	Remainder += FMath::Max(DeltaTime, 0.f) * GetFramesPerSecond();
+	const int32 NumFrames = FMath::FloorToInt(Remainder);
+	Frame += NumFrames;
+	Remainder -= NumFrames;
+}
+
+void FPSimulationClock::Reset()
+{
+	Frame = 0;
+	Remainder = 0.f;
+}
+
+void FPInputCommandBuffer::Record(int32 Frame, EPInputCommand Commands)
+{
+	if (Count > 0)
+	{
+		FPInputCommand& Newest = Entries[ToSlot(0)];
+		checkSlow(Frame >= Newest.Frame);
+		if (Newest.Frame == Frame)
+		{
+			Newest.Commands |= Commands;
+			return;
+		}
+	}
+
+	Entries[Head] = { Frame, Commands };
+	Head = (Head + 1) & (Capacity - 1);
+	Count = FMath::Min(Count + 1, Capacity);
+}
+
+int32 FPInputCommandBuffer::FindRecent(int32 Frame, int32 Window, EPInputCommand Commands) const
+{
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FPInputCommand& Entry = Entries[ToSlot(Index)];
+		if (!FPSimulationClock::IsWithin(Frame, Entry.Frame, Window))
+		{
+			break;
+		}
+		if (EnumHasAnyFlags(Entry.Commands, Commands))
+		{
+			return Entry.Frame;
+		}
+	}
+	return INDEX_NONE;
+}
+
+bool FPInputCommandBuffer::Consume(int32 Frame, int32 Window, EPInputCommand Commands)
+{
+	bool bFound = false;
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		FPInputCommand& Entry = Entries[ToSlot(Index)];
+		if (!FPSimulationClock::IsWithin(Frame, Entry.Frame, Window))
+		{
+			break;
+		}
+		bFound |= EnumHasAnyFlags(Entry.Commands, Commands);
+		EnumRemoveFlags(Entry.Commands, Commands);
+	}
+	return bFound;
+}
+
+void FPInputCommandBuffer::Reset()
+{
+	Head = 0;
+	Count = 0;
+}
+
+const FPInputCommand& FPInputCommandBuffer::GetFromNewest(int32 Index) const
+{
+	check(Index >= 0 && Index < Count);
+	return Entries[ToSlot(Index)];
+}
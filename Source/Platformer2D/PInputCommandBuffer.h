@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Counts fixed simulation frames from variable frame times.
+ * Gameplay windows are measured in these frames, so they last the same whatever the render frame rate is,
+ * and replaying the same frame times gives the same frame numbers.
+ */
+struct PLATFORMER2D_API FPSimulationClock
+{
+	static constexpr int32 DefaultFramesPerSecond = 120;
+
+	/** Frames per second of every clock, p2d.Simulation.FramesPerSecond read once, so it is set in [SystemSettings] rather than at runtime. */
+	static int32 GetFramesPerSecond();
+
+	/** Rounds a duration to whole frames. Any positive duration lasts at least one frame. */
+	static int32 SecondsToFrames(float Seconds);
+
+	/** True while fewer than Window frames have passed since StampFrame. INDEX_NONE stamps are never within a window. */
+	static FORCEINLINE bool IsWithin(int32 Frame, int32 StampFrame, int32 Window)
+	{
+		return StampFrame != INDEX_NONE && Frame - StampFrame < Window;
+	}
+
+	void Advance(float DeltaTime);
+	void Reset();
+
+	int32 GetFrame() const { return Frame; }
+
+private:
+	int32 Frame = 0;
+	/** Time not yet accounted for by a whole frame. */
+	float Remainder = 0.f;
+};
+
+/**
+ * Discrete input of one frame. FPInputCommandBuffer only holds the jump commands, Dash and Grapple are acted on
+ * right away and only travel through input recordings.
+ */
+enum class EPInputCommand : uint8
+{
+	None			= 0,
+	JumpPressed		= 1 << 0,
+	JumpReleased	= 1 << 1,
+	Dash			= 1 << 2,
+	Grapple			= 1 << 3,
+};
+ENUM_CLASS_FLAGS(EPInputCommand);
+
+/** The commands issued during one simulation frame. */
+struct FPInputCommand
+{
+	int32 Frame = INDEX_NONE;
+	EPInputCommand Commands = EPInputCommand::None;
+};
+
+/**
+ * Fixed-size ring of the most recent input commands, one entry per simulation frame with input.
+ * Input windows (jump buffering and the like) are answered by walking back from the newest entry,
+ * which stops as soon as the window is left, so a query touches a few entries and never allocates.
+ */
+class PLATFORMER2D_API FPInputCommandBuffer
+{
+public:
+	static constexpr int32 Capacity = 32;
+
+	/** Adds Commands to the entry of Frame, frames must be recorded in increasing order. */
+	void Record(int32 Frame, EPInputCommand Commands);
+
+	/** @return the newest frame within Window frames of Frame with any of Commands, INDEX_NONE if there is none */
+	int32 FindRecent(int32 Frame, int32 Window, EPInputCommand Commands) const;
+
+	/**
+	 * Removes Commands from every entry within Window frames of Frame, so they are not acted on twice.
+	 * @return true if any was found
+	 */
+	bool Consume(int32 Frame, int32 Window, EPInputCommand Commands);
+
+	void Reset();
+
+	int32 Num() const { return Count; }
+	/** @param Index 0 is the newest entry */
+	const FPInputCommand& GetFromNewest(int32 Index) const;
+
+private:
+	FORCEINLINE int32 ToSlot(int32 IndexFromNewest) const { return (Head - 1 - IndexFromNewest) & (Capacity - 1); }
+
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	FPInputCommand Entries[Capacity];
+	/** Slot the next frame is written to. */
+	int32 Head = 0;
+	int32 Count = 0;
+};
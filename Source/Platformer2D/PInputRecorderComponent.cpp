@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PInputRecorderComponent.h"
+
+#include "Platformer2D.h"
+#include "PCharacterMovementComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/PackageName.h"
+
+UPInputRecorderComponent::UPInputRecorderComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// Input arrives before the pawn ticks, so the frame is complete once everything else has run
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+UPInputRecorderComponent* UPInputRecorderComponent::CreateIfRequested(AActor* Owner)
+{
+	FString Filename;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("RecordInput="), Filename) && !FParse::Param(FCommandLine::Get(), TEXT("RecordInput")))
+	{
+		return nullptr;
+	}
+	if (UPInputRecorderComponent* Existing = Owner->FindComponentByClass<UPInputRecorderComponent>())
+	{
+		return Existing;
+	}
+
+	UPInputRecorderComponent* Recorder = NewObject<UPInputRecorderComponent>(Owner, TEXT("InputRecorder"));
+	Recorder->Filename = Filename;
+	Recorder->RegisterComponent();
+	return Recorder;
+}
+
+void UPInputRecorderComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!FApp::UseFixedTimeStep())
+	{
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(1.0 / 60.0);
+	}
+
+	const AActor* Owner = GetOwner();
+	const ACharacter* Character = Cast<ACharacter>(Owner);
+	const UPCharacterMovementComponent* MovementComponent = Character ? Cast<UPCharacterMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+
+	Recording.MapName = UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName());
+	Recording.CharacterClass = Owner->GetClass()->GetPathName();
+	Recording.bKinematicMover2D = MovementComponent && MovementComponent->bUseKinematicMover2D;
+	Recording.FixedStepRate = MovementComponent && MovementComponent->bUseFixedTimestep ? MovementComponent->GetFixedStepRate() : 0.f;
+	Recording.StartLocation = Owner->GetActorLocation();
+	Recording.StartRotation = Owner->GetActorRotation();
+	Recording.FixedDeltaTime = FApp::GetFixedDeltaTime();
+	Recording.Frames.Reset();
+	Recording.Checksums.Reset();
+	PendingFrame = FPRecordedInputFrame();
+
+	if (Filename.IsEmpty())
+	{
+		Filename = FPaths::ProjectSavedDir() / TEXT("InputRecordings") / FString::Printf(TEXT("%s-%s%s"),
+			*FPackageName::GetShortName(Recording.MapName), *FDateTime::Now().ToString(), FPInputRecording::Extension);
+	}
+	UE_LOG(LogPlatformer2D, Display, TEXT("Recording input of %s at %.0f FPS to %s"), *Owner->GetName(), 1.f / Recording.FixedDeltaTime, *Filename);
+}
+
+void UPInputRecorderComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	Recording.Frames.Add(PendingFrame);
+	// The axis is reported every frame, commands only on the frame they happen
+	PendingFrame.Commands = EPInputCommand::None;
+
+	if (Recording.Frames.Num() % Recording.CheckpointInterval == 0)
+	{
+		Recording.Checksums.Add(FPInputRecording::ComputeChecksum(GetOwner()->GetActorLocation(), GetOwner()->GetVelocity()));
+	}
+}
+
+void UPInputRecorderComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	Recording.FinalLocation = GetOwner()->GetActorLocation();
+	if (Recording.Save(Filename))
+	{
+		UE_LOG(LogPlatformer2D, Display, TEXT("Wrote %d frames of input to %s"), Recording.Frames.Num(), *Filename);
+	}
+	else
+	{
+		UE_LOG(LogPlatformer2D, Error, TEXT("Failed to write input recording %s"), *Filename);
+	}
+}
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PInputRecording.h"
+#include "PInputRecorderComponent.generated.h"
+
+/**
+ * Records the player input of its owner one frame at a time, for replay by the PInputReplay commandlet.
+ *
+ * Started with -RecordInput (or -RecordInput=<file>) on the command line, the owner's input handlers report to it
+ * and it closes each frame after everything else has ticked. The game is switched to a fixed time step while
+ * recording, a replay only matches if every frame had the same length.
+ */
+UCLASS(ClassGroup=(Custom))
+class PLATFORMER2D_API UPInputRecorderComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPInputRecorderComponent();
+
+	/** Adds a recorder to Owner if the command line asks for recording. @return the recorder, nullptr if not recording */
+	static UPInputRecorderComponent* CreateIfRequested(AActor* Owner);
+
+	void SetMoveRight(float Value) { PendingFrame.MoveRight = Value; }
+	void AddCommands(EPInputCommand Commands) { PendingFrame.Commands |= Commands; }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	FString Filename;
+	FPInputRecording Recording;
+	FPRecordedInputFrame PendingFrame;
+};
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PInputRecording.h"
+
+#include "Platformer2D.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+const TCHAR* FPInputRecording::Extension = TEXT(".pinput");
+
+uint32 FPInputRecording::ComputeChecksum(const FVector& Location, const FVector& Velocity)
+{
+	const int64 Quantized[] =
+	{
+		FMath::RoundToInt64(Location.X * 100.0), FMath::RoundToInt64(Location.Y * 100.0), FMath::RoundToInt64(Location.Z * 100.0),
+		FMath::RoundToInt64(Velocity.X * 100.0), FMath::RoundToInt64(Velocity.Y * 100.0), FMath::RoundToInt64(Velocity.Z * 100.0),
+	};
+	return FCrc::MemCrc32(Quantized, sizeof(Quantized));
+}
+
+bool FPInputRecording::Save(const FString& Filename) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << const_cast<FPInputRecording&>(*this);
+	return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+bool FPInputRecording::Load(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		UE_LOG(LogPlatformer2D, Error, TEXT("Could not read input recording %s"), *Filename);
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	Reader << *this;
+	if (Reader.IsError())
+	{
+		UE_LOG(LogPlatformer2D, Error, TEXT("%s is not a version %d input recording"), *Filename, Version);
+		return false;
+	}
+	return true;
+}
+
+FArchive& operator<<(FArchive& Ar, FPInputRecording& Recording)
+{
+	uint32 Magic = FPInputRecording::Magic;
+	int32 Version = FPInputRecording::Version;
+	Ar << Magic << Version;
+	if (Magic != FPInputRecording::Magic || Version != FPInputRecording::Version)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	Ar << Recording.MapName << Recording.CharacterClass << Recording.bKinematicMover2D << Recording.FixedStepRate;
+	Ar << Recording.StartLocation << Recording.StartRotation << Recording.FixedDeltaTime;
+	Ar << Recording.CheckpointInterval << Recording.Checksums << Recording.FinalLocation;
+
+	// Runs of identical frames
+	int32 NumFrames = Recording.Frames.Num();
+	Ar << NumFrames;
+	if (Ar.IsLoading())
+	{
+		Recording.Frames.Reset(NumFrames);
+		while (Recording.Frames.Num() < NumFrames && !Ar.IsError())
+		{
+			uint16 RunLength = 0;
+			FPRecordedInputFrame Frame;
+			uint8 Commands = 0;
+			Ar << RunLength << Frame.MoveRight << Commands;
+			Frame.Commands = static_cast<EPInputCommand>(Commands);
+			if (RunLength == 0 || Recording.Frames.Num() + RunLength > NumFrames)
+			{
+				Ar.SetError();
+				break;
+			}
+			for (int32 Index = 0; Index < RunLength; ++Index)
+			{
+				Recording.Frames.Add(Frame);
+			}
+		}
+	}
+	else
+	{
+		for (int32 RunStart = 0; RunStart < NumFrames;)
+		{
+			const FPRecordedInputFrame& Frame = Recording.Frames[RunStart];
+			int32 RunEnd = RunStart + 1;
+			while (RunEnd < NumFrames && RunEnd - RunStart < MAX_uint16 && Recording.Frames[RunEnd] == Frame)
+			{
+				++RunEnd;
+			}
+			uint16 RunLength = static_cast<uint16>(RunEnd - RunStart);
+			float MoveRight = Frame.MoveRight;
+			uint8 Commands = static_cast<uint8>(Frame.Commands);
+			Ar << RunLength << MoveRight << Commands;
+			RunStart = RunEnd;
+		}
+	}
+	return Ar;
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PInputCommandBuffer.h"
+
+/** The player input of one fixed simulation frame. */
+struct FPRecordedInputFrame
+{
+	float MoveRight = 0.f;
+	EPInputCommand Commands = EPInputCommand::None;
+
+	bool operator==(const FPRecordedInputFrame& Other) const { return MoveRight == Other.MoveRight && Commands == Other.Commands; }
+	bool operator!=(const FPRecordedInputFrame& Other) const { return !(*this == Other); }
+};
+
+/**
+ * Player input of one session at a fixed time step, with checksums of where the character was along the way.
+ *
+ * Replaying the frames into the same character class on the same map from the same start has to land on the same
+ * checksums, so any change to movement feel shows up as the first checkpoint that no longer matches.
+ * On disk the frames are run-length encoded, held keys and an idle stick cost a few bytes per run instead of per frame.
+ */
+struct PLATFORMER2D_API FPInputRecording
+{
+	static constexpr uint32 Magic = 0x52504950; // "PIPR"
+	static constexpr int32 Version = 2;
+	static const TCHAR* Extension;
+
+	FString MapName;
+	FString CharacterClass;
+	bool bKinematicMover2D = false;
+	/** Movement steps per second, 0 if the movement stepped once per frame. */
+	float FixedStepRate = 0.f;
+	FVector StartLocation = FVector::ZeroVector;
+	FRotator StartRotation = FRotator::ZeroRotator;
+	float FixedDeltaTime = 1.f / 60.f;
+
+	/** A checksum is taken after every CheckpointInterval frames. */
+	int32 CheckpointInterval = 30;
+	TArray<FPRecordedInputFrame> Frames;
+	TArray<uint32> Checksums;
+	FVector FinalLocation = FVector::ZeroVector;
+
+	/** Checksum of the movement state at a checkpoint. Positions are rounded to 1/100 unit so the last bits of float math don't count. */
+	static uint32 ComputeChecksum(const FVector& Location, const FVector& Velocity);
+
+	bool Save(const FString& Filename) const;
+	bool Load(const FString& Filename);
+
+	friend FArchive& operator<<(FArchive& Ar, FPInputRecording& Recording);
+};
@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PInputReplayCommandlet.h"
+
+#include "EngineUtils.h"
+#include "PaperCharacterBase.h"
+#include "PCharacter.h"
+#include "PCharacterMovementComponent.h"
+#include "PCommandletWorld.h"
+#include "PInputRecording.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/FileManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPInputReplay, Log, All);
+
+UPInputReplayCommandlet::UPInputReplayCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPInputReplayCommandlet::Main(const FString& Params)
+{
+	FString ReplayPath = FPaths::ProjectSavedDir() / TEXT("InputRecordings");
+	FParse::Value(*Params, TEXT("Replays="), ReplayPath);
+
+	double Tolerance = 0.01;
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+
+	TArray<FString> Filenames;
+	if (IFileManager::Get().DirectoryExists(*ReplayPath))
+	{
+		IFileManager::Get().FindFilesRecursive(Filenames, *ReplayPath, *(FString(TEXT("*")) + FPInputRecording::Extension), true, false);
+		Filenames.Sort();
+	}
+	else
+	{
+		Filenames.Add(ReplayPath);
+	}
+	if (Filenames.Num() == 0)
+	{
+		UE_LOG(LogPInputReplay, Error, TEXT("No input recordings found in %s"), *ReplayPath);
+		return 1;
+	}
+
+	int32 NumFailed = 0;
+	double SimulatedSeconds = 0.0;
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	for (const FString& Filename : Filenames)
+	{
+		FPInputRecording Recording;
+		FReplayResult Result;
+		if (!Recording.Load(Filename) || !Replay(Recording, Result))
+		{
+			UE_LOG(LogPInputReplay, Error, TEXT("%s: could not be replayed"), *Filename);
+			++NumFailed;
+			continue;
+		}
+		SimulatedSeconds += Result.NumFrames * Recording.FixedDeltaTime;
+
+		if (Result.DivergedFrame != INDEX_NONE)
+		{
+			UE_LOG(LogPInputReplay, Error, TEXT("%s: diverged by frame %d of %d"), *Filename, Result.DivergedFrame, Recording.Frames.Num());
+			++NumFailed;
+		}
+		else if (Result.FinalDistance > Tolerance)
+		{
+			UE_LOG(LogPInputReplay, Error, TEXT("%s: ended %.3f units away from the recorded final location"), *Filename, Result.FinalDistance);
+			++NumFailed;
+		}
+		else
+		{
+			UE_LOG(LogPInputReplay, Display, TEXT("%s: matched over %d frames"), *Filename, Result.NumFrames);
+		}
+	}
+
+	const double WallSeconds = FPlatformTime::Seconds() - StartSeconds;
+	UE_LOG(LogPInputReplay, Display, TEXT("%d of %d replays matched, %.1fs of play simulated in %.1fs (%.0fx realtime)"),
+		Filenames.Num() - NumFailed, Filenames.Num(), SimulatedSeconds, WallSeconds, WallSeconds > 0.0 ? SimulatedSeconds / WallSeconds : 0.0);
+	return NumFailed > 0 ? 1 : 0;
+}
+
+bool UPInputReplayCommandlet::Replay(const FPInputRecording& Recording, FReplayResult& OutResult) const
+{
+	UWorld* World = PCommandletWorld::Create(Recording.MapName);
+	if (!World)
+	{
+		return false;
+	}
+
+	ACharacter* Character = SpawnCharacter(World, Recording);
+	if (!Character)
+	{
+		PCommandletWorld::Destroy(World);
+		return false;
+	}
+
+	const float DeltaTime = Recording.FixedDeltaTime;
+	for (int32 Frame = 0; Frame < Recording.Frames.Num(); ++Frame)
+	{
+		ApplyInput(Character, Recording.Frames[Frame]);
+
+		FApp::SetDeltaTime(DeltaTime);
+		FApp::SetCurrentTime(FApp::GetCurrentTime() + DeltaTime);
+		World->Tick(LEVELTICK_All, DeltaTime);
+		++GFrameCounter;
+		OutResult.NumFrames = Frame + 1;
+
+		if (OutResult.NumFrames % Recording.CheckpointInterval == 0)
+		{
+			const int32 Checkpoint = OutResult.NumFrames / Recording.CheckpointInterval - 1;
+			if (Recording.Checksums.IsValidIndex(Checkpoint)
+				&& Recording.Checksums[Checkpoint] != FPInputRecording::ComputeChecksum(Character->GetActorLocation(), Character->GetVelocity()))
+			{
+				// Nothing after the first divergence tells us anything
+				OutResult.DivergedFrame = OutResult.NumFrames;
+				break;
+			}
+		}
+	}
+	OutResult.FinalDistance = FVector::Dist(Character->GetActorLocation(), Recording.FinalLocation);
+
+	PCommandletWorld::Destroy(World);
+	return true;
+}
+
+ACharacter* UPInputReplayCommandlet::SpawnCharacter(UWorld* World, const FPInputRecording& Recording) const
+{
+	UClass* CharacterClass = LoadClass<ACharacter>(nullptr, *Recording.CharacterClass);
+	if (!CharacterClass)
+	{
+		UE_LOG(LogPInputReplay, Error, TEXT("Could not load character class %s"), *Recording.CharacterClass);
+		return nullptr;
+	}
+
+	// A character placed in the map was the one played in the recording, spawning another would collide with it
+	ACharacter* Character = nullptr;
+	for (TActorIterator<ACharacter> It(World, CharacterClass); It; ++It)
+	{
+		Character = *It;
+		break;
+	}
+	if (Character)
+	{
+		Character->TeleportTo(Recording.StartLocation, Recording.StartRotation, false, true);
+	}
+	else
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Character = World->SpawnActor<ACharacter>(CharacterClass, Recording.StartLocation, Recording.StartRotation, SpawnParams);
+	}
+	if (!Character)
+	{
+		return nullptr;
+	}
+
+	// There is no controller in a replay, so let the movement component simulate the recorded input anyway.
+	Character->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+	if (UPCharacterMovementComponent* MovementComponent = Cast<UPCharacterMovementComponent>(Character->GetCharacterMovement()))
+	{
+		MovementComponent->bUseKinematicMover2D = Recording.bKinematicMover2D;
+		MovementComponent->bUseFixedTimestep = Recording.FixedStepRate > 0.f;
+		if (MovementComponent->bUseFixedTimestep)
+		{
+			MovementComponent->FixedStepRate = Recording.FixedStepRate;
+		}
+	}
+	return Character;
+}
+
+void UPInputReplayCommandlet::ApplyInput(ACharacter* Character, const FPRecordedInputFrame& Frame) const
+{
+	// Same order as the player input: actions first, then the axis
+	if (APCharacter* PCharacter = Cast<APCharacter>(Character))
+	{
+		if (EnumHasAnyFlags(Frame.Commands, EPInputCommand::JumpPressed))
+		{
+			PCharacter->Jump();
+		}
+		if (EnumHasAnyFlags(Frame.Commands, EPInputCommand::JumpReleased))
+		{
+			PCharacter->StopJumping();
+		}
+		PCharacter->MoveRight(Frame.MoveRight);
+	}
+	else if (APaperCharacterBase* PaperCharacter = Cast<APaperCharacterBase>(Character))
+	{
+		if (EnumHasAnyFlags(Frame.Commands, EPInputCommand::JumpPressed))
+		{
+			PaperCharacter->Jump();
+		}
+		if (EnumHasAnyFlags(Frame.Commands, EPInputCommand::JumpReleased))
+		{
+			PaperCharacter->StopJumping();
+		}
+		if (EnumHasAnyFlags(Frame.Commands, EPInputCommand::Dash))
+		{
+			PaperCharacter->Dash();
+		}
+		if (EnumHasAnyFlags(Frame.Commands, EPInputCommand::Grapple))
+		{
+			PaperCharacter->Grapple();
+		}
+		PaperCharacter->MoveRight(Frame.MoveRight);
+	}
+}
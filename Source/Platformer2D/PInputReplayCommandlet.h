@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PInputReplayCommandlet.generated.h"
+
+class ACharacter;
+struct FPInputRecording;
+struct FPRecordedInputFrame;
+
+/**
+ * Replays input recordings headlessly and checks that the character still ends up where it did when they were recorded.
+ *
+ * Frames are simulated back to back at the recorded fixed time step, as fast as the machine allows. Each replay gets a
+ * fresh copy of its map. The commandlet returns non-zero if any replay diverged, for use in batch jobs.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=PInputReplay -nullrhi -unattended
+ *     [-Replays=<file or directory, defaults to Saved/InputRecordings>] [-Tolerance=0.01]
+ */
+UCLASS()
+class PLATFORMER2D_API UPInputReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPInputReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FReplayResult
+	{
+		int32 NumFrames = 0;
+		/** First frame whose checkpoint did not match, INDEX_NONE if all did. */
+		int32 DivergedFrame = INDEX_NONE;
+		double FinalDistance = 0.0;
+	};
+
+	/** @return false if the replay could not be run at all */
+	bool Replay(const FPInputRecording& Recording, FReplayResult& OutResult) const;
+	ACharacter* SpawnCharacter(UWorld* World, const FPInputRecording& Recording) const;
+	void ApplyInput(ACharacter* Character, const FPRecordedInputFrame& Frame) const;
+};
@@ -0,0 +1,219 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PKinematicMover2D.h"
+#include "PTileCollisionSubsystem.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PhysicsVolume.h"
+
+namespace PKinematicMover2D
+{
+	/** UCharacterMovementComponent::IsExceedingMaxSpeed tolerance. */
+	constexpr float OverVelocityPercent = 1.01f;
+}
+
+FPKinematicMoveParams2D FPKinematicMoveParams2D::FromMovementComponent(const UCharacterMovementComponent& MovementComponent)
+{
+	FPKinematicMoveParams2D Result;
+	Result.GravityZ = MovementComponent.GetGravityZ();
+	if (const APhysicsVolume* PhysicsVolume = MovementComponent.GetPhysicsVolume())
+	{
+		Result.MaxFallSpeed = -FMath::Abs(PhysicsVolume->TerminalVelocity);
+	}
+	Result.MaxWalkSpeed = MovementComponent.MaxWalkSpeed;
+	Result.MaxAcceleration = MovementComponent.MaxAcceleration;
+	Result.GroundFriction = MovementComponent.GroundFriction;
+	Result.BrakingFriction = MovementComponent.BrakingFriction;
+	Result.BrakingFrictionFactor = MovementComponent.BrakingFrictionFactor;
+	Result.bUseSeparateBrakingFriction = MovementComponent.bUseSeparateBrakingFriction;
+	Result.BrakingDecelerationWalking = MovementComponent.BrakingDecelerationWalking;
+	Result.BrakingDecelerationFalling = MovementComponent.BrakingDecelerationFalling;
+	Result.FallingLateralFriction = MovementComponent.FallingLateralFriction;
+	Result.AirControl = MovementComponent.AirControl;
+	Result.AirControlBoostMultiplier = MovementComponent.AirControlBoostMultiplier;
+	Result.AirControlBoostVelocityThreshold = MovementComponent.AirControlBoostVelocityThreshold;
+	Result.BrakingSubStepTime = MovementComponent.BrakingSubStepTime;
+	Result.MaxSimulationTimeStep = MovementComponent.MaxSimulationTimeStep;
+	Result.MaxSimulationIterations = MovementComponent.MaxSimulationIterations;
+	return Result;
+}
+
+bool FPKinematicMover2D::Step(const UPTileCollisionSubsystem& TileCollision, FPKinematicBody2D& Body, float MoveInput, float DeltaTime) const
+{
+	const bool bWasOnGround = Body.bOnGround;
+	const float Acceleration = FMath::Clamp(MoveInput, -1.f, 1.f) * Params.MaxAcceleration;
+	const int32 MaxIterations = FMath::Max(Params.MaxSimulationIterations, 1);
+
+	float RemainingTime = DeltaTime;
+	for (int32 Iteration = 0; Iteration < MaxIterations && RemainingTime >= MIN_TICK_TIME; ++Iteration)
+	{
+		// The last iteration takes whatever time is left, like UCharacterMovementComponent::GetSimulationTimeStep
+		const float TimeTick = Iteration + 1 < MaxIterations ? FMath::Min(RemainingTime, Params.MaxSimulationTimeStep) : RemainingTime;
+		RemainingTime -= TimeTick;
+
+		const FVector OldVelocity = Body.Velocity;
+		FVector Delta;
+		if (Body.bOnGround)
+		{
+			float VelocityX = Body.Velocity.X;
+			CalcVelocity(VelocityX, Acceleration, TimeTick, Params.GroundFriction, Params.BrakingDecelerationWalking);
+			Body.Velocity = FVector(VelocityX, 0.f, 0.f);
+			Delta = Body.Velocity * TimeTick;
+		}
+		else
+		{
+			// Air control is boosted while barely moving sideways, see UCharacterMovementComponent::BoostAirControl
+			float AirControl = Params.AirControl;
+			if (AirControl != 0.f && Params.AirControlBoostMultiplier > 0.f
+				&& FMath::Square(Body.Velocity.X) < FMath::Square(Params.AirControlBoostVelocityThreshold))
+			{
+				AirControl = FMath::Min(1.f, Params.AirControlBoostMultiplier * AirControl);
+			}
+			float VelocityX = Body.Velocity.X;
+			CalcVelocity(VelocityX, Acceleration * AirControl, TimeTick, Params.FallingLateralFriction, Params.BrakingDecelerationFalling);
+			Body.Velocity.X = VelocityX;
+			Body.Velocity.Z = FMath::Max(Body.Velocity.Z + Params.GravityZ * TimeTick, static_cast<double>(Params.MaxFallSpeed));
+			// Midpoint integration, as in PhysFalling
+			Delta = 0.5f * (OldVelocity + Body.Velocity) * TimeTick;
+		}
+
+		if (MoveX(TileCollision, Body, Delta.X))
+		{
+			Body.Velocity.X = 0.f;
+		}
+
+		if (Body.bOnGround)
+		{
+			float FloorDistance;
+			if (TileCollision.Probe(Body.Location, EPTileProbeDirection::Down, Body.HalfExtent.Y + GroundSnapDistance, Body.HalfExtent.X - ContactSkin, FloorDistance))
+			{
+				Body.Location.Z -= FloorDistance - Body.HalfExtent.Y;
+			}
+			else
+			{
+				Body.bOnGround = false;
+			}
+		}
+		else if (MoveZ(TileCollision, Body, Delta.Z))
+		{
+			Body.bOnGround = Delta.Z < 0.f;
+			Body.Velocity.Z = 0.f;
+		}
+	}
+
+	return Body.bOnGround != bWasOnGround;
+}
+
+void FPKinematicMover2D::CalcVelocity(float& VelocityX, float Acceleration, float DeltaTime, float Friction, float BrakingDeceleration) const
+{
+	const float MaxSpeed = Params.MaxWalkSpeed;
+	const bool bZeroAcceleration = Acceleration == 0.f;
+	const bool bVelocityOverMax = FMath::Square(VelocityX) > FMath::Square(MaxSpeed) * PKinematicMover2D::OverVelocityPercent;
+
+	if (bZeroAcceleration || bVelocityOverMax)
+	{
+		const float OldVelocityX = VelocityX;
+		ApplyVelocityBraking(VelocityX, DeltaTime, Params.bUseSeparateBrakingFriction ? Params.BrakingFriction : Friction, BrakingDeceleration);
+
+		// Don't brake below max speed while accelerating the same way
+		if (bVelocityOverMax && FMath::Abs(VelocityX) < MaxSpeed && Acceleration * OldVelocityX > 0.f)
+		{
+			VelocityX = FMath::Sign(OldVelocityX) * MaxSpeed;
+		}
+	}
+	else
+	{
+		// Friction only affects the velocity against the acceleration, which in 1D is turning around
+		const float AccelerationDirection = FMath::Sign(Acceleration);
+		VelocityX -= (VelocityX - AccelerationDirection * FMath::Abs(VelocityX)) * FMath::Min(DeltaTime * Friction, 1.f);
+	}
+
+	if (!bZeroAcceleration)
+	{
+		const float MaxInputSpeed = MaxSpeed * FMath::Min(FMath::Abs(Acceleration) / FMath::Max(Params.MaxAcceleration, KINDA_SMALL_NUMBER), 1.f);
+		const float NewMaxInputSpeed = FMath::Square(VelocityX) > FMath::Square(MaxInputSpeed) * PKinematicMover2D::OverVelocityPercent
+			? FMath::Abs(VelocityX) : MaxInputSpeed;
+		VelocityX = FMath::Clamp(VelocityX + Acceleration * DeltaTime, -NewMaxInputSpeed, NewMaxInputSpeed);
+	}
+}
+
+void FPKinematicMover2D::ApplyVelocityBraking(float& VelocityX, float DeltaTime, float Friction, float BrakingDeceleration) const
+{
+	if (VelocityX == 0.f || DeltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	Friction = FMath::Max(0.f, Friction * FMath::Max(0.f, Params.BrakingFrictionFactor));
+	BrakingDeceleration = FMath::Max(0.f, BrakingDeceleration);
+	const bool bZeroFriction = Friction == 0.f;
+	const bool bZeroBraking = BrakingDeceleration == 0.f;
+	if (bZeroFriction && bZeroBraking)
+	{
+		return;
+	}
+
+	const float OldVelocityX = VelocityX;
+	const float ReverseAcceleration = bZeroBraking ? 0.f : -BrakingDeceleration * FMath::Sign(VelocityX);
+	const float MaxTimeStep = FMath::Clamp(Params.BrakingSubStepTime, 1.f / 75.f, 1.f / 20.f);
+
+	// Sub-stepped so the result does not depend on the frame rate
+	float RemainingTime = DeltaTime;
+	while (RemainingTime >= MIN_TICK_TIME)
+	{
+		const float TimeTick = RemainingTime > MaxTimeStep && !bZeroFriction ? FMath::Min(MaxTimeStep, RemainingTime * 0.5f) : RemainingTime;
+		RemainingTime -= TimeTick;
+
+		VelocityX += (-Friction * VelocityX + ReverseAcceleration) * TimeTick;
+		if (VelocityX * OldVelocityX <= 0.f)
+		{
+			VelocityX = 0.f;
+			return;
+		}
+	}
+
+	if (FMath::Square(VelocityX) <= KINDA_SMALL_NUMBER || (!bZeroBraking && FMath::Abs(VelocityX) < BRAKE_TO_STOP_VELOCITY))
+	{
+		VelocityX = 0.f;
+	}
+}
+
+bool FPKinematicMover2D::MoveX(const UPTileCollisionSubsystem& TileCollision, FPKinematicBody2D& Body, float Delta) const
+{
+	if (Delta == 0.f)
+	{
+		return false;
+	}
+
+	const float Distance = FMath::Abs(Delta);
+	float WallDistance;
+	if (TileCollision.Probe(Body.Location, Delta > 0.f ? EPTileProbeDirection::Right : EPTileProbeDirection::Left,
+		Body.HalfExtent.X + Distance, Body.HalfExtent.Y - ContactSkin, WallDistance))
+	{
+		Body.Location.X += FMath::Sign(Delta) * FMath::Clamp(WallDistance - static_cast<float>(Body.HalfExtent.X), 0.f, Distance);
+		return true;
+	}
+
+	Body.Location.X += Delta;
+	return false;
+}
+
+bool FPKinematicMover2D::MoveZ(const UPTileCollisionSubsystem& TileCollision, FPKinematicBody2D& Body, float Delta) const
+{
+	if (Delta == 0.f)
+	{
+		return false;
+	}
+
+	const float Distance = FMath::Abs(Delta);
+	float SurfaceDistance;
+	if (TileCollision.Probe(Body.Location, Delta > 0.f ? EPTileProbeDirection::Up : EPTileProbeDirection::Down,
+		Body.HalfExtent.Y + Distance, Body.HalfExtent.X - ContactSkin, SurfaceDistance))
+	{
+		Body.Location.Z += FMath::Sign(Delta) * FMath::Clamp(SurfaceDistance - static_cast<float>(Body.HalfExtent.Y), 0.f, Distance);
+		return true;
+	}
+
+	Body.Location.Z += Delta;
+	return false;
+}
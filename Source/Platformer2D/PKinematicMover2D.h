@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCharacterMovementComponent;
+class UPTileCollisionSubsystem;
+
+/** Movement tuning of FPKinematicMover2D, named and defaulted like the UCharacterMovementComponent properties it mirrors. */
+struct PLATFORMER2D_API FPKinematicMoveParams2D
+{
+	float GravityZ = -980.f;
+	/**
+	 * Vertical speed is clamped to this, the negated TerminalVelocity of the physics volume as in UCharacterMovementComponent.
+	 * Owners with their own clamp, like APCharacter::MaxFallSpeed, still apply it on top.
+	 */
+	float MaxFallSpeed = -4000.f;
+	float MaxWalkSpeed = 600.f;
+	float MaxAcceleration = 2048.f;
+	float GroundFriction = 8.f;
+	float BrakingFriction = 0.f;
+	float BrakingFrictionFactor = 2.f;
+	bool bUseSeparateBrakingFriction = false;
+	float BrakingDecelerationWalking = 2048.f;
+	float BrakingDecelerationFalling = 0.f;
+	float FallingLateralFriction = 0.f;
+	float AirControl = 0.05f;
+	float AirControlBoostMultiplier = 2.f;
+	float AirControlBoostVelocityThreshold = 25.f;
+	float BrakingSubStepTime = 1.f / 33.f;
+	/** Longest simulated step, longer updates are split like UCharacterMovementComponent::MaxSimulationTimeStep. */
+	float MaxSimulationTimeStep = 0.05f;
+	int32 MaxSimulationIterations = 8;
+
+	/** Copies the tuning of a character's movement component, GravityZ includes the world gravity and GravityScale. */
+	static FPKinematicMoveParams2D FromMovementComponent(const UCharacterMovementComponent& MovementComponent);
+};
+
+/** State of one body moved by FPKinematicMover2D. Y is left untouched, the body moves on the X/Z plane. */
+struct FPKinematicBody2D
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	/** Half size of the body's box on X and Z. */
+	FVector2D HalfExtent = FVector2D(32.f, 32.f);
+	bool bOnGround = false;
+};
+
+/**
+ * Kinematic box movement against UPTileCollisionSubsystem's grid, reproducing the walking and falling
+ * velocity integration of UCharacterMovementComponent without its physics queries.
+ *
+ * Every step moves the box along X, then along Z, each move swept through the grid's free runs, so a move costs
+ * a few array lookups per overlapped row. Only static tile collision is known to the grid, anything else is passed through.
+ */
+class PLATFORMER2D_API FPKinematicMover2D
+{
+public:
+	/** Gap kept between the box's sides and the rows it is not moving into, so a body resting on the floor can walk. */
+	static constexpr float ContactSkin = 0.1f;
+	/** A walking body stays on the ground as long as the floor is no further below than this. */
+	static constexpr float GroundSnapDistance = 2.f;
+
+	FPKinematicMoveParams2D Params;
+
+	/**
+	 * Advances Body by DeltaTime with MoveInput (-1 to 1) along X.
+	 * @return true if the body changed between standing and falling
+	 */
+	bool Step(const UPTileCollisionSubsystem& TileCollision, FPKinematicBody2D& Body, float MoveInput, float DeltaTime) const;
+
+private:
+	/** UCharacterMovementComponent::CalcVelocity along X. */
+	void CalcVelocity(float& VelocityX, float Acceleration, float DeltaTime, float Friction, float BrakingDeceleration) const;
+	/** UCharacterMovementComponent::ApplyVelocityBraking along X. */
+	void ApplyVelocityBraking(float& VelocityX, float DeltaTime, float Friction, float BrakingDeceleration) const;
+
+	/** Sweeps the box along X. @return true if it was blocked */
+	bool MoveX(const UPTileCollisionSubsystem& TileCollision, FPKinematicBody2D& Body, float Delta) const;
+	/** Sweeps the box along Z. @return true if it was blocked */
+	bool MoveZ(const UPTileCollisionSubsystem& TileCollision, FPKinematicBody2D& Body, float Delta) const;
+};
@@ -0,0 +1,466 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PMovementBenchmarkCommandlet.h"
+
+#include "EngineUtils.h"
+#include "PaperCharacterBase.h"
+#include "PCharacter.h"
+#include "PCharacterMovementComponent.h"
+#include "PCharacterProfiler.h"
+#include "PCommandletWorld.h"
+#include "StateMachineComponent.h"
+#include "StateMachineSubsystem.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPMovementBenchmark, Log, All);
+
+namespace PMovementBenchmark
+{
+	const TCHAR* DefaultPCharacterClass = TEXT("/Game/Blueprints/BP_PCharacter_Primitive.BP_PCharacter_Primitive_C");
+	const TCHAR* DefaultPaperCharacterClass = TEXT("/Game/Blueprints/BP_PaperCharacter.BP_PaperCharacter_C");
+
+	constexpr int32 AgentsPerRow = 50;
+	constexpr float AgentSpacingX = 200.f;
+	constexpr float AgentSpacingZ = 250.f;
+
+	double Percentile(const TArray<double>& Sorted, double Fraction)
+	{
+		if (Sorted.Num() == 0)
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	}
+}
+
+UPMovementBenchmarkCommandlet::UPMovementBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	Seed = 1337;
+	bKinematicMover2D = false;
+	FixedStepRate = -1.f;
+}
+
+int32 UPMovementBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString MapName = TEXT("/Game/Maps/Primitives");
+	FParse::Value(*Params, TEXT("Map="), MapName);
+
+	int32 NumAgents = 100;
+	FParse::Value(*Params, TEXT("Agents="), NumAgents);
+	NumAgents = FMath::Clamp(NumAgents, 1, 10000);
+
+	int32 NumFrames = 600;
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	NumFrames = FMath::Max(NumFrames, 1);
+
+	int32 NumWarmupFrames = 60;
+	FParse::Value(*Params, TEXT("Warmup="), NumWarmupFrames);
+	NumWarmupFrames = FMath::Max(NumWarmupFrames, 0);
+
+	float FPS = 60.f;
+	FParse::Value(*Params, TEXT("FPS="), FPS);
+	const float DeltaTime = 1.f / FMath::Max(FPS, 1.f);
+
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	int32 RollbackFrames = 0;
+	FParse::Value(*Params, TEXT("Rollback="), RollbackFrames);
+	RollbackFrames = FMath::Clamp(RollbackFrames, 0, 120);
+
+	double RollbackBudget = 1000.0;
+	FParse::Value(*Params, TEXT("RollbackBudget="), RollbackBudget);
+	bool bOverBudget = false;
+
+	FString Mover = TEXT("Character");
+	FParse::Value(*Params, TEXT("Mover="), Mover);
+	if (Mover != TEXT("Character") && Mover != TEXT("Kinematic2D"))
+	{
+		UE_LOG(LogPMovementBenchmark, Error, TEXT("Unknown -Mover=%s, expected Character or Kinematic2D"), *Mover);
+		return 1;
+	}
+	bKinematicMover2D = Mover == TEXT("Kinematic2D");
+
+	FParse::Value(*Params, TEXT("FixedStepRate="), FixedStepRate);
+
+	FString ClassFilter = TEXT("Both");
+	FParse::Value(*Params, TEXT("Class="), ClassFilter);
+
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("MovementBenchmark-%s.csv"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	struct FBenchmarkClass
+	{
+		FString Name;
+		UClass* Class;
+	};
+	TArray<FBenchmarkClass> Classes;
+
+	if (ClassFilter == TEXT("Both") || ClassFilter == TEXT("PCharacter"))
+	{
+		FString ClassPath = PMovementBenchmark::DefaultPCharacterClass;
+		FParse::Value(*Params, TEXT("PCharacterClass="), ClassPath);
+		UClass* Class = LoadClass<APCharacter>(nullptr, *ClassPath);
+		if (!Class)
+		{
+			UE_LOG(LogPMovementBenchmark, Warning, TEXT("Could not load %s, falling back to the native APCharacter"), *ClassPath);
+			Class = APCharacter::StaticClass();
+		}
+		Classes.Add({ bKinematicMover2D ? TEXT("PCharacter+Kinematic2D") : TEXT("PCharacter"), Class });
+	}
+	if (ClassFilter == TEXT("Both") || ClassFilter == TEXT("PaperCharacterBase"))
+	{
+		FString ClassPath = PMovementBenchmark::DefaultPaperCharacterClass;
+		FParse::Value(*Params, TEXT("PaperCharacterClass="), ClassPath);
+		UClass* Class = LoadClass<APaperCharacterBase>(nullptr, *ClassPath);
+		if (!Class)
+		{
+			UE_LOG(LogPMovementBenchmark, Warning, TEXT("Could not load %s, falling back to the native APaperCharacterBase"), *ClassPath);
+			Class = APaperCharacterBase::StaticClass();
+		}
+		Classes.Add({ bKinematicMover2D ? TEXT("PaperCharacterBase+Kinematic2D") : TEXT("PaperCharacterBase"), Class });
+	}
+	if (Classes.Num() == 0)
+	{
+		UE_LOG(LogPMovementBenchmark, Error, TEXT("Unknown -Class=%s, expected PCharacter, PaperCharacterBase or Both"), *ClassFilter);
+		return 1;
+	}
+
+	UWorld* World = PCommandletWorld::Create(MapName);
+	if (!World)
+	{
+		return 1;
+	}
+
+	FString Csv = TEXT("Class,Category,Agents,Frames,CallsPerFrame,MeanUs,P50Us,P99Us,MaxUs,MeanPerAgentUs\n");
+	FPCharacterProfiler::SetEnabled(true);
+
+	for (const FBenchmarkClass& Entry : Classes)
+	{
+		UE_LOG(LogPMovementBenchmark, Display, TEXT("Benchmarking %d x %s (%s) for %d frames at %.0f FPS"), NumAgents, *Entry.Name, *Entry.Class->GetPathName(), NumFrames, FPS);
+
+		TArray<ACharacter*> Agents = SpawnAgents(World, Entry.Class, NumAgents);
+
+		// State machines are ticked by hand after the world tick so their cost can be separated from the actor tick.
+		// Batched machines go through the subsystem in one call, the rest still tick one by one.
+		// Machines stepped by their owner's movement have their tick off already and are part of the movement's cost.
+		UStateMachineSubsystem* StateMachineSubsystem = World->GetSubsystem<UStateMachineSubsystem>();
+		if (StateMachineSubsystem)
+		{
+			StateMachineSubsystem->SetAutoTick(false);
+		}
+		TArray<UStateMachineComponent*> StateMachines;
+		for (ACharacter* Agent : Agents)
+		{
+			UStateMachineComponent* StateMachine = Agent->FindComponentByClass<UStateMachineComponent>();
+			if (StateMachine && !StateMachine->IsBatched() && StateMachine->IsComponentTickEnabled())
+			{
+				StateMachine->SetComponentTickEnabled(false);
+				StateMachines.Add(StateMachine);
+			}
+		}
+
+		auto TickStateMachines = [StateMachineSubsystem, &StateMachines](float StateMachineDeltaTime)
+		{
+			if (StateMachineSubsystem)
+			{
+				PCHARACTER_COST_SCOPE(StateMachineTick);
+				StateMachineSubsystem->TickMachines(StateMachineDeltaTime);
+			}
+			for (UStateMachineComponent* StateMachine : StateMachines)
+			{
+				PCHARACTER_COST_SCOPE(StateMachineTick);
+				StateMachine->TickComponent(StateMachineDeltaTime, LEVELTICK_All, &StateMachine->PrimaryComponentTick);
+			}
+		};
+
+		FCostSamples CostSamples[static_cast<int32>(EPCharacterCost::Num)];
+		FCostSamples FrameSamples;
+
+		for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; ++Frame)
+		{
+			for (int32 AgentIndex = 0; AgentIndex < Agents.Num(); ++AgentIndex)
+			{
+				ApplyScriptedInput(Agents[AgentIndex], AgentIndex, Frame);
+			}
+
+			FPCharacterProfiler::ResetFrame();
+			FApp::SetDeltaTime(DeltaTime);
+			FApp::SetCurrentTime(FApp::GetCurrentTime() + DeltaTime);
+
+			const uint64 FrameStartCycles = FPlatformTime::Cycles64();
+			World->Tick(LEVELTICK_All, DeltaTime);
+			TickStateMachines(DeltaTime);
+			const uint64 FrameCycles = FPlatformTime::Cycles64() - FrameStartCycles;
+			++GFrameCounter;
+
+			if (Frame < NumWarmupFrames)
+			{
+				continue;
+			}
+
+			FrameSamples.FrameMicroseconds.Add(FPlatformTime::ToMilliseconds64(FrameCycles) * 1000.0);
+			++FrameSamples.TotalCalls;
+			for (int32 CostIndex = 0; CostIndex < static_cast<int32>(EPCharacterCost::Num); ++CostIndex)
+			{
+				const EPCharacterCost Cost = static_cast<EPCharacterCost>(CostIndex);
+				CostSamples[CostIndex].FrameMicroseconds.Add(FPlatformTime::ToMilliseconds64(FPCharacterProfiler::GetCycles(Cost)) * 1000.0);
+				CostSamples[CostIndex].TotalCalls += FPCharacterProfiler::GetCalls(Cost);
+			}
+		}
+
+		WriteRow(Csv, *Entry.Name, TEXT("Frame"), Agents.Num(), FrameSamples);
+		for (int32 CostIndex = 0; CostIndex < static_cast<int32>(EPCharacterCost::Num); ++CostIndex)
+		{
+			WriteRow(Csv, *Entry.Name, FPCharacterProfiler::GetName(static_cast<EPCharacterCost>(CostIndex)), Agents.Num(), CostSamples[CostIndex]);
+		}
+
+		if (RollbackFrames > 0 && Agents.Num() > 0)
+		{
+			FCostSamples RollbackSamples;
+			double MaxDivergence = 0.0;
+			SIZE_T SnapshotSize = 0;
+			if (Agents[0]->IsA<APCharacter>())
+			{
+				SnapshotSize = sizeof(FPCharacterSnapshot);
+				RunRollback<APCharacter, FPCharacterSnapshot>(World, Agents, NumWarmupFrames + NumFrames, NumFrames, RollbackFrames, DeltaTime,
+					TickStateMachines, RollbackSamples, MaxDivergence);
+			}
+			else
+			{
+				SnapshotSize = sizeof(FPPaperCharacterSnapshot);
+				RunRollback<APaperCharacterBase, FPPaperCharacterSnapshot>(World, Agents, NumWarmupFrames + NumFrames, NumFrames, RollbackFrames, DeltaTime,
+					TickStateMachines, RollbackSamples, MaxDivergence);
+			}
+			WriteRow(Csv, *Entry.Name, TEXT("Rollback"), Agents.Num(), RollbackSamples);
+
+			// WriteRow leaves the samples sorted
+			const TArray<double>& Sorted = RollbackSamples.FrameMicroseconds;
+			const double P99 = PMovementBenchmark::Percentile(Sorted, 0.99);
+			UE_LOG(LogPMovementBenchmark, Display, TEXT("%s: rolling back %d agents by %d frames took %.1fus at p50 and %.1fus at p99, %d bytes per snapshot, max divergence %.3f"),
+				*Entry.Name, Agents.Num(), RollbackFrames, PMovementBenchmark::Percentile(Sorted, 0.5), P99, static_cast<int32>(SnapshotSize), MaxDivergence);
+			if (P99 > RollbackBudget)
+			{
+				UE_LOG(LogPMovementBenchmark, Error, TEXT("%s: rollback p99 of %.1fus is over the %.0fus budget"), *Entry.Name, P99, RollbackBudget);
+				bOverBudget = true;
+			}
+		}
+
+		for (ACharacter* Agent : Agents)
+		{
+			Agent->Destroy();
+		}
+		if (StateMachineSubsystem)
+		{
+			StateMachineSubsystem->SetAutoTick(true);
+		}
+	}
+
+	FPCharacterProfiler::SetEnabled(false);
+	PCommandletWorld::Destroy(World);
+
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(OutputPath));
+	if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+	{
+		UE_LOG(LogPMovementBenchmark, Error, TEXT("Failed to write %s"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogPMovementBenchmark, Display, TEXT("Wrote %s"), *OutputPath);
+	// The CSV is still written so an over budget run can be looked at
+	return bOverBudget ? 1 : 0;
+}
+
+TArray<ACharacter*> UPMovementBenchmarkCommandlet::SpawnAgents(UWorld* World, UClass* CharacterClass, int32 NumAgents) const
+{
+	FVector Origin(0.f, 0.f, 300.f);
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Origin = It->GetActorLocation();
+		break;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<ACharacter*> Agents;
+	Agents.Reserve(NumAgents);
+	for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+	{
+		const FVector Location = Origin + FVector(
+			(AgentIndex % PMovementBenchmark::AgentsPerRow) * PMovementBenchmark::AgentSpacingX,
+			0.f,
+			(AgentIndex / PMovementBenchmark::AgentsPerRow) * PMovementBenchmark::AgentSpacingZ);
+
+		ACharacter* Agent = World->SpawnActor<ACharacter>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParams);
+		if (!Agent)
+		{
+			continue;
+		}
+		// Agents have no controller, so let the movement component simulate the scripted input anyway.
+		Agent->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+		if (UPCharacterMovementComponent* MovementComponent = Cast<UPCharacterMovementComponent>(Agent->GetCharacterMovement()))
+		{
+			MovementComponent->bUseKinematicMover2D = bKinematicMover2D;
+			if (FixedStepRate == 0.f)
+			{
+				MovementComponent->bUseFixedTimestep = false;
+			}
+			else if (FixedStepRate > 0.f)
+			{
+				MovementComponent->bUseFixedTimestep = true;
+				MovementComponent->FixedStepRate = FixedStepRate;
+			}
+		}
+		Agents.Add(Agent);
+	}
+	return Agents;
+}
+
+void UPMovementBenchmarkCommandlet::ApplyScriptedInput(ACharacter* Character, int32 AgentIndex, int32 Frame) const
+{
+	// Every agent gets its own deterministic phase so jumps and dashes are spread across frames.
+	const uint32 Hash = HashCombine(GetTypeHash(Seed), GetTypeHash(AgentIndex));
+	const int32 TurnPeriod = 90 + Hash % 60;
+	const int32 JumpPeriod = 45;
+	const int32 DashPeriod = 120;
+
+	const float Axis = ((Frame + Hash) / TurnPeriod) % 2 == 0 ? 1.f : -1.f;
+	const bool bJumpPressed = (Frame + Hash) % JumpPeriod == 0;
+	const bool bJumpReleased = (Frame + Hash) % JumpPeriod == 1;
+	const bool bDashPressed = (Frame + Hash / 7) % DashPeriod == 0;
+
+	if (APCharacter* PCharacter = Cast<APCharacter>(Character))
+	{
+		PCharacter->MoveRight(Axis);
+		if (bJumpPressed)
+		{
+			PCharacter->Jump();
+		}
+	}
+	else if (APaperCharacterBase* PaperCharacter = Cast<APaperCharacterBase>(Character))
+	{
+		PaperCharacter->MoveRight(Axis);
+		if (bJumpPressed)
+		{
+			PaperCharacter->Jump();
+		}
+		if (bDashPressed)
+		{
+			PaperCharacter->Dash();
+		}
+	}
+
+	if (bJumpReleased)
+	{
+		Character->StopJumping();
+	}
+}
+
+template <typename CharacterType, typename SnapshotType>
+void UPMovementBenchmarkCommandlet::RunRollback(UWorld* World, const TArray<ACharacter*>& Agents, int32 FirstFrame, int32 NumFrames, int32 RollbackFrames, float DeltaTime,
+	TFunctionRef<void(float)> TickStateMachines, FCostSamples& OutSamples, double& OutMaxDivergence) const
+{
+	const int32 NumAgents = Agents.Num();
+	TArray<CharacterType*> Characters;
+	TArray<UPCharacterMovementComponent*> MovementComponents;
+	for (ACharacter* Agent : Agents)
+	{
+		Characters.Add(CastChecked<CharacterType>(Agent));
+		MovementComponents.Add(CastChecked<UPCharacterMovementComponent>(Agent->GetCharacterMovement()));
+	}
+
+	// Snapshots taken at the end of each of the last RollbackFrames + 1 frames
+	const int32 HistoryLength = RollbackFrames + 1;
+	TArray<SnapshotType> History;
+	History.SetNumUninitialized(HistoryLength * NumAgents);
+	auto GetSnapshot = [&History, HistoryLength, NumAgents](int32 Frame, int32 AgentIndex) -> SnapshotType&
+	{
+		return History[(Frame % HistoryLength) * NumAgents + AgentIndex];
+	};
+
+	const int32 EndFrame = FirstFrame + RollbackFrames + NumFrames;
+	for (int32 Frame = FirstFrame; Frame < EndFrame; ++Frame)
+	{
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			ApplyScriptedInput(Agents[AgentIndex], AgentIndex, Frame);
+		}
+		FApp::SetDeltaTime(DeltaTime);
+		FApp::SetCurrentTime(FApp::GetCurrentTime() + DeltaTime);
+		World->Tick(LEVELTICK_All, DeltaTime);
+		TickStateMachines(DeltaTime);
+		++GFrameCounter;
+
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			Characters[AgentIndex]->SaveState(GetSnapshot(Frame, AgentIndex));
+		}
+		if (Frame - FirstFrame < RollbackFrames)
+		{
+			continue;
+		}
+
+		// Go back to the end of frame Frame - RollbackFrames and simulate the frames after it again.
+		// The world clock is rewound with it so timestamps like the dash cooldown compare against the same times.
+		const double Now = World->TimeSeconds;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			Characters[AgentIndex]->RestoreState(GetSnapshot(Frame - RollbackFrames, AgentIndex));
+		}
+		World->TimeSeconds = Now - RollbackFrames * DeltaTime;
+		for (int32 ResimFrame = Frame - RollbackFrames + 1; ResimFrame <= Frame; ++ResimFrame)
+		{
+			World->TimeSeconds += DeltaTime;
+			for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+			{
+				CharacterType* Character = Characters[AgentIndex];
+				UPCharacterMovementComponent* MovementComponent = MovementComponents[AgentIndex];
+				ApplyScriptedInput(Character, AgentIndex, ResimFrame);
+				Character->TickActor(DeltaTime, LEVELTICK_All, Character->PrimaryActorTick);
+				MovementComponent->TickComponent(DeltaTime, LEVELTICK_All, &MovementComponent->PrimaryComponentTick);
+			}
+			TickStateMachines(DeltaTime);
+		}
+		World->TimeSeconds = Now;
+		const uint64 RollbackCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		OutSamples.FrameMicroseconds.Add(FPlatformTime::ToMilliseconds64(RollbackCycles) * 1000.0);
+		OutSamples.TotalCalls += NumAgents;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			const double Divergence = FVector::Dist(Characters[AgentIndex]->GetActorLocation(), GetSnapshot(Frame, AgentIndex).Movement.Location);
+			OutMaxDivergence = FMath::Max(OutMaxDivergence, Divergence);
+		}
+	}
+}
+
+void UPMovementBenchmarkCommandlet::WriteRow(FString& Csv, const TCHAR* ClassName, const TCHAR* Category, int32 NumAgents, FCostSamples& Samples) const
+{
+	TArray<double>& Sorted = Samples.FrameMicroseconds;
+	Sorted.Sort();
+
+	const int32 NumFrames = Sorted.Num();
+	double Sum = 0.0;
+	for (const double Sample : Sorted)
+	{
+		Sum += Sample;
+	}
+	const double Mean = NumFrames > 0 ? Sum / NumFrames : 0.0;
+	const double CallsPerFrame = NumFrames > 0 ? static_cast<double>(Samples.TotalCalls) / NumFrames : 0.0;
+
+	Csv += FString::Printf(TEXT("%s,%s,%d,%d,%.2f,%.3f,%.3f,%.3f,%.3f,%.4f\n"),
+		ClassName, Category, NumAgents, NumFrames, CallsPerFrame, Mean,
+		PMovementBenchmark::Percentile(Sorted, 0.5),
+		PMovementBenchmark::Percentile(Sorted, 0.99),
+		NumFrames > 0 ? Sorted.Last() : 0.0,
+		NumAgents > 0 ? Mean / NumAgents : 0.0);
+}
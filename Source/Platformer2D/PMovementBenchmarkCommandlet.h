@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PMovementBenchmarkCommandlet.generated.h"
+
+class ACharacter;
+
+/**
+ * Headless many-agent movement benchmark.
+ *
+ * Loads a map, spawns N characters of each requested class, drives them with scripted MoveRight/Jump/Dash input
+ * and writes the per-frame cost of the character hot paths to a CSV file.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=PMovementBenchmark -nullrhi -unattended
+ *     [-Map=/Game/Maps/Primitives] [-Agents=100] [-Frames=600] [-Warmup=60] [-FPS=60] [-Seed=1337]
+ *     [-Class=PCharacter|PaperCharacterBase|Both] [-PCharacterClass=<path>] [-PaperCharacterClass=<path>]
+ *     [-Mover=Character|Kinematic2D] [-FixedStepRate=<Hz>] [-Rollback=<frames>] [-RollbackBudget=1000] [-Output=<csv path>]
+ *
+ * With -Rollback, every measured frame is followed by a rollback: all agents are restored to their snapshot from
+ * <frames> frames earlier and simulated again up to the current frame. The p99 of that is checked against
+ * RollbackBudget microseconds, the commandlet returns 1 if any class is over it.
+ *
+ * -FixedStepRate overrides the movement's steps per second, 0 moves once per frame. With fixed steps, the cost of
+ * a second of simulation is the same at any -FPS.
+ */
+UCLASS()
+class PLATFORMER2D_API UPMovementBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPMovementBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FCostSamples
+	{
+		/** Per-frame total cost in microseconds. */
+		TArray<double> FrameMicroseconds;
+		uint64 TotalCalls = 0;
+	};
+
+	TArray<ACharacter*> SpawnAgents(UWorld* World, UClass* CharacterClass, int32 NumAgents) const;
+	void ApplyScriptedInput(ACharacter* Character, int32 AgentIndex, int32 Frame) const;
+
+	/** Simulates NumFrames more frames, restoring every agent RollbackFrames frames back and simulating again after each one. */
+	template <typename CharacterType, typename SnapshotType>
+	void RunRollback(UWorld* World, const TArray<ACharacter*>& Agents, int32 FirstFrame, int32 NumFrames, int32 RollbackFrames, float DeltaTime,
+		TFunctionRef<void(float)> TickStateMachines, FCostSamples& OutSamples, double& OutMaxDivergence) const;
+
+	void WriteRow(FString& Csv, const TCHAR* ClassName, const TCHAR* Category, int32 NumAgents, FCostSamples& Samples) const;
+
+	int32 Seed;
+	/** Agents walk and fall with the kinematic 2D mover instead of the regular character movement. */
+	bool bKinematicMover2D;
+	/** Movement steps per second of the agents, 0 for once per frame, negative keeps the class default. */
+	float FixedStepRate;
+};
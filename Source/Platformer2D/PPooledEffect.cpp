@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PPooledEffect.h"
+
+#include "Engine/Engine.h"
+#include "PaperFlipbookComponent.h"
+#include "TimerManager.h"
+
+APPooledEffect::APPooledEffect()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	Sprite = CreateDefaultSubobject<UPaperFlipbookComponent>(TEXT("Sprite"));
+	Sprite->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Sprite->SetGenerateOverlapEvents(false);
+	Sprite->CanCharacterStepUpOn = ECB_No;
+	Sprite->SetCastShadow(false);
+	Sprite->SetLooping(false);
+	RootComponent = Sprite;
+
+	SetActorEnableCollision(false);
+}
+
+APPooledEffect* APPooledEffect::Play(const UObject* WorldContextObject, TSubclassOf<APPooledEffect> Class, const FTransform& Transform)
+{
+	const UWorld* World = Class ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	UPActorPoolSubsystem* ActorPool = World ? World->GetSubsystem<UPActorPoolSubsystem>() : nullptr;
+	return ActorPool ? ActorPool->Acquire(Class, Transform) : nullptr;
+}
+
+void APPooledEffect::OnAcquiredFromPool_Implementation()
+{
+	Sprite->PlayFromStart();
+
+	const float Duration = Lifetime > 0.f ? Lifetime : Sprite->GetFlipbookLength() / FMath::Max(Sprite->GetPlayRate(), SMALL_NUMBER);
+	GetWorldTimerManager().SetTimer(ReturnTimer, this, &APPooledEffect::ReturnToPool, FMath::Max(Duration, SMALL_NUMBER));
+}
+
+void APPooledEffect::OnReturnedToPool_Implementation()
+{
+	GetWorldTimerManager().ClearTimer(ReturnTimer);
+	Sprite->Stop();
+}
+
+void APPooledEffect::ReturnToPool()
+{
+	if (UPActorPoolSubsystem* ActorPool = GetWorld()->GetSubsystem<UPActorPoolSubsystem>())
+	{
+		ActorPool->Release(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
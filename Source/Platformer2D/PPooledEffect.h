@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "PActorPoolSubsystem.h"
+#include "PPooledEffect.generated.h"
+
+class UPaperFlipbookComponent;
+
+/**
+ * One-shot flipbook effect, like the dash trail, handed out by UPActorPoolSubsystem.
+ * Plays its flipbook once from the start each time it is acquired and goes back to the pool when it is over.
+ */
+UCLASS()
+class PLATFORMER2D_API APPooledEffect : public AActor, public IPPooledActor
+{
+	GENERATED_BODY()
+
+public:
+	APPooledEffect();
+
+	/** Returns the effect this long after it started, for looping flipbooks. 0 uses the flipbook's length. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Effect, meta = (ClampMin = "0"))
+	float Lifetime = 0.f;
+
+	/**
+	 * Takes an effect of Class from the world's pool and plays it.
+	 * @return null if Class is not set or the effect could not be spawned
+	 */
+	static APPooledEffect* Play(const UObject* WorldContextObject, TSubclassOf<APPooledEffect> Class, const FTransform& Transform);
+
+	virtual void OnAcquiredFromPool_Implementation() override;
+	virtual void OnReturnedToPool_Implementation() override;
+
+private:
+	void ReturnToPool();
+
+	UPROPERTY(VisibleAnywhere, Category = Effect)
+	UPaperFlipbookComponent* Sprite;
+
+	FTimerHandle ReturnTimer;
+};
@@ -0,0 +1,460 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PTileCollisionSubsystem.h"
+
+#include "EngineUtils.h"
+#include "PBakedTileCollisionComponent.h"
+#include "PaperTileLayer.h"
+#include "PaperTileMap.h"
+#include "PaperTileMapComponent.h"
+#include "PaperTileSet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPTileCollision, Log, All);
+
+namespace PTileCollision
+{
+	bool IsCollidingTile(const UPaperTileLayer* Layer, int32 X, int32 Y)
+	{
+		const FPaperTileInfo Cell = Layer->GetCell(X, Y);
+		if (!Cell.IsValid())
+		{
+			return false;
+		}
+		const FPaperTileMetadata* Metadata = Cell.TileSet->GetTileMetadata(Cell.GetTileIndex());
+		return Metadata && Metadata->HasCollision();
+	}
+
+	/** Increments a free run, saturating to MAX_uint8 which means "no solid cell in range". */
+	FORCEINLINE uint8 NextRun(uint8 Run)
+	{
+		return Run >= MAX_uint8 - 1 ? MAX_uint8 : Run + 1;
+	}
+}
+
+void UPTileCollisionSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	Rebuild();
+}
+
+void UPTileCollisionSubsystem::Deinitialize()
+{
+	Reset();
+	ReservedAreas.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UPTileCollisionSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPTileCollisionSubsystem::Reset()
+{
+	GridOrigin = FVector2D::ZeroVector;
+	CellSize = 0.f;
+	GridWidth = 0;
+	GridHeight = 0;
+	SolidCounts.Empty();
+	for (TArray<uint8>& Runs : FreeRuns)
+	{
+		Runs.Empty();
+	}
+	BakedComponents.Empty();
+}
+
+void UPTileCollisionSubsystem::Rebuild()
+{
+	Reset();
+
+	TArray<FBox2D> TileRects;
+	float MinTileSize = TNumericLimits<float>::Max();
+
+	for (TActorIterator<AActor> ActorIt(GetWorld()); ActorIt; ++ActorIt)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(*ActorIt);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (GatherTiles(Primitive, TileRects, MinTileSize))
+			{
+				BakedComponents.Add(Primitive);
+			}
+		}
+	}
+
+	if (TileRects.Num() == 0)
+	{
+		return;
+	}
+
+	FBox2D Bounds(ForceInit);
+	for (const FBox2D& Rect : TileRects)
+	{
+		Bounds += Rect;
+	}
+	for (const FBox2D& Area : ReservedAreas)
+	{
+		Bounds += Area;
+	}
+
+	CellSize = MinTileSize;
+	GridOrigin = Bounds.Min;
+	const FVector2D Size = Bounds.GetSize();
+	GridWidth = FMath::Max(1, FMath::CeilToInt(Size.X / CellSize - KINDA_SMALL_NUMBER));
+	GridHeight = FMath::Max(1, FMath::CeilToInt(Size.Y / CellSize - KINDA_SMALL_NUMBER));
+	SolidCounts.SetNumZeroed(GridWidth * GridHeight);
+
+	FIntRect Dirty(GridWidth, GridHeight, -1, -1);
+	for (const FBox2D& Rect : TileRects)
+	{
+		RasterizeRect(Rect, 1, Dirty);
+	}
+
+	BuildFreeRuns();
+
+	UE_LOG(LogPTileCollision, Log, TEXT("Baked %d solid tile rects from %d components into a %dx%d grid (cell size %.1f)"),
+		TileRects.Num(), BakedComponents.Num(), GridWidth, GridHeight, CellSize);
+}
+
+void UPTileCollisionSubsystem::AddComponent(UPrimitiveComponent* Component)
+{
+	TArray<FBox2D> TileRects;
+	float MinTileSize = TNumericLimits<float>::Max();
+	if (!Component || BakedComponents.Contains(Component) || !GatherTiles(Component, TileRects, MinTileSize))
+	{
+		return;
+	}
+
+	// Cells keep their size and origin, smaller tiles or tiles outside the grid need a new layout
+	const FBox2D Bounds = GetBounds().ExpandBy(KINDA_SMALL_NUMBER);
+	const bool bFitsGrid = HasGrid() && MinTileSize >= CellSize - KINDA_SMALL_NUMBER
+		&& !TileRects.ContainsByPredicate([&Bounds](const FBox2D& Rect) { return !Bounds.IsInside(Rect); });
+	if (!bFitsGrid)
+	{
+		Rebuild();
+		return;
+	}
+
+	FIntRect Dirty(GridWidth, GridHeight, -1, -1);
+	for (const FBox2D& Rect : TileRects)
+	{
+		RasterizeRect(Rect, 1, Dirty);
+	}
+	UpdateFreeRuns(Dirty);
+	BakedComponents.Add(Component);
+}
+
+void UPTileCollisionSubsystem::RemoveComponent(UPrimitiveComponent* Component)
+{
+	if (!Component || BakedComponents.Remove(Component) == 0)
+	{
+		return;
+	}
+
+	// The grid has not been laid out again since the component was baked, so its tiles cover the same cells
+	TArray<FBox2D> TileRects;
+	float MinTileSize = TNumericLimits<float>::Max();
+	GatherTiles(Component, TileRects, MinTileSize);
+	FIntRect Dirty(GridWidth, GridHeight, -1, -1);
+	for (const FBox2D& Rect : TileRects)
+	{
+		RasterizeRect(Rect, -1, Dirty);
+	}
+	UpdateFreeRuns(Dirty);
+}
+
+void UPTileCollisionSubsystem::ReserveArea(const FBox2D& Area)
+{
+	ReservedAreas.Add(Area);
+}
+
+void UPTileCollisionSubsystem::ReleaseArea(const FBox2D& Area)
+{
+	ReservedAreas.RemoveSingleSwap(Area);
+}
+
+bool UPTileCollisionSubsystem::GatherTiles(const UPrimitiveComponent* Component, TArray<FBox2D>& OutTileRects, float& InOutMinTileSize) const
+{
+	// Only static tiles can be baked, anything that may move is left to the physics scene
+	if (Component->Mobility != EComponentMobility::Static)
+	{
+		return false;
+	}
+
+	const int32 NumRectsBefore = OutTileRects.Num();
+	if (const UPaperTileMapComponent* TileMapComponent = Cast<UPaperTileMapComponent>(Component))
+	{
+		GatherSolidTiles(TileMapComponent, OutTileRects, InOutMinTileSize);
+	}
+	else if (const UPBakedTileCollisionComponent* BakedComponent = Cast<UPBakedTileCollisionComponent>(Component))
+	{
+		if (BakedComponent->IsCollisionEnabled())
+		{
+			GatherBakedTiles(BakedComponent, OutTileRects, InOutMinTileSize);
+		}
+	}
+	return OutTileRects.Num() > NumRectsBefore;
+}
+
+void UPTileCollisionSubsystem::GatherSolidTiles(const UPaperTileMapComponent* Component, TArray<FBox2D>& OutTileRects, float& InOutMinTileSize) const
+{
+	const UPaperTileMap* TileMap = Component->TileMap;
+	if (!TileMap || !Component->IsCollisionEnabled())
+	{
+		return;
+	}
+	if (TileMap->ProjectionMode != ETileMapProjectionMode::Orthogonal)
+	{
+		UE_LOG(LogPTileCollision, Warning, TEXT("%s is not an orthogonal tile map and is left to the physics scene"), *TileMap->GetName());
+		return;
+	}
+
+	// Tile centers are affine in the tile coordinates, so three lookups give the whole layout
+	const FVector TileOrigin = Component->GetTileCenterPosition(0, 0, 0, true);
+	const FVector StepX = Component->GetTileCenterPosition(1, 0, 0, true) - TileOrigin;
+	const FVector StepY = Component->GetTileCenterPosition(0, 1, 0, true) - TileOrigin;
+	const FVector2D HalfExtent(FMath::Abs(StepX.X) * 0.5f, FMath::Abs(StepY.Z) * 0.5f);
+	if (HalfExtent.X <= KINDA_SMALL_NUMBER || HalfExtent.Y <= KINDA_SMALL_NUMBER)
+	{
+		return;
+	}
+	InOutMinTileSize = FMath::Min3(InOutMinTileSize, HalfExtent.X * 2.f, HalfExtent.Y * 2.f);
+
+	for (const UPaperTileLayer* Layer : TileMap->TileLayers)
+	{
+		if (!Layer || !Layer->GetLayerCollides())
+		{
+			continue;
+		}
+
+		for (int32 Y = 0; Y < Layer->GetLayerHeight(); ++Y)
+		{
+			for (int32 X = 0; X < Layer->GetLayerWidth(); ++X)
+			{
+				if (!PTileCollision::IsCollidingTile(Layer, X, Y))
+				{
+					continue;
+				}
+				const FVector Center = TileOrigin + StepX * X + StepY * Y;
+				const FVector2D Center2D(Center.X, Center.Z);
+				OutTileRects.Emplace(Center2D - HalfExtent, Center2D + HalfExtent);
+			}
+		}
+	}
+}
+
+void UPTileCollisionSubsystem::GatherBakedTiles(const UPBakedTileCollisionComponent* Component, TArray<FBox2D>& OutTileRects, float& InOutMinTileSize) const
+{
+	const FTransform& Transform = Component->GetComponentTransform();
+	const FVector Scale = Transform.GetScale3D().GetAbs();
+	InOutMinTileSize = FMath::Min(InOutMinTileSize, Component->GetTileSize() * FMath::Min(Scale.X, Scale.Z));
+
+	// Merged boxes are rasterized like single tiles, every cell whose center they cover becomes solid
+	for (const FBox& Box : Component->GetBoxes())
+	{
+		const FBox WorldBox = Box.TransformBy(Transform);
+		OutTileRects.Emplace(FVector2D(WorldBox.Min.X, WorldBox.Min.Z), FVector2D(WorldBox.Max.X, WorldBox.Max.Z));
+	}
+}
+
+void UPTileCollisionSubsystem::RasterizeRect(const FBox2D& Rect, int32 Delta, FIntRect& InOutDirty)
+{
+	// Every cell whose center lies inside the rect
+	const int32 MinX = FMath::Max(0, FMath::CeilToInt((Rect.Min.X - GridOrigin.X) / CellSize - 0.5f));
+	const int32 MaxX = FMath::Min(GridWidth - 1, FMath::FloorToInt((Rect.Max.X - GridOrigin.X) / CellSize - 0.5f));
+	const int32 MinZ = FMath::Max(0, FMath::CeilToInt((Rect.Min.Y - GridOrigin.Y) / CellSize - 0.5f));
+	const int32 MaxZ = FMath::Min(GridHeight - 1, FMath::FloorToInt((Rect.Max.Y - GridOrigin.Y) / CellSize - 0.5f));
+	if (MinX > MaxX || MinZ > MaxZ)
+	{
+		return;
+	}
+
+	for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+	{
+		for (int32 X = MinX; X <= MaxX; ++X)
+		{
+			uint16& Count = SolidCounts[ToIndex(X, Z)];
+			Count = static_cast<uint16>(FMath::Clamp<int32>(Count + Delta, 0, MAX_uint16));
+		}
+	}
+	InOutDirty.Min = InOutDirty.Min.ComponentMin(FIntPoint(MinX, MinZ));
+	InOutDirty.Max = InOutDirty.Max.ComponentMax(FIntPoint(MaxX, MaxZ));
+}
+
+void UPTileCollisionSubsystem::BuildFreeRuns()
+{
+	for (TArray<uint8>& Runs : FreeRuns)
+	{
+		Runs.SetNumUninitialized(GridWidth * GridHeight);
+	}
+
+	UpdateFreeRuns(FIntRect(0, 0, GridWidth - 1, GridHeight - 1));
+}
+
+void UPTileCollisionSubsystem::UpdateFreeRuns(const FIntRect& Dirty)
+{
+	if (Dirty.Min.X > Dirty.Max.X || Dirty.Min.Y > Dirty.Max.Y)
+	{
+		return;
+	}
+
+	TArray<uint8>& LeftRuns = FreeRuns[static_cast<int32>(EPTileProbeDirection::Left)];
+	TArray<uint8>& RightRuns = FreeRuns[static_cast<int32>(EPTileProbeDirection::Right)];
+	TArray<uint8>& DownRuns = FreeRuns[static_cast<int32>(EPTileProbeDirection::Down)];
+	TArray<uint8>& UpRuns = FreeRuns[static_cast<int32>(EPTileProbeDirection::Up)];
+
+	// A changed cell moves the nearest solid cell for its whole row and column
+	for (int32 Z = Dirty.Min.Y; Z <= Dirty.Max.Y; ++Z)
+	{
+		uint8 Run = MAX_uint8;
+		for (int32 X = 0; X < GridWidth; ++X)
+		{
+			const int32 Index = ToIndex(X, Z);
+			LeftRuns[Index] = Run;
+			Run = IsSolidCell(Index) ? 0 : PTileCollision::NextRun(Run);
+		}
+
+		Run = MAX_uint8;
+		for (int32 X = GridWidth - 1; X >= 0; --X)
+		{
+			const int32 Index = ToIndex(X, Z);
+			RightRuns[Index] = Run;
+			Run = IsSolidCell(Index) ? 0 : PTileCollision::NextRun(Run);
+		}
+	}
+
+	for (int32 X = Dirty.Min.X; X <= Dirty.Max.X; ++X)
+	{
+		uint8 Run = MAX_uint8;
+		for (int32 Z = 0; Z < GridHeight; ++Z)
+		{
+			const int32 Index = ToIndex(X, Z);
+			DownRuns[Index] = Run;
+			Run = IsSolidCell(Index) ? 0 : PTileCollision::NextRun(Run);
+		}
+
+		Run = MAX_uint8;
+		for (int32 Z = GridHeight - 1; Z >= 0; --Z)
+		{
+			const int32 Index = ToIndex(X, Z);
+			UpRuns[Index] = Run;
+			Run = IsSolidCell(Index) ? 0 : PTileCollision::NextRun(Run);
+		}
+	}
+}
+
+FIntPoint UPTileCollisionSubsystem::ToCell(const FVector& Location) const
+{
+	return FIntPoint(
+		FMath::FloorToInt((Location.X - GridOrigin.X) / CellSize),
+		FMath::FloorToInt((Location.Z - GridOrigin.Y) / CellSize));
+}
+
+bool UPTileCollisionSubsystem::Contains(const FVector& Location) const
+{
+	if (!HasGrid())
+	{
+		return false;
+	}
+	const FIntPoint Cell = ToCell(Location);
+	return IsValidCell(Cell.X, Cell.Y);
+}
+
+bool UPTileCollisionSubsystem::IsSolid(const FVector& Location) const
+{
+	if (!HasGrid())
+	{
+		return false;
+	}
+	const FIntPoint Cell = ToCell(Location);
+	return IsValidCell(Cell.X, Cell.Y) && IsSolidCell(ToIndex(Cell.X, Cell.Y));
+}
+
+bool UPTileCollisionSubsystem::Probe(const FVector& Location, EPTileProbeDirection Direction, float MaxDistance, float HalfThickness, float& OutDistance) const
+{
+	if (!HasGrid())
+	{
+		return false;
+	}
+
+	const bool bHorizontal = Direction == EPTileProbeDirection::Left || Direction == EPTileProbeDirection::Right;
+	const TArray<uint8>& Runs = FreeRuns[static_cast<int32>(Direction)];
+
+	// The probe covers every row (or column) the thickness overlaps
+	const FIntPoint Cell = ToCell(Location);
+	const FIntPoint FirstCell = ToCell(Location - (bHorizontal ? FVector(0.f, 0.f, HalfThickness) : FVector(HalfThickness, 0.f, 0.f)));
+	const FIntPoint LastCell = ToCell(Location + (bHorizontal ? FVector(0.f, 0.f, HalfThickness) : FVector(HalfThickness, 0.f, 0.f)));
+
+	float BestDistance = TNumericLimits<float>::Max();
+	if (bHorizontal)
+	{
+		if (Cell.X < 0 || Cell.X >= GridWidth)
+		{
+			return false;
+		}
+		for (int32 Z = FMath::Max(FirstCell.Y, 0); Z <= FMath::Min(LastCell.Y, GridHeight - 1); ++Z)
+		{
+			const int32 Index = ToIndex(Cell.X, Z);
+			if (IsSolidCell(Index))
+			{
+				BestDistance = 0.f;
+				break;
+			}
+			const uint8 Run = Runs[Index];
+			if (Run == MAX_uint8)
+			{
+				continue;
+			}
+			const float Distance = Direction == EPTileProbeDirection::Right
+				? GridOrigin.X + (Cell.X + 1 + Run) * CellSize - Location.X
+				: Location.X - (GridOrigin.X + (Cell.X - Run) * CellSize);
+			BestDistance = FMath::Min(BestDistance, Distance);
+		}
+	}
+	else
+	{
+		if (Cell.Y < 0 || Cell.Y >= GridHeight)
+		{
+			return false;
+		}
+		for (int32 X = FMath::Max(FirstCell.X, 0); X <= FMath::Min(LastCell.X, GridWidth - 1); ++X)
+		{
+			const int32 Index = ToIndex(X, Cell.Y);
+			if (IsSolidCell(Index))
+			{
+				BestDistance = 0.f;
+				break;
+			}
+			const uint8 Run = Runs[Index];
+			if (Run == MAX_uint8)
+			{
+				continue;
+			}
+			const float Distance = Direction == EPTileProbeDirection::Up
+				? GridOrigin.Y + (Cell.Y + 1 + Run) * CellSize - Location.Z
+				: Location.Z - (GridOrigin.Y + (Cell.Y - Run) * CellSize);
+			BestDistance = FMath::Min(BestDistance, Distance);
+		}
+	}
+
+	if (BestDistance > MaxDistance)
+	{
+		return false;
+	}
+	OutDistance = BestDistance;
+	return true;
+}
+
+void UPTileCollisionSubsystem::AddIgnoredBakedComponents(FCollisionQueryParams& Params) const
+{
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Component : BakedComponents)
+	{
+		if (const UPrimitiveComponent* BakedComponent = Component.Get())
+		{
+			Params.AddIgnoredComponent(BakedComponent);
+		}
+	}
+}
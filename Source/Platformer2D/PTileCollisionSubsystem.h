@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PTileCollisionSubsystem.generated.h"
+
+class UPaperTileMapComponent;
+class UPBakedTileCollisionComponent;
+
+enum class EPTileProbeDirection : uint8
+{
+	Left,
+	Right,
+	Down,
+	Up,
+	Num
+};
+
+/**
+ * Bakes the collision of every tile map (or its UPBakedTileCollisionComponents) in the world into a 2D occupancy grid on the X/Z plane,
+ * so wall, ground and ceiling proximity queries are a handful of array lookups instead of physics sweeps.
+ *
+ * The grid only knows about static tile collision. Callers still need their usual query for anything else,
+ * with the baked components ignored, see AddIgnoredBakedComponents().
+ */
+UCLASS()
+class PLATFORMER2D_API UPTileCollisionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Re-bakes the grid from every tile map component currently in the world. */
+	void Rebuild();
+
+	/**
+	 * Bakes a component registered after the grid was built into the cells it covers, e.g. a streamed in chunk.
+	 * Falls back to Rebuild() if its tiles are smaller than the cells or lie outside the grid.
+	 */
+	void AddComponent(UPrimitiveComponent* Component);
+	/** Takes a component back out of the cells it covers, call it before the component loses its collision or is destroyed. */
+	void RemoveComponent(UPrimitiveComponent* Component);
+
+	/**
+	 * Keeps Area inside the grid on every rebuild, even while no component covers it yet,
+	 * so components added there later don't need a rebuild. Released with ReleaseArea().
+	 */
+	void ReserveArea(const FBox2D& Area);
+	void ReleaseArea(const FBox2D& Area);
+
+	bool HasGrid() const { return GridWidth > 0 && GridHeight > 0; }
+	/** True if Location lies inside the baked area, i.e. the grid is authoritative for static tiles there. */
+	bool Contains(const FVector& Location) const;
+	bool IsSolid(const FVector& Location) const;
+
+	/**
+	 * Finds the nearest solid tile edge from Location in Direction.
+	 * HalfThickness widens the probe perpendicular to Direction, like the radius of a sphere sweep.
+	 * @return true if a solid tile is within MaxDistance, OutDistance is then the distance to its edge.
+	 */
+	bool Probe(const FVector& Location, EPTileProbeDirection Direction, float MaxDistance, float HalfThickness, float& OutDistance) const;
+
+	/** Adds the components whose collision is represented by the grid to the ignore list of a fallback query. */
+	void AddIgnoredBakedComponents(FCollisionQueryParams& Params) const;
+
+	float GetCellSize() const { return CellSize; }
+	/** Area the grid covers on the X/Z plane. */
+	FBox2D GetBounds() const { return FBox2D(GridOrigin, GridOrigin + FVector2D(GridWidth, GridHeight) * CellSize); }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	void Reset();
+	/** @return true if the component's collision is represented by the grid, i.e. it is a tile map or a baked component with solid tiles */
+	bool GatherTiles(const UPrimitiveComponent* Component, TArray<FBox2D>& OutTileRects, float& InOutMinTileSize) const;
+	void GatherSolidTiles(const UPaperTileMapComponent* Component, TArray<FBox2D>& OutTileRects, float& InOutMinTileSize) const;
+	void GatherBakedTiles(const UPBakedTileCollisionComponent* Component, TArray<FBox2D>& OutTileRects, float& InOutMinTileSize) const;
+	/** Adds Delta to the count of every cell whose center lies inside Rect and grows InOutDirty, whose Max is inclusive, by those cells. */
+	void RasterizeRect(const FBox2D& Rect, int32 Delta, FIntRect& InOutDirty);
+	void BuildFreeRuns();
+	/** Recomputes the runs of every row and column crossing Dirty, whose Max is inclusive. */
+	void UpdateFreeRuns(const FIntRect& Dirty);
+
+	FORCEINLINE int32 ToIndex(int32 X, int32 Z) const { return Z * GridWidth + X; }
+	FORCEINLINE bool IsValidCell(int32 X, int32 Z) const { return X >= 0 && Z >= 0 && X < GridWidth && Z < GridHeight; }
+	FORCEINLINE bool IsSolidCell(int32 Index) const { return SolidCounts[Index] > 0; }
+	FIntPoint ToCell(const FVector& Location) const;
+
+	/** World X/Z of the minimum corner of cell (0, 0). */
+	FVector2D GridOrigin;
+	float CellSize = 0.f;
+	int32 GridWidth = 0;
+	int32 GridHeight = 0;
+
+	/** Number of solid tile rects covering each cell, so taking one component out keeps the cells another one still covers. */
+	TArray<uint16> SolidCounts;
+	/** Free cells between each cell and the next solid cell per direction, MAX_uint8 when there is none within range. */
+	TArray<uint8> FreeRuns[static_cast<int32>(EPTileProbeDirection::Num)];
+
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> BakedComponents;
+	TArray<FBox2D> ReservedAreas;
+};
@@ -0,0 +1,350 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PTileMapStreamer.h"
+#include "Platformer2D.h"
+#include "PBakedTileCollisionComponent.h"
+#include "PTileCollisionSubsystem.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/AssetManager.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "PaperTileMap.h"
+#include "PaperTileMapComponent.h"
+
+namespace PTileMapStreaming
+{
+	static FAutoConsoleCommandWithWorld ReportCommand(
+		TEXT("p2d.TileStreaming.Report"),
+		TEXT("Logs the resident chunks of every tile map streamer with their estimated memory."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			for (TActorIterator<APTileMapStreamer> It(World); It; ++It)
+			{
+				It->LogReport();
+			}
+		}));
+}
+
+APTileMapStreamer::APTileMapStreamer()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	Root = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+	Root->SetMobility(EComponentMobility::Static);
+	RootComponent = Root;
+
+	CollisionProfileName = UCollisionProfile::BlockAll_ProfileName;
+}
+
+void APTileMapStreamer::BeginPlay()
+{
+	Super::BeginPlay();
+
+#if WITH_EDITORONLY_DATA
+	// Editor only components are stripped when cooking but still there in PIE, with their baked collision
+	for (UPaperTileMapComponent* SourceComponent : SourceComponents)
+	{
+		if (SourceComponent && SourceComponent->GetWorld() == GetWorld())
+		{
+			TArray<USceneComponent*> Children;
+			SourceComponent->GetChildrenComponents(false, Children);
+			for (USceneComponent* Child : Children)
+			{
+				if (Child->IsA<UPBakedTileCollisionComponent>())
+				{
+					Child->DestroyComponent();
+				}
+			}
+			SourceComponent->DestroyComponent();
+		}
+	}
+#endif
+
+	DeactivationDistance = FMath::Max(DeactivationDistance, ActivationDistance);
+	BucketSize = FMath::Max(ActivationDistance, 100.f);
+
+	ChunkComponents.Init(nullptr, Chunks.Num());
+	ChunkCollisionComponents.Init(nullptr, Chunks.Num());
+	ChunkStates.SetNum(Chunks.Num());
+	const FTransform& Transform = GetActorTransform();
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		const FBox Bounds = Chunks[ChunkIndex].LocalBounds.TransformBy(Transform);
+		FBox2D& WorldBounds = ChunkStates[ChunkIndex].WorldBounds;
+		WorldBounds = FBox2D(FVector2D(Bounds.Min.X, Bounds.Min.Z), FVector2D(Bounds.Max.X, Bounds.Max.Z));
+		StreamedArea += WorldBounds;
+
+		const FIntPoint MinBucket = ToBucket(WorldBounds.Min);
+		const FIntPoint MaxBucket = ToBucket(WorldBounds.Max);
+		for (int32 Y = MinBucket.Y; Y <= MaxBucket.Y; ++Y)
+		{
+			for (int32 X = MinBucket.X; X <= MaxBucket.X; ++X)
+			{
+				Buckets.FindOrAdd(FIntPoint(X, Y)).Add(ChunkIndex);
+			}
+		}
+	}
+
+	// Laid out once over every chunk, so activating one only touches its own cells
+	if (UPTileCollisionSubsystem* TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>())
+	{
+		if (StreamedArea.bIsValid)
+		{
+			TileCollision->ReserveArea(StreamedArea);
+		}
+		TileCollision->Rebuild();
+	}
+}
+
+void APTileMapStreamer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (int32 ChunkIndex : ResidentChunks)
+	{
+		UnloadChunk(ChunkIndex);
+	}
+	ResidentChunks.Empty();
+	Buckets.Empty();
+
+	UPTileCollisionSubsystem* TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+	if (TileCollision && StreamedArea.bIsValid)
+	{
+		TileCollision->ReleaseArea(StreamedArea);
+	}
+	StreamedArea = FBox2D(ForceInit);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APTileMapStreamer::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	FVector2D Focus;
+	if (!GetFocus(Focus))
+	{
+		return;
+	}
+
+	// Unload first, so the memory is free before anything new comes in
+	const float DeactivationDistanceSquared = FMath::Square(DeactivationDistance);
+	for (int32 Index = ResidentChunks.Num() - 1; Index >= 0; --Index)
+	{
+		const int32 ChunkIndex = ResidentChunks[Index];
+		if (ChunkStates[ChunkIndex].WorldBounds.ComputeSquaredDistanceToPoint(Focus) > DeactivationDistanceSquared)
+		{
+			UnloadChunk(ChunkIndex);
+			ResidentChunks.RemoveAtSwap(Index);
+		}
+	}
+
+	const float ActivationDistanceSquared = FMath::Square(ActivationDistance);
+	const FIntPoint MinBucket = ToBucket(Focus - FVector2D(ActivationDistance));
+	const FIntPoint MaxBucket = ToBucket(Focus + FVector2D(ActivationDistance));
+	for (int32 Y = MinBucket.Y; Y <= MaxBucket.Y; ++Y)
+	{
+		for (int32 X = MinBucket.X; X <= MaxBucket.X; ++X)
+		{
+			const TArray<int32>* Bucket = Buckets.Find(FIntPoint(X, Y));
+			if (!Bucket)
+			{
+				continue;
+			}
+			for (int32 ChunkIndex : *Bucket)
+			{
+				if (ChunkStates[ChunkIndex].State == EChunkState::Unloaded
+					&& ChunkStates[ChunkIndex].WorldBounds.ComputeSquaredDistanceToPoint(Focus) <= ActivationDistanceSquared)
+				{
+					RequestChunk(ChunkIndex);
+				}
+			}
+		}
+	}
+
+	for (int32 NumActivated = 0; NumActivated < MaxActivationsPerFrame && LoadedChunks.Num() > 0; ++NumActivated)
+	{
+		ActivateChunk(LoadedChunks[0]);
+		LoadedChunks.RemoveAt(0, 1, false);
+	}
+
+	const bool bWasOverBudget = bOverBudget;
+	bOverBudget = ActiveBytes > static_cast<int64>(MemoryBudgetKB) * 1024;
+	if (bOverBudget && !bWasOverBudget)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s: %d active chunks use %.1f KB, over the budget of %d KB"),
+			*GetName(), NumActiveChunks, ActiveBytes / 1024.0, MemoryBudgetKB);
+	}
+}
+
+bool APTileMapStreamer::GetFocus(FVector2D& OutFocus) const
+{
+	FVector Location;
+	if (const APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0))
+	{
+		Location = CameraManager->GetCameraLocation();
+	}
+	else if (const APawn* Pawn = UGameplayStatics::GetPlayerPawn(this, 0))
+	{
+		Location = Pawn->GetActorLocation();
+	}
+	else
+	{
+		return false;
+	}
+
+	OutFocus = FVector2D(Location.X, Location.Z);
+	return true;
+}
+
+void APTileMapStreamer::RequestChunk(int32 ChunkIndex)
+{
+	FChunkStreamingState& ChunkState = ChunkStates[ChunkIndex];
+	ChunkState.State = EChunkState::Loading;
+	ResidentChunks.Add(ChunkIndex);
+
+	const FSoftObjectPath Path = Chunks[ChunkIndex].TileMap.ToSoftObjectPath();
+	TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Path,
+		FStreamableDelegate::CreateUObject(this, &APTileMapStreamer::OnChunkLoaded, ChunkIndex));
+	if (!Handle)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s: could not load chunk %s"), *GetName(), *Path.ToString());
+		ChunkState.State = EChunkState::Failed;
+		ResidentChunks.Remove(ChunkIndex);
+		return;
+	}
+
+	// The delegate may already have run for a tile map that was in memory
+	ChunkState.Handle = Handle;
+}
+
+void APTileMapStreamer::OnChunkLoaded(int32 ChunkIndex)
+{
+	if (ChunkStates.IsValidIndex(ChunkIndex) && ChunkStates[ChunkIndex].State == EChunkState::Loading)
+	{
+		ChunkStates[ChunkIndex].State = EChunkState::Loaded;
+		LoadedChunks.Add(ChunkIndex);
+	}
+}
+
+void APTileMapStreamer::ActivateChunk(int32 ChunkIndex)
+{
+	const FPTileMapChunk& Chunk = Chunks[ChunkIndex];
+	FChunkStreamingState& ChunkState = ChunkStates[ChunkIndex];
+	check(ChunkState.State == EChunkState::Loaded);
+
+	UPaperTileMap* TileMap = Chunk.TileMap.Get();
+	if (!TileMap)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s: chunk %s failed to load"), *GetName(), *Chunk.TileMap.ToString());
+		ChunkState.State = EChunkState::Failed;
+		ResidentChunks.Remove(ChunkIndex);
+		return;
+	}
+
+	// The component of an earlier activation may not be collected yet
+	const FName Name = MakeUniqueObjectName(this, UPaperTileMapComponent::StaticClass(),
+		*FString::Printf(TEXT("Chunk_%d_%d"), Chunk.Coordinates.X, Chunk.Coordinates.Y));
+	UPaperTileMapComponent* Component = NewObject<UPaperTileMapComponent>(this, Name);
+	Component->SetMobility(EComponentMobility::Static);
+	Component->SetupAttachment(Root);
+	Component->SetRelativeLocation(Chunk.RelativeLocation);
+	Component->SetCollisionProfileName(CollisionProfileName);
+	if (bBakedCollision)
+	{
+		Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+	// Set before registering, a registered static component refuses SetTileMap
+	Component->TileMap = TileMap;
+	Component->RegisterComponent();
+	ChunkComponents[ChunkIndex] = Component;
+
+	UPTileCollisionSubsystem* TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+	if (bBakedCollision && Chunk.CollisionBoxes.Num() > 0)
+	{
+		UPBakedTileCollisionComponent* CollisionComponent = NewObject<UPBakedTileCollisionComponent>(this,
+			MakeUniqueObjectName(this, UPBakedTileCollisionComponent::StaticClass(), *FString::Printf(TEXT("%s_Collision"), *Name.ToString())));
+		CollisionComponent->SetupAttachment(Component);
+		CollisionComponent->SetCollisionProfileName(CollisionProfileName);
+		CollisionComponent->SetBoxes(Chunk.CollisionBoxes, BakedTileSize);
+		CollisionComponent->RegisterComponent();
+		ChunkCollisionComponents[ChunkIndex] = CollisionComponent;
+		if (TileCollision)
+		{
+			TileCollision->AddComponent(CollisionComponent);
+		}
+	}
+	else if (TileCollision)
+	{
+		TileCollision->AddComponent(Component);
+	}
+
+	ChunkState.State = EChunkState::Active;
+	++NumActiveChunks;
+	ActiveBytes += Chunk.EstimatedBytes;
+	INC_DWORD_STAT(STAT_TileMapStreamer_ActiveChunks);
+	INC_MEMORY_STAT_BY(STAT_TileMapStreamer_ChunkMemory, Chunk.EstimatedBytes);
+}
+
+void APTileMapStreamer::UnloadChunk(int32 ChunkIndex)
+{
+	FChunkStreamingState& ChunkState = ChunkStates[ChunkIndex];
+	if (ChunkState.State == EChunkState::Active)
+	{
+		UPTileCollisionSubsystem* TileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+		if (UPBakedTileCollisionComponent* CollisionComponent = ChunkCollisionComponents[ChunkIndex])
+		{
+			if (TileCollision)
+			{
+				TileCollision->RemoveComponent(CollisionComponent);
+			}
+			CollisionComponent->DestroyComponent();
+			ChunkCollisionComponents[ChunkIndex] = nullptr;
+		}
+		if (TileCollision)
+		{
+			TileCollision->RemoveComponent(ChunkComponents[ChunkIndex]);
+		}
+		ChunkComponents[ChunkIndex]->DestroyComponent();
+		ChunkComponents[ChunkIndex] = nullptr;
+		--NumActiveChunks;
+		ActiveBytes -= Chunks[ChunkIndex].EstimatedBytes;
+		DEC_DWORD_STAT(STAT_TileMapStreamer_ActiveChunks);
+		DEC_MEMORY_STAT_BY(STAT_TileMapStreamer_ChunkMemory, Chunks[ChunkIndex].EstimatedBytes);
+	}
+	else if (ChunkState.State == EChunkState::Loaded)
+	{
+		LoadedChunks.Remove(ChunkIndex);
+	}
+
+	if (ChunkState.Handle)
+	{
+		// Cancels a load in flight, otherwise lets the tile map be collected
+		ChunkState.Handle->CancelHandle();
+		ChunkState.Handle.Reset();
+	}
+	ChunkState.State = EChunkState::Unloaded;
+}
+
+FIntPoint APTileMapStreamer::ToBucket(const FVector2D& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / BucketSize), FMath::FloorToInt(Location.Y / BucketSize));
+}
+
+void APTileMapStreamer::LogReport() const
+{
+	static const TCHAR* StateNames[] = { TEXT("Unloaded"), TEXT("Loading"), TEXT("Loaded"), TEXT("Active"), TEXT("Failed") };
+
+	UE_LOG(LogPlatformer2D, Display, TEXT("%s: %d of %d chunks active, %.1f KB of %d KB budget"),
+		*GetName(), NumActiveChunks, Chunks.Num(), ActiveBytes / 1024.0, MemoryBudgetKB);
+	for (int32 ChunkIndex : ResidentChunks)
+	{
+		const FPTileMapChunk& Chunk = Chunks[ChunkIndex];
+		UE_LOG(LogPlatformer2D, Display, TEXT("  (%d, %d) %-8s %5d tiles %8.1f KB  %s"),
+			Chunk.Coordinates.X, Chunk.Coordinates.Y, StateNames[static_cast<int32>(ChunkStates[ChunkIndex].State)],
+			Chunk.NumTiles, Chunk.EstimatedBytes / 1024.0, *Chunk.TileMap.GetAssetName());
+	}
+}
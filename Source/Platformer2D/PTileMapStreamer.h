@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/Actor.h"
+#include "PTileMapStreamer.generated.h"
+
+class UPaperTileMap;
+class UPaperTileMapComponent;
+class UPBakedTileCollisionComponent;
+
+/** One chunk of a tile map split by PTileMapSplitter. */
+USTRUCT()
+struct PLATFORMER2D_API FPTileMapChunk
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, Category = Chunk)
+	TSoftObjectPtr<UPaperTileMap> TileMap;
+
+	/** Chunk coordinates in the source tile map, in chunks. */
+	UPROPERTY(VisibleAnywhere, Category = Chunk)
+	FIntPoint Coordinates = FIntPoint::ZeroValue;
+
+	/** Location of the chunk's tile map component, relative to the streamer. */
+	UPROPERTY(VisibleAnywhere, Category = Chunk)
+	FVector RelativeLocation = FVector::ZeroVector;
+
+	/** Bounds of the chunk's tiles in the streamer's space. */
+	UPROPERTY(VisibleAnywhere, Category = Chunk)
+	FBox LocalBounds = FBox(ForceInit);
+
+	UPROPERTY(VisibleAnywhere, Category = Chunk)
+	int32 NumTiles = 0;
+
+	/** Cells, render vertices and collision of the chunk while it is active, estimated when it was split. */
+	UPROPERTY(VisibleAnywhere, Category = Chunk)
+	int64 EstimatedBytes = 0;
+
+	/** The source's baked collision clipped to the chunk, in the space of the chunk's tile map component. Only used with bBakedCollision. */
+	UPROPERTY(VisibleAnywhere, Category = Chunk)
+	TArray<FBox> CollisionBoxes;
+};
+
+/**
+ * Streams the chunks of one large tile map in and out around the player's camera.
+ *
+ * Chunks closer than ActivationDistance are loaded asynchronously and get their own tile map component, for rendering and collision.
+ * They are dropped again once further than DeactivationDistance, the gap between the two keeps chunks on the edge from flickering in and out.
+ * The number of resident chunks, and with them memory and primitives, depends on the view and not on the length of the level.
+ *
+ * Placed and filled by the PSplitTileMap commandlet. The source tile map component is kept for editing but is editor only,
+ * the streamer removes it when playing in the editor. If the source's collision was baked, each chunk gets its share of the baked boxes.
+ * Chunks are added to and removed from the UPTileCollisionSubsystem grid one by one, the area of all chunks is reserved in it up front.
+ * p2d.TileStreaming.Report logs the resident chunks and their memory against MemoryBudgetKB.
+ */
+UCLASS()
+class PLATFORMER2D_API APTileMapStreamer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	APTileMapStreamer();
+
+	UPROPERTY(VisibleAnywhere, Category = Streaming)
+	TArray<FPTileMapChunk> Chunks;
+
+	/** Chunks whose bounds come closer than this to the camera are loaded. */
+	UPROPERTY(EditAnywhere, Category = Streaming, meta = (ClampMin = "0"))
+	float ActivationDistance = 1500.f;
+
+	/** Active chunks are only unloaded once their bounds are further than this from the camera, should be larger than ActivationDistance. */
+	UPROPERTY(EditAnywhere, Category = Streaming, meta = (ClampMin = "0"))
+	float DeactivationDistance = 2000.f;
+
+	/** Loaded chunks waiting for their component are activated a few per frame, so a fast camera does not cause a hitch. */
+	UPROPERTY(EditAnywhere, Category = Streaming, meta = (ClampMin = "1"))
+	int32 MaxActivationsPerFrame = 2;
+
+	/** Warns once the estimated memory of the active chunks goes over this. */
+	UPROPERTY(EditAnywhere, Category = Streaming, meta = (ClampMin = "0"))
+	int32 MemoryBudgetKB = 8192;
+
+	/** Collision profile of the chunks' tile map components, copied from the source component. */
+	UPROPERTY(EditAnywhere, Category = Collision)
+	FName CollisionProfileName;
+
+	/** The source's collision was baked, chunks collide through a UPBakedTileCollisionComponent with their CollisionBoxes instead of their tiles. */
+	UPROPERTY(VisibleAnywhere, Category = Collision)
+	bool bBakedCollision = false;
+
+	/** Tile size the source's collision was baked with. */
+	UPROPERTY(VisibleAnywhere, Category = Collision)
+	float BakedTileSize = 0.f;
+
+#if WITH_EDITORONLY_DATA
+	/** Tile map components the chunks were split from, removed when playing in the editor. */
+	UPROPERTY(VisibleAnywhere, Category = Streaming)
+	TArray<UPaperTileMapComponent*> SourceComponents;
+#endif
+
+	virtual void Tick(float DeltaTime) override;
+
+	int32 GetNumActiveChunks() const { return NumActiveChunks; }
+	int64 GetActiveBytes() const { return ActiveBytes; }
+
+	/** Logs every resident chunk with its state and memory, and the total against the budget. */
+	void LogReport() const;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	enum class EChunkState : uint8
+	{
+		Unloaded,
+		Loading,
+		/** Loaded and waiting for its component. */
+		Loaded,
+		Active,
+		/** The tile map could not be loaded, never retried. */
+		Failed
+	};
+
+	struct FChunkStreamingState
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+		/** Bounds on the X/Z plane. */
+		FBox2D WorldBounds;
+		EChunkState State = EChunkState::Unloaded;
+	};
+
+	bool GetFocus(FVector2D& OutFocus) const;
+
+	void RequestChunk(int32 ChunkIndex);
+	void OnChunkLoaded(int32 ChunkIndex);
+	void ActivateChunk(int32 ChunkIndex);
+	void UnloadChunk(int32 ChunkIndex);
+
+	FIntPoint ToBucket(const FVector2D& Location) const;
+
+	UPROPERTY(VisibleAnywhere, Category = Streaming)
+	USceneComponent* Root;
+
+	/** Component of each chunk while it is active, indexed like Chunks. */
+	UPROPERTY(Transient)
+	TArray<UPaperTileMapComponent*> ChunkComponents;
+
+	/** Baked collision of each chunk while it is active with bBakedCollision, indexed like Chunks. */
+	UPROPERTY(Transient)
+	TArray<UPBakedTileCollisionComponent*> ChunkCollisionComponents;
+
+	TArray<FChunkStreamingState> ChunkStates;
+	/** Chunks that are not unloaded, the only ones checked for deactivation. */
+	TArray<int32> ResidentChunks;
+	TArray<int32> LoadedChunks;
+
+	/** Chunks by the ActivationDistance sized buckets their bounds overlap, so finding the chunks near the camera doesn't visit the whole level. */
+	TMap<FIntPoint, TArray<int32>> Buckets;
+	float BucketSize = 0.f;
+
+	/** Bounds of all chunks on the X/Z plane, reserved in the tile collision grid while playing. */
+	FBox2D StreamedArea = FBox2D(ForceInit);
+
+	int32 NumActiveChunks = 0;
+	int64 ActiveBytes = 0;
+	bool bOverBudget = false;
+};
@@ -1,51 +1,64 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PaperCharacterBase.h"
+#include "Platformer2D.h"
+#include "PCharacterMovementComponent.h"
+#include "PDashComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "Camera/CameraComponent.h"
+#include "PCameraRig2DComponent.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "PaperFlipbookComponent.h"
 #include "Math/Vector.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/BoxComponent.h"
 #include "DrawDebugHelpers.h"
+#include "Components/InputComponent.h"
 #include "StateMachineComponent.h"
-
-#define COLLISION_GRAPPABLE		ECC_GameTraceChannel1
-#define DETECTION_GRAPPABLE		ECC_GameTraceChannel2
+#include "PCharacterProfiler.h"
+#include "PTileCollisionSubsystem.h"
+#include "PGrappleSubsystem.h"
+#include "PInputRecorderComponent.h"
+#include "PAnimationSet.h"
+#include "PAnimationSetSubsystem.h"
+#include "PActorPoolSubsystem.h"
+#include "PAfterimageTrailComponent.h"
+#include "PEnvironmentSensorComponent.h"
+#include "PPooledEffect.h"
 
 #define GP_TAG_IDLE				"PlayerState.Idle"
 
-const FName GrappleSocket = "Grapple Location";
-
-APaperCharacterBase::APaperCharacterBase()
+APaperCharacterBase::APaperCharacterBase(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UPCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
+	// STATE MACHINE /////////////////////
+	m_StateMachine = CreateDefaultSubobject<UStateMachineComponent>(TEXT("State Machine Component"));
+	m_StateMachine->bBatchTick = false;
+	m_StateMachine->PrimaryComponentTick.bStartWithTickEnabled = false;
+	////////////////////////////////
+
+	m_DashComponent = CreateDefaultSubobject<UPDashComponent>(TEXT("Dash"));
+	m_EnvironmentSensor = CreateDefaultSubobject<UPEnvironmentSensorComponent>(TEXT("Environment Sensor"));
+
+	m_AfterimageTrail = CreateDefaultSubobject<UPAfterimageTrailComponent>(TEXT("Afterimage Trail"));
+	m_AfterimageTrail->SetupAttachment(RootComponent);
+
+	// Blueprints still serialize the old grapple box, keep the subobject but without any collision or overlaps
 	BoxCollider = CreateDefaultSubobject<UBoxComponent>(TEXT("Grapple Detection"));
 	BoxCollider->SetupAttachment(GetCapsuleComponent());
-	BoxCollider->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-	BoxCollider->SetCollisionObjectType(DETECTION_GRAPPABLE);
-	BoxCollider->SetGenerateOverlapEvents(true);
-	BoxCollider->SetCollisionResponseToAllChannels(ECR_Ignore);
-	BoxCollider->SetCollisionResponseToChannel(COLLISION_GRAPPABLE, ECR_Overlap);
+	BoxCollider->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	BoxCollider->SetGenerateOverlapEvents(false);
 	BoxCollider->SetBoxExtent(FVector(420.f, 80.f, 280.f));
 	BoxCollider->SetRelativeLocation(FVector(0.f, 0.f, 420.f));
-	m_springArm = CreateDefaultSubobject<USpringArmComponent>(TEXT("Spring Arm"));
-	m_springArm->TargetArmLength = 1200.f;
-	m_springArm->SetupAttachment(GetSprite());
-
-	// STATE MACHINE /////////////////////
-	m_StateMachine = CreateDefaultSubobject<UStateMachineComponent>(TEXT("State Machine Component"));
-	////////////////////////////////
 
 	
-	m_cameraComponent = CreateDefaultSubobject<UCameraComponent>(TEXT("Camera"));
-	m_cameraComponent->SetupAttachment(m_springArm);
-
-	m_springArm->AddLocalRotation(FRotator(0, 0, -90));
-	m_springArm->bUsePawnControlRotation = true;
-	m_springArm->bInheritPitch = false;
-	m_springArm->bInheritRoll = false;
-	m_springArm->bInheritYaw = false;
+	m_cameraComponent = CreateDefaultSubobject<UPCameraRig2DComponent>(TEXT("Camera"));
+	m_cameraComponent->SetupAttachment(RootComponent);
+
+	m_springArm = CreateDefaultSubobject<USpringArmComponent>(TEXT("Spring Arm"));
+	m_springArm->SetupAttachment(GetSprite());
+	m_springArm->TargetArmLength = 1200.f;
+	m_springArm->bDoCollisionTest = false;
+	m_springArm->PrimaryComponentTick.bCanEverTick = false;
 	
 	// Ground movement
 	GetCharacterMovement()->JumpZVelocity = 900.f;
@@ -66,83 +79,178 @@ APaperCharacterBase::APaperCharacterBase()
 	bUseControllerRotationPitch = false;
 	bUseControllerRotationYaw = false;
 	bUseControllerRotationRoll = false;
-	m_pIsDashInCooldown = false;
-	m_pIsDashActivated = false;
 	m_pJumpsRemaining = maxJumps;
-	m_pCanGrapple = false;
 	m_pIsGrappleActivated = false;
+	m_InputRecorder = nullptr;
+	m_AnimationSet = nullptr;
+}
+
+void APaperCharacterBase::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Placed characters get here while the level loads, so their set loads alongside it
+	SetAnimationSet(m_AnimationSet);
+
+	// Blueprints and levels saved with the spring arm may still override its length
+	const float defaultArmLength = GetDefault<APaperCharacterBase>()->m_springArm->TargetArmLength;
+	if (!FMath::IsNearlyEqual(m_springArm->TargetArmLength, defaultArmLength))
+	{
+		m_cameraComponent->CameraDistance = m_springArm->TargetArmLength;
+	}
+}
+
+void APaperCharacterBase::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(InThis, Collector);
+
+	// The resolver is not reflected, its flipbooks would be collected once the animation set is unloaded
+	CastChecked<APaperCharacterBase>(InThis)->m_AnimationResolver.AddReferencedObjects(Collector);
 }
 
+#if WITH_EDITOR
+void APaperCharacterBase::PostLoad()
+{
+	Super::PostLoad();
+
+	if (HasAnyFlags(RF_ClassDefaultObject) && !m_AnimationSet && m_IdleAnimation)
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s still loads its own flipbooks with the class, move them into an animation set with -run=PCreateAnimationSets"), *GetClass()->GetName());
+	}
+}
+#endif
+
 void APaperCharacterBase::BeginPlay()
 {
 	Super::BeginPlay();
-	
-	BoxCollider->OnComponentBeginOverlap.AddDynamic(this, &APaperCharacterBase::OnGrappleDetectionOverlapBegin);
-	BoxCollider->OnComponentEndOverlap.AddDynamic(this, &APaperCharacterBase::OnGrappleDetectionOverlapEnd);
+
+	// The tuning lives on the character so existing blueprints keep their values
+	m_DashComponent->DashDistance = dashDistance;
+	m_DashComponent->DashDuration = dashDuration;
+	m_DashComponent->Cooldown = timerCooldown;
+	m_AfterimageTrail->SetSource(GetSprite());
+	m_EnvironmentSensor->WallProbeDistance = raycastDistance;
+	m_EnvironmentSensor->TraceChannel = ECC_Visibility;
+
+	UPCharacterMovementComponent* movementComponent = CastChecked<UPCharacterMovementComponent>(GetCharacterMovement());
+	movementComponent->OnSimulationStep.AddUObject(this, &APaperCharacterBase::SimulationStep);
+	movementComponent->SetInterpolatedComponent(GetSprite());
+	if (m_StateMachine->IsBatched())
+	{
+		UE_LOG(LogPlatformer2D, Warning, TEXT("%s: the state machine is batched, it ticks once per frame instead of with the movement"), *GetName());
+	}
+
+	if (UPActorPoolSubsystem* actorPool = GetWorld()->GetSubsystem<UPActorPoolSubsystem>())
+	{
+		actorPool->Prewarm(m_DashEffectClass, m_EffectPoolSize);
+		actorPool->Prewarm(m_WallJumpEffectClass, m_EffectPoolSize);
+		actorPool->Prewarm(m_GrappleEffectClass, m_EffectPoolSize);
+	}
+}
+
+void APaperCharacterBase::PlayEffect(TSubclassOf<APPooledEffect> effectClass) const
+{
+	APPooledEffect::Play(this, effectClass, GetSprite()->GetComponentTransform());
+}
+
+void APaperCharacterBase::SetAnimationSet(UPAnimationSet* AnimationSet)
+{
+	m_AnimationSet = AnimationSet;
+	UPAnimationSetSubsystem* animationSets = GetWorld() ? GetWorld()->GetSubsystem<UPAnimationSetSubsystem>() : nullptr;
+	if (m_AnimationSet && animationSets)
+	{
+		animationSets->RequestAnimationSet(m_AnimationSet, FSimpleDelegate::CreateUObject(this, &APaperCharacterBase::RefreshAnimations));
+	}
+	else
+	{
+		RefreshAnimations();
+	}
+}
+
+void APaperCharacterBase::RefreshAnimations()
+{
+	for (int32 state = 0; state < static_cast<int32>(EPAnimationState::Num); ++state)
+	{
+		m_AnimationResolver.SetFlipbook(static_cast<EPAnimationState>(state), GetFlipbook(static_cast<EPAnimationState>(state)));
+	}
+}
+
+UPaperFlipbook* APaperCharacterBase::GetFlipbook(EPAnimationState State) const
+{
+	UPaperFlipbook* flipbook = m_AnimationSet ? m_AnimationSet->GetFlipbook(State) : nullptr;
+	return flipbook ? flipbook : GetOwnFlipbook(State);
+}
+
+UPaperFlipbook* APaperCharacterBase::GetOwnFlipbook(EPAnimationState State) const
+{
+	switch (State)
+	{
+	case EPAnimationState::Idle:	return m_IdleAnimation;
+	case EPAnimationState::Run:		return m_RunningAnimation;
+	case EPAnimationState::Jump:	return m_JumpingAnimation;
+	case EPAnimationState::Fall:	return m_FallingAnimation;
+	case EPAnimationState::Dash:	return m_DashAnimation;
+	default:						return nullptr;
+	}
+}
+
+void APaperCharacterBase::SetOwnFlipbook(EPAnimationState State, UPaperFlipbook* Flipbook)
+{
+	switch (State)
+	{
+	case EPAnimationState::Idle:	m_IdleAnimation = Flipbook; break;
+	case EPAnimationState::Run:		m_RunningAnimation = Flipbook; break;
+	case EPAnimationState::Jump:	m_JumpingAnimation = Flipbook; break;
+	case EPAnimationState::Fall:	m_FallingAnimation = Flipbook; break;
+	case EPAnimationState::Dash:	m_DashAnimation = Flipbook; break;
+	default:						break;
+	}
 }
 
 void APaperCharacterBase::Tick(float deltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_PaperCharacterBase_Tick);
+	TRACE_CPUPROFILER_EVENT_SCOPE(APaperCharacterBase::Tick);
+	PCHARACTER_COST_SCOPE(Tick);
 	Super::Tick(deltaTime);
 
-	if (!GetCharacterMovement()->IsFalling())
+	// ANIMATIONS //////////////////////////////////
+	// The sprite is only touched when the animation state or facing changes
+	if (m_AnimationResolver.Update(GetSprite(), GetCharacterMovement()->GetLastUpdateVelocity(), GetCharacterMovement()->IsFalling(), IsMovementBlocked()))
 	{
-		m_pJumpsRemaining = maxJumps;
+		INC_DWORD_STAT(STAT_PaperCharacterBase_SpriteUpdates);
 	}
-	// ANIMATIONS //////////////////////////////////
-	if (!IsMovementBlocked())
+	m_AfterimageTrail->SetEmitting(IsMovementBlocked());
+	//////////////////////////////////////////////
+
+	if (m_pIsGrappleActivated)
 	{
-		if (GetCharacterMovement()->GetLastUpdateVelocity().Length() == 0.0f)
-		{
-			GetSprite()->SetFlipbook(m_IdleAnimation);
-		}
-		else
-		{
-			if (GetCharacterMovement()->GetLastUpdateVelocity().X > 0)
-				GetSprite()->SetWorldRotation(FRotator(0, 0, 0));
-			else if (GetCharacterMovement()->GetLastUpdateVelocity().X < 0)
-				GetSprite()->SetWorldRotation(FRotator(0, -180, 0));
-			if (m_RunningAnimation && GetCharacterMovement()->GetLastUpdateVelocity().Z == 0)
-				GetSprite()->SetFlipbook(m_RunningAnimation);
-		}
-		if (GetCharacterMovement()->IsFalling())
-		{
-			if (m_FallingAnimation && m_JumpingAnimation)
-			{
-				if (GetCharacterMovement()->GetLastUpdateVelocity().Z > 0 && m_JumpingAnimation)
-					GetSprite()->SetFlipbook(m_JumpingAnimation);
-				else if (GetCharacterMovement()->GetLastUpdateVelocity().Z < 0 && m_FallingAnimation)
-					GetSprite()->SetFlipbook(m_FallingAnimation);
-			}
-			else if (!m_FallingAnimation && GetCharacterMovement()->GetLastUpdateVelocity().Z != 0)
-			{
-				GetSprite()->SetFlipbook(m_JumpingAnimation);
-			}
+		P2D_DRAW(Grapple, DrawDebugLine(GetWorld(), GetActorLocation(), m_pGrappableLocation, FColor::Red, false, -1.f, 0U, 5.0f));
+	}
+}
 
-		}
+void APaperCharacterBase::SimulationStep(float deltaTime)
+{
+	// Not while dashing, an air dash must not give the jumps back
+	if (GetCharacterMovement()->IsMovingOnGround())
+	{
+		m_pJumpsRemaining = maxJumps;
 	}
-	//////////////////////////////////////////////
 
-	// Dash Handling ////////////////////////////////////////////////////////////
-	if (m_pIsDashActivated)
+	if (m_pIsGrappleActivated)
 	{
-		m_pIsDashInCooldown = true;
-		if (m_pDashTimeElapsed < dashDuration)
-		{
-			LaunchCharacter(GetDashVelocity(), true, true);
-			m_pDashTimeElapsed += deltaTime;
-		}
-		else
+		// Leaving the search area releases the anchor, like the old overlap end did
+		const FVector offset = m_pGrappableLocation - GetActorLocation();
+		if (!GetGrappleArea().IsInside(FVector2D(offset.X, offset.Z)))
 		{
-			m_pIsDashActivated = false;
-			GetWorldTimerManager().SetTimer(m_pDashCooldownTimerHandle, this, &APaperCharacterBase::OnDashCooldownTimerOver, timerCooldown, false);
+			m_pIsGrappleActivated = false;
+			P2D_LOG(Grapple, Log, TEXT("Grapple anchor out of range"));
 		}
 	}
-	/////////////////////////////////////////////////////////////////////////
 
-	if (m_pIsGrappleActivated)
+	if (!m_StateMachine->IsBatched())
 	{
-		DrawDebugLine(GetWorld(), GetActorLocation(), m_pGrappableLocation, FColor::Red, false, -1.f, 0U, 5.0f);
+		m_StateMachine->Step(deltaTime);
 	}
 }
 
@@ -150,114 +258,155 @@ void APaperCharacterBase::Tick(float deltaTime)
 void APaperCharacterBase::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
 {
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &APaperCharacterBase::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &APaperCharacter::StopJumping);
-	// PlayerInputComponent->BindAction("Dash", IE_Pressed, this, &APaperCharacterBase::Dash_Implementation);
+	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &APaperCharacterBase::OnJumpPressed);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &APaperCharacterBase::OnJumpReleased);
+	PlayerInputComponent->BindAction("Dash", IE_Pressed, this, &APaperCharacterBase::Dash);
 	PlayerInputComponent->BindAction("Grapple", IE_Pressed, this, &APaperCharacterBase::Grapple);
 	PlayerInputComponent->BindAxis("MoveRight", this, &APaperCharacterBase::MoveRight);
+
+	m_InputRecorder = UPInputRecorderComponent::CreateIfRequested(this);
 }
 
-void APaperCharacterBase::OnGrappleDetectionOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void APaperCharacterBase::PawnClientRestart()
 {
-	if (OtherComp->GetCollisionObjectType() == COLLISION_GRAPPABLE)
+	Super::PawnClientRestart();
+
+	// Blueprint input events are bound after SetupPlayerInputComponent. A Blueprint dash event launching the character
+	// would run on top of UPDashComponent, blueprints that still have one opt into keeping only the native Dash binding.
+	if (m_IgnoreBlueprintDashEvents && InputComponent)
 	{
-		m_pCanGrapple = true;
-		m_pGrappableLocation = OtherComp->GetSocketLocation("Grapple Location");
-		UE_LOG(LogTemp, Warning, TEXT("Grapple Location: %s"), *m_pGrappableLocation.ToString());
+		for (int32 bindingIndex = InputComponent->GetNumActionBindings() - 1; bindingIndex >= 0; --bindingIndex)
+		{
+			const FInputActionBinding& binding = InputComponent->GetActionBinding(bindingIndex);
+			if (binding.GetActionName() == TEXT("Dash") && !binding.ActionDelegate.GetFunctionName().IsNone())
+			{
+				UE_LOG(LogPlatformer2D, Warning, TEXT("%s: ignoring the Blueprint dash event %s, the dash is handled natively"), *GetName(), *binding.ActionDelegate.GetFunctionName().ToString());
+				InputComponent->RemoveActionBinding(bindingIndex);
+			}
+		}
 	}
 }
 
-void APaperCharacterBase::OnGrappleDetectionOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void APaperCharacterBase::LaunchCharacter(FVector LaunchVelocity, bool bXYOverride, bool bZOverride)
 {
-	if (OtherComp->GetCollisionObjectType() == COLLISION_GRAPPABLE)
-	{
-		m_pCanGrapple = false;
-		//m_pGrappableLocation = OtherComp->GetSocketLocation("Grapple Location");
-		m_pIsGrappleActivated = false;
-		UE_LOG(LogTemp, Warning, TEXT("Grapple Detection Overlap End"));
-	}
+	PCHARACTER_COST_SCOPE(LaunchCharacter);
+	Super::LaunchCharacter(LaunchVelocity, bXYOverride, bZOverride);
 }
 
-void APaperCharacterBase::MoveRight(float value)
+void APaperCharacterBase::SaveState(FPPaperCharacterSnapshot& OutSnapshot) const
 {
-	AddMovementInput(FVector(1.0, 0, 0), value);
+	static_assert(std::is_trivially_copyable_v<FPPaperCharacterSnapshot>, "Snapshots are copied around as plain memory");
+
+	CastChecked<UPCharacterMovementComponent>(GetCharacterMovement())->SaveState(OutSnapshot.Movement);
+	m_StateMachine->SaveState(OutSnapshot.StateMachine);
+	OutSnapshot.NextDashTime = m_DashComponent->GetNextDashTime();
+	OutSnapshot.GrappableLocation = m_pGrappableLocation;
+	OutSnapshot.JumpsRemaining = m_pJumpsRemaining;
+	OutSnapshot.bIsGrappleActivated = m_pIsGrappleActivated;
+	OutSnapshot.Facing = m_AnimationResolver.GetFacing();
 }
-#pragma region DASH
-void APaperCharacterBase::Dash()
+
+void APaperCharacterBase::RestoreState(const FPPaperCharacterSnapshot& Snapshot)
 {
-	if (!m_pIsDashInCooldown && GetVelocity().X != 0.f)
-	{
-		if (m_DashAnimation)
-			GetSprite()->SetFlipbook(m_DashAnimation);
-		m_pDashTimeElapsed = 0.f;
-		m_pIsDashActivated = true;
-		m_pDashTargetLocation = GetActorLocation() + GetSprite()->GetForwardVector() * dashDistance;
-		m_pDashStartLocation = GetActorLocation();
-	}
+	CastChecked<UPCharacterMovementComponent>(GetCharacterMovement())->RestoreState(Snapshot.Movement);
+	m_StateMachine->RestoreState(Snapshot.StateMachine);
+	m_DashComponent->SetNextDashTime(Snapshot.NextDashTime);
+	m_pGrappableLocation = Snapshot.GrappableLocation;
+	m_pJumpsRemaining = Snapshot.JumpsRemaining;
+	m_pIsGrappleActivated = Snapshot.bIsGrappleActivated;
+	m_AnimationResolver.SetFacing(GetSprite(), Snapshot.Facing);
+	// The sensed state belongs to the position before the rollback
+	m_EnvironmentSensor->Invalidate();
 }
 
-void APaperCharacterBase::Dash_Implementation()
+void APaperCharacterBase::MoveRight(float value)
 {
-	if (!m_pIsDashInCooldown && GetVelocity().X != 0.f)
+	if (m_InputRecorder)
 	{
-		if (m_DashAnimation)
-			GetSprite()->SetFlipbook(m_DashAnimation);
-		m_pDashTimeElapsed = 0.f;
-		// m_pIsDashActivated = true;
-		m_pDashTargetLocation = GetActorLocation() + GetSprite()->GetForwardVector() * dashDistance;
-		m_pDashStartLocation = GetActorLocation();
-	
-		// GetCharacterMovement()->bUseSeparateBrakingFriction = false;
-		// GetCharacterMovement()->BrakingFriction = 0;
-		m_pIsDashInCooldown = true;
-		
-		GetWorldTimerManager().SetTimer(m_pDashTimerHandle, this, &APaperCharacterBase::Dash_TimeElapsed, 0.016, true);
+		m_InputRecorder->SetMoveRight(value);
 	}
-	// FApp::GetDeltaTime();
-	
+	AddMovementInput(FVector(1.0, 0, 0), value);
 }
-
-void APaperCharacterBase::Dash_TimeElapsed()
+#pragma region DASH
+bool APaperCharacterBase::IsMovementBlocked() const
 {
-	float timeElapsed = GetWorldTimerManager().GetTimerElapsed(m_pDashTimerHandle);
-	m_pDashTimeElapsed += timeElapsed;
-	UE_LOG(LogTemp, Warning, TEXT("Dash Timer: %f"), m_pDashTimeElapsed)
-	if(m_pDashTimeElapsed >= dashDuration)
-	{
-		GetWorldTimerManager().ClearTimer(m_pDashTimerHandle);
-		GetWorldTimerManager().SetTimer(m_pDashTimerHandle, this, &APaperCharacterBase::OnDashCooldownTimerOver, timerCooldown, false);
-	}
-	LaunchCharacter(GetDashVelocity(), true, true);
+	return m_DashComponent->IsDashing();
 }
 
-void APaperCharacterBase::OnDashCooldownTimerOver()
+void APaperCharacterBase::Dash()
 {
-	m_pIsDashInCooldown = false;
-	GetWorldTimerManager().ClearTimer(m_pDashCooldownTimerHandle);
+	if (m_InputRecorder)
+	{
+		m_InputRecorder->AddCommands(EPInputCommand::Dash);
+	}
+	if (GetVelocity().X != 0.f && m_DashComponent->TryDash(GetSprite()->GetForwardVector()))
+	{
+		PlayEffect(m_DashEffectClass);
+	}
 }
 
-void APaperCharacterBase::OnDashOver()
+#pragma endregion
+FBox2D APaperCharacterBase::GetGrappleArea() const
 {
-	GetCharacterMovement()->bUseSeparateBrakingFriction = true;
-	GetCharacterMovement()->BrakingFriction = 10;
-	GetCharacterMovement()->GroundFriction = 8.0f;
+	return FBox2D(grappleRangeCenter - grappleRangeExtent, grappleRangeCenter + grappleRangeExtent);
 }
 
-#pragma endregion
 void APaperCharacterBase::Grapple()
 {
-	if (m_pCanGrapple)
+	if (m_InputRecorder)
 	{
+		m_InputRecorder->AddCommands(EPInputCommand::Grapple);
+	}
+	const UPGrappleSubsystem* grappleSubsystem = GetWorld()->GetSubsystem<UPGrappleSubsystem>();
+	if (!grappleSubsystem || IsMovementBlocked())
+	{
+		return;
+	}
+
+	FPGrappleQuery query;
+	query.Origin = GetActorLocation();
+	query.Area = GetGrappleArea();
+	query.Direction = GetSprite()->GetForwardVector();
+	query.MinDirectionCos = FMath::Cos(FMath::DegreesToRadians(grappleConeHalfAngle));
+	P2D_DRAW(Grapple, DrawDebugBox(GetWorld(), query.Origin + FVector(grappleRangeCenter.X, 0.f, grappleRangeCenter.Y), FVector(grappleRangeExtent.X, 0.f, grappleRangeExtent.Y), FColor::Yellow, false, 1.f));
+
+	if (grappleSubsystem->FindBestAnchor(query, m_pGrappableLocation))
+	{
+		P2D_LOG(Grapple, Log, TEXT("Grapple Location: %s"), *m_pGrappableLocation.ToString());
 		FVector direction = m_pGrappableLocation - GetActorLocation();
 		m_pIsGrappleActivated = true;
 		direction.Y = 0.f;
 		//DrawDebugLine(GetWorld(), GetActorLocation(), GetActorLocation() + direction*grappleStrengthCoefficient, FColor::Red, true, 5.0f);
 		LaunchCharacter(direction * grappleStrengthCoefficient, true, true);
+		PlayEffect(m_GrappleEffectClass);
+	}
+}
+
+void APaperCharacterBase::OnJumpPressed()
+{
+	if (m_InputRecorder)
+	{
+		m_InputRecorder->AddCommands(EPInputCommand::JumpPressed);
+	}
+	Jump();
+}
+
+void APaperCharacterBase::OnJumpReleased()
+{
+	if (m_InputRecorder)
+	{
+		m_InputRecorder->AddCommands(EPInputCommand::JumpReleased);
 	}
+	StopJumping();
 }
 
 void APaperCharacterBase::Jump()
 {
+	// A launch would end the dash early
+	if (IsMovementBlocked())
+	{
+		return;
+	}
 	FHitResult hit;
 	if (DetectWall(hit) && GetCharacterMovement()->IsFalling())
 	{
@@ -276,17 +425,50 @@ void APaperCharacterBase::WallJump(FHitResult& hit)
 	float sign = FMath::Sign(GetActorLocation().X - hit.Location.X);
 	FVector launchVelocity = FVector(sign * wallJumpHorizontalStrength, 0.0f, GetCharacterMovement()->JumpZVelocity);
 	LaunchCharacter(launchVelocity, true, true);
+	PlayEffect(m_WallJumpEffectClass);
 }
 
 bool APaperCharacterBase::DetectWall(FHitResult& OutHit)
 {
+	SCOPE_CYCLE_COUNTER(STAT_PaperCharacterBase_DetectWall);
+	TRACE_CPUPROFILER_EVENT_SCOPE(APaperCharacterBase::DetectWall);
+	PCHARACTER_COST_SCOPE(DetectWall);
+	if (m_EnvironmentSensor->HasFreshState())
+	{
+		return m_EnvironmentSensor->GetState().GetWallHit(GetSprite()->GetForwardVector().X, OutHit);
+	}
+	INC_DWORD_STAT(STAT_EnvironmentSensor_SyncFallbacks);
+
 	FCollisionQueryParams params;
 	params.AddIgnoredActor(this->GetOwner()); 
 	float radius = GetCapsuleComponent()->GetScaledCapsuleRadius() + raycastDistance;
 	//FVector startPos = GetActorLocation() - GetSprite()->GetForwardVector() * radius;
 	FVector startPos = GetActorLocation();
 	FVector endPos = GetActorLocation() + GetSprite()->GetForwardVector() * radius;
-	DrawDebugLine(GetWorld(), startPos, endPos, FColor::Red);
+	P2D_DRAW(WallDetection, DrawDebugLine(GetWorld(), startPos, endPos, FColor::Red));
+
+	const UPTileCollisionSubsystem* tileCollision = GetWorld()->GetSubsystem<UPTileCollisionSubsystem>();
+	if (!tileCollision || !tileCollision->Contains(startPos))
+	{
+		return GetWorld()->LineTraceSingleByChannel(OutHit, startPos, endPos, ECC_Visibility, params);
+	}
+
+	// Static tiles come from the baked grid, only geometry the grid doesn't know about needs a real trace
+	const FVector direction = (endPos - startPos).GetSafeNormal();
+	const EPTileProbeDirection probeDirection = direction.X >= 0.f ? EPTileProbeDirection::Right : EPTileProbeDirection::Left;
+	float wallDistance;
+	if (tileCollision->Probe(startPos, probeDirection, FMath::Abs(endPos.X - startPos.X), 0.f, wallDistance))
+	{
+		OutHit = FHitResult(startPos, endPos);
+		OutHit.bBlockingHit = true;
+		OutHit.Location = OutHit.ImpactPoint = startPos + direction * wallDistance;
+		OutHit.Normal = OutHit.ImpactNormal = -direction;
+		OutHit.Distance = wallDistance;
+		OutHit.Time = wallDistance / radius;
+		return true;
+	}
+
+	tileCollision->AddIgnoredBakedComponents(params);
 	return GetWorld()->LineTraceSingleByChannel(OutHit, startPos, endPos, ECC_Visibility, params);
 
 }
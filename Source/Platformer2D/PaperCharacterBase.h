@@ -4,9 +4,26 @@
 
 #include "CoreMinimal.h"
 #include "PaperCharacter.h"
+#include "PAnimationResolver.h"
+#include "PCharacterMovementComponent.h"
+#include "StateMachineComponent.h"
 #include "PaperCharacterBase.generated.h"
 
+class APPooledEffect;
 class UPaperFlipbook;
+
+/** Simulation state of an APaperCharacterBase for rollback. Trivially copyable, see APaperCharacterBase::SaveState. */
+struct FPPaperCharacterSnapshot
+{
+	FPMovementSnapshot Movement;
+	FStateMachineSnapshot StateMachine;
+	double NextDashTime;
+	FVector GrappableLocation;
+	int32 JumpsRemaining;
+	bool bIsGrappleActivated;
+	int8 Facing;
+};
+
 /**
  * 
  */
@@ -16,20 +33,41 @@ class PLATFORMER2D_API APaperCharacterBase : public APaperCharacter
 	GENERATED_BODY()
 protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
+	class UPCameraRig2DComponent* m_cameraComponent;
+	/** The old camera arm, the camera follows through m_cameraComponent now. It never ticks and is only kept so blueprints and levels referencing it still load, its TargetArmLength is handed to the camera. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (DeprecatedProperty, DeprecationMessage = "The camera follows through m_cameraComponent, set its CameraDistance and ViewRotation instead."))
 	class USpringArmComponent* m_springArm;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
-	class UCameraComponent* m_cameraComponent;
+	/**
+	 * Stepped with the movement, so its states see the same fixed steps as the movement they drive. Its bBatchTick is off
+	 * for that, a Blueprint turning it back on gets the batched tick, once per frame.
+	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Machine")
 	class UStateMachineComponent* m_StateMachine;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = MovementMechanics)
+	class UPDashComponent* m_DashComponent;
+	/** Walls, ground and ledges around the capsule, sampled once per frame for Jump and the animations. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = ObstacleDetection)
+	class UPEnvironmentSensorComponent* m_EnvironmentSensor;
+	/** Afterimages of the sprite left behind while dashing. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Effects)
+	class UPAfterimageTrailComponent* m_AfterimageTrail;
+	/** The old grapple overlap box, grapple anchors are found through UPGrappleSubsystem now. It has no collision and is only kept so blueprints referencing it still load. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CollisionDetection, meta = (DeprecatedProperty, DeprecationMessage = "Grapple anchors are found through UPGrappleSubsystem, tune grappleRangeCenter and grappleRangeExtent instead."))
+	class UBoxComponent* BoxCollider;
+	/** Flipbooks of the character. Loaded per world by UPAnimationSetSubsystem and shared by every character using the set. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Animations)
+	class UPAnimationSet* m_AnimationSet;
+
+	/**
+	 * The character's own flipbooks, used for the states its animation set has no flipbook for.
+	 * They are hard references, loaded with the class, so prefer a set: PCreateAnimationSets moves them into one.
+	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	UPaperFlipbook* m_IdleAnimation;
-
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	UPaperFlipbook* m_RunningAnimation;
-
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	UPaperFlipbook* m_FallingAnimation;
-
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	UPaperFlipbook* m_JumpingAnimation;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
@@ -44,60 +82,102 @@ protected:
 	float dashDuration = 0.5f;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MovementMechanics)
 	float timerCooldown = 0.5f;
+	/** Removes the Blueprint's own Dash input events, for blueprints still launching the character themselves on top of UPDashComponent. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = MovementMechanics)
+	bool m_IgnoreBlueprintDashEvents = false;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MovementMechanics)
 	float wallJumpHorizontalStrength = 4500.f;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MovementMechanics)
 	float grappleStrengthCoefficient = 2.0f;
+	/** Center of the grapple search area on the X/Z plane, relative to the character. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MovementMechanics)
+	FVector2D grappleRangeCenter = FVector2D(0.f, 420.f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MovementMechanics)
+	FVector2D grappleRangeExtent = FVector2D(420.f, 280.f);
+	/** Anchors further than this from the facing direction are ignored, 180 accepts anchors behind the character too. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = MovementMechanics, meta = (ClampMin = "0", ClampMax = "180"))
+	float grappleConeHalfAngle = 180.f;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=ObstacleDetection)
 	float raycastDistance = 15.f;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=CollisionDetection)
-	class UBoxComponent* BoxCollider;
+	/** Effects played from the world's actor pool, nothing is played while unset. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Effects)
+	TSubclassOf<APPooledEffect> m_DashEffectClass;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Effects)
+	TSubclassOf<APPooledEffect> m_WallJumpEffectClass;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Effects)
+	TSubclassOf<APPooledEffect> m_GrappleEffectClass;
+	/** Effects of each class spawned at begin play, the pool grows past this up to its cap. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Effects, meta = (ClampMin = "0"))
+	int32 m_EffectPoolSize = 4;
 
-	bool m_pIsDashInCooldown;
-	FTimerHandle m_pDashCooldownTimerHandle;
-	FTimerHandle m_pDashTimerHandle;
-	bool m_pIsDashActivated;
-	float m_pDashTimeElapsed;
-	FVector m_pDashTargetLocation;
-	FVector m_pDashStartLocation;
 	int m_pJumpsRemaining;
 
+	FPAnimationResolver m_AnimationResolver;
+
 	FVector m_pGrappableLocation;
-	bool m_pCanGrapple;
 	bool m_pIsGrappleActivated;
 
+	/** Records the player's input when the game runs with -RecordInput, null otherwise. */
+	UPROPERTY(Transient)
+	class UPInputRecorderComponent* m_InputRecorder;
+
 public:
-	APaperCharacterBase();
+	APaperCharacterBase(const FObjectInitializer& ObjectInitializer);
 
-	FORCEINLINE bool IsMovementBlocked() const { return m_pIsDashActivated; }
-	FORCEINLINE FVector GetDashVelocity() const { return (m_pDashTargetLocation - m_pDashStartLocation) / dashDuration;}
+	bool IsMovementBlocked() const;
 
-protected:
+	virtual void LaunchCharacter(FVector LaunchVelocity, bool bXYOverride, bool bZOverride) override;
+
+	void SaveState(FPPaperCharacterSnapshot& OutSnapshot) const;
+	/** Puts the character back into a saved state, without running any state machine or movement mode callbacks. */
+	void RestoreState(const FPPaperCharacterSnapshot& Snapshot);
+
+	/** Switches to another animation set, the flipbooks change once it is loaded. */
+	UFUNCTION(BlueprintCallable, Category = Animations)
+	void SetAnimationSet(UPAnimationSet* AnimationSet);
+
+	/** Rebuilds the animation table from the loaded flipbooks of the animation set and the character's own flipbooks. */
+	UFUNCTION(BlueprintCallable, Category = Animations)
+	void RefreshAnimations();
+
+	/** @return the flipbook played in a state, the animation set's once it is loaded, else the character's own */
+	UFUNCTION(BlueprintPure, Category = Animations)
+	UPaperFlipbook* GetFlipbook(EPAnimationState State) const;
+
+	UPAnimationSet* GetAnimationSet() const { return m_AnimationSet; }
+	/** The character's own flipbook of a state, see m_IdleAnimation. */
+	UPaperFlipbook* GetOwnFlipbook(EPAnimationState State) const;
+	void SetOwnFlipbook(EPAnimationState State, UPaperFlipbook* Flipbook);
+
+	virtual void PostInitializeComponents() override;
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+#if WITH_EDITOR
+	virtual void PostLoad() override;
+#endif
+
+	// Input handlers, public so headless commandlets can drive the character without a controller
+	/** Bound to the Jump action, records the press and jumps. Jump itself stays unrecorded for internal callers. */
+	void OnJumpPressed();
+	void OnJumpReleased();
 	void MoveRight(float value);
 	void Dash();
-
-	void Dash_Implementation();
-	UFUNCTION()
-	void Dash_TimeElapsed();
 	void Jump();
-	void WallJump(FHitResult& hit);
 	void Grapple();
-	UFUNCTION()
-	void OnDashCooldownTimerOver();
-	UFUNCTION()
-	void OnDashOver();
+
+protected:
+	void WallJump(FHitResult& hit);
 protected:
 	virtual void BeginPlay() override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
+	virtual void PawnClientRestart() override;
 
-	UFUNCTION()
-	void OnGrappleDetectionOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
-
-	UFUNCTION()
-	void OnGrappleDetectionOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+	FBox2D GetGrappleArea() const;
+	void PlayEffect(TSubclassOf<APPooledEffect> effectClass) const;
 	virtual void Tick(float deltaTime) override;
+	/** Gameplay logic of one movement step, see UPCharacterMovementComponent::OnSimulationStep. */
+	void SimulationStep(float deltaTime);
 	bool DetectWall(FHitResult& OutHit1);
 
 
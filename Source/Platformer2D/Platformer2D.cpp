@@ -1,6 +1,86 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "Platformer2D.h"
+#include "HAL/IConsoleManager.h"
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Platformer2D, "Platformer2D" );
+
+DEFINE_LOG_CATEGORY(LogPlatformer2D);
+
+DEFINE_STAT(STAT_PCharacter_Tick);
+DEFINE_STAT(STAT_PCharacter_DetectWall);
+DEFINE_STAT(STAT_PaperCharacterBase_Tick);
+DEFINE_STAT(STAT_PaperCharacterBase_DetectWall);
+DEFINE_STAT(STAT_PCharacterMovement_PhysDash);
+DEFINE_STAT(STAT_PCharacterMovement_Kinematic2D);
+DEFINE_STAT(STAT_PCharacterMovement_FixedSteps);
+DEFINE_STAT(STAT_PaperCharacterBase_SpriteUpdates);
+DEFINE_STAT(STAT_TileMapStreamer_ActiveChunks);
+DEFINE_STAT(STAT_TileMapStreamer_ChunkMemory);
+DEFINE_STAT(STAT_ActorPool_Hits);
+DEFINE_STAT(STAT_ActorPool_Misses);
+DEFINE_STAT(STAT_ActorPool_Active);
+DEFINE_STAT(STAT_EnvironmentSensor_AsyncTraces);
+DEFINE_STAT(STAT_EnvironmentSensor_SyncFallbacks);
+DEFINE_STAT(STAT_EnemyCrowd_Simulate);
+DEFINE_STAT(STAT_EnemyCrowd_Render);
+DEFINE_STAT(STAT_EnemyCrowd_Enemies);
+DEFINE_STAT(STAT_EnemyCrowd_Promoted);
+
+namespace PDebug
+{
+	enum EDebugFlags : int32
+	{
+		Log = 1 << 0,
+		Draw = 1 << 1
+	};
+
+	static TAutoConsoleVariable<int32> CVarDebugMovement(
+		TEXT("p2d.Debug.Movement"), 0,
+		TEXT("Debug output for character movement (fall speed clamp, coyote time, landing). 1 = log, 2 = draw, 3 = both."),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarDebugWallDetection(
+		TEXT("p2d.Debug.WallDetection"), 0,
+		TEXT("Debug output for wall detection and wall jumps. 1 = log, 2 = draw, 3 = both."),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarDebugDash(
+		TEXT("p2d.Debug.Dash"), 0,
+		TEXT("Debug output for dashes. 1 = log, 2 = draw, 3 = both."),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarDebugGrapple(
+		TEXT("p2d.Debug.Grapple"), 0,
+		TEXT("Debug output for grapple detection. 1 = log, 2 = draw, 3 = both."),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarDebugCamera(
+		TEXT("p2d.Debug.Camera"), 0,
+		TEXT("Debug output for the camera rig. 1 = log (snaps, level bounds), 2 = draw (dead zone and goal), 3 = both."),
+		ECVF_Cheat);
+
+	static int32 GetFlags(EPDebugCategory Category)
+	{
+		switch (Category)
+		{
+		case EPDebugCategory::Movement:			return CVarDebugMovement.GetValueOnGameThread();
+		case EPDebugCategory::WallDetection:	return CVarDebugWallDetection.GetValueOnGameThread();
+		case EPDebugCategory::Dash:				return CVarDebugDash.GetValueOnGameThread();
+		case EPDebugCategory::Grapple:			return CVarDebugGrapple.GetValueOnGameThread();
+		case EPDebugCategory::Camera:			return CVarDebugCamera.GetValueOnGameThread();
+		default:								return 0;
+		}
+	}
+
+	bool ShouldLog(EPDebugCategory Category)
+	{
+		return (GetFlags(Category) & Log) != 0;
+	}
+
+	bool ShouldDraw(EPDebugCategory Category)
+	{
+		return (GetFlags(Category) & Draw) != 0;
+	}
+}
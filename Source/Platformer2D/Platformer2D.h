@@ -3,4 +3,59 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogPlatformer2D, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("Platformer2D"), STATGROUP_Platformer2D, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PCharacter Tick"), STAT_PCharacter_Tick, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PCharacter DetectWall"), STAT_PCharacter_DetectWall, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PaperCharacterBase Tick"), STAT_PaperCharacterBase_Tick, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PaperCharacterBase DetectWall"), STAT_PaperCharacterBase_DetectWall, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PCharacterMovement PhysDash"), STAT_PCharacterMovement_PhysDash, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PCharacterMovement Kinematic2D"), STAT_PCharacterMovement_Kinematic2D, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("PCharacterMovement Fixed Steps"), STAT_PCharacterMovement_FixedSteps, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("PaperCharacterBase Sprite Updates"), STAT_PaperCharacterBase_SpriteUpdates, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("TileMapStreamer Active Chunks"), STAT_TileMapStreamer_ActiveChunks, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("TileMapStreamer Chunk Memory"), STAT_TileMapStreamer_ChunkMemory, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("ActorPool Hits"), STAT_ActorPool_Hits, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("ActorPool Misses"), STAT_ActorPool_Misses, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("ActorPool Active Actors"), STAT_ActorPool_Active, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("EnvironmentSensor Async Traces"), STAT_EnvironmentSensor_AsyncTraces, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("EnvironmentSensor Sync Fallbacks"), STAT_EnvironmentSensor_SyncFallbacks, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("EnemyCrowd Simulate"), STAT_EnemyCrowd_Simulate, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("EnemyCrowd Render"), STAT_EnemyCrowd_Render, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("EnemyCrowd Enemies"), STAT_EnemyCrowd_Enemies, STATGROUP_Platformer2D, PLATFORMER2D_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("EnemyCrowd Promoted"), STAT_EnemyCrowd_Promoted, STATGROUP_Platformer2D, PLATFORMER2D_API);
+
+/** Debug draw and log output is compiled out of shipping and test builds. */
+#define P2D_DEBUG_ENABLED !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+/** Each category is gated at runtime by its own p2d.Debug.<Category> console variable (1 = log, 2 = draw, 3 = both). */
+enum class EPDebugCategory : uint8
+{
+	Movement,
+	WallDetection,
+	Dash,
+	Grapple,
+	Camera,
+	Num
+};
+
+namespace PDebug
+{
+	PLATFORMER2D_API bool ShouldLog(EPDebugCategory Category);
+	PLATFORMER2D_API bool ShouldDraw(EPDebugCategory Category);
+}
+
+#if P2D_DEBUG_ENABLED
+#define P2D_LOG(Category, Verbosity, Format, ...) \
+	do { if (PDebug::ShouldLog(EPDebugCategory::Category)) { UE_LOG(LogPlatformer2D, Verbosity, Format, ##__VA_ARGS__); } } while (0)
+#define P2D_DRAW(Category, DrawCall) \
+	do { if (PDebug::ShouldDraw(EPDebugCategory::Category)) { DrawCall; } } while (0)
+#else
+#define P2D_LOG(Category, Verbosity, Format, ...) do { } while (0)
+#define P2D_DRAW(Category, DrawCall) do { } while (0)
+#endif
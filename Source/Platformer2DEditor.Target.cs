@@ -9,6 +9,6 @@ public class Platformer2DEditorTarget : TargetRules
 	{
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
-		ExtraModuleNames.AddRange( new string[] { "Platformer2D" } );
+		ExtraModuleNames.AddRange( new string[] { "Platformer2D", "Platformer2DEditor" } );
 	}
 }
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PBakeSpriteAtlasCommandlet.h"
+#include "Platformer2DEditor.h"
+#include "PSpriteAtlasBaker.h"
+
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+UPBakeSpriteAtlasCommandlet::UPBakeSpriteAtlasCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPBakeSpriteAtlasCommandlet::Main(const FString& Params)
+{
+	FString FlipbookList = TEXT("/Game/Flipbooks");
+	FParse::Value(*Params, TEXT("Flipbooks="), FlipbookList, false);
+
+	FString AtlasPath = TEXT("/Game/Sprites/Atlases");
+	FParse::Value(*Params, TEXT("AtlasPath="), AtlasPath);
+
+	int32 Padding = 2;
+	FParse::Value(*Params, TEXT("Padding="), Padding);
+	Padding = FMath::Clamp(Padding, 0, 64);
+
+	int32 MaxSize = 4096;
+	FParse::Value(*Params, TEXT("MaxSize="), MaxSize);
+	MaxSize = FMath::Clamp(MaxSize, 16, 16384);
+
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+	const bool bVerifyOnly = FParse::Param(*Params, TEXT("Verify"));
+
+	// Entries are either content folders or flipbook object paths
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	TArray<FString> Entries;
+	FlipbookList.ParseIntoArray(Entries, TEXT(","));
+	TArray<UPaperFlipbook*> Flipbooks;
+	for (FString& Entry : Entries)
+	{
+		Entry.TrimStartAndEndInline();
+		if (UPaperFlipbook* Flipbook = LoadObject<UPaperFlipbook>(nullptr, *Entry, nullptr, LOAD_NoWarn | LOAD_Quiet))
+		{
+			Flipbooks.AddUnique(Flipbook);
+			continue;
+		}
+
+		FARFilter Filter;
+		Filter.PackagePaths.Add(FName(*Entry));
+		Filter.bRecursivePaths = true;
+		Filter.ClassNames.Add(UPaperFlipbook::StaticClass()->GetFName());
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssets(Filter, Assets);
+		if (Assets.Num() == 0)
+		{
+			UE_LOG(LogPlatformer2DEditor, Warning, TEXT("No flipbooks found at %s"), *Entry);
+		}
+		for (const FAssetData& Asset : Assets)
+		{
+			if (UPaperFlipbook* Flipbook = Cast<UPaperFlipbook>(Asset.GetAsset()))
+			{
+				Flipbooks.AddUnique(Flipbook);
+			}
+		}
+	}
+	if (Flipbooks.Num() == 0)
+	{
+		UE_LOG(LogPlatformer2DEditor, Error, TEXT("Usage: -run=PBakeSpriteAtlas [-Flipbooks=<path or flipbook>[,...]] [-AtlasPath=<path>] [-Padding=2] [-MaxSize=4096] [-NoSave] [-Verify]"));
+		return 1;
+	}
+
+	int32 NumFailed = 0;
+	if (!bVerifyOnly)
+	{
+		FPSpriteAtlasBakeReport Report;
+		TSet<UPaperSprite*> BakedSprites;
+		TArray<UPackage*> DirtyPackages;
+		for (UPaperFlipbook* Flipbook : Flipbooks)
+		{
+			FPSpriteAtlasBakeReport FlipbookReport;
+			if (!PSpriteAtlasBaker::BakeFlipbook(Flipbook, AtlasPath, Padding, MaxSize, BakedSprites, DirtyPackages, FlipbookReport))
+			{
+				++NumFailed;
+				continue;
+			}
+			UE_LOG(LogPlatformer2DEditor, Display, TEXT("%s: %s"), *Flipbook->GetName(), *FlipbookReport.ToString());
+
+			Report.NumFlipbooks += FlipbookReport.NumFlipbooks;
+			Report.NumSprites += FlipbookReport.NumSprites;
+			Report.NumSkippedSprites += FlipbookReport.NumSkippedSprites;
+			Report.NumTexturesBefore += FlipbookReport.NumTexturesBefore;
+			Report.NumTexturesAfter += FlipbookReport.NumTexturesAfter;
+			Report.BytesBefore += FlipbookReport.BytesBefore;
+			Report.BytesAfter += FlipbookReport.BytesAfter;
+			Report.TexelsBefore += FlipbookReport.TexelsBefore;
+			Report.TexelsAfter += FlipbookReport.TexelsAfter;
+		}
+		UE_LOG(LogPlatformer2DEditor, Display, TEXT("Total: %s"), *Report.ToString());
+
+		if (bSave)
+		{
+			for (UPackage* Package : DirtyPackages)
+			{
+				const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+				FSavePackageArgs SaveArgs;
+				SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+				if (!UPackage::SavePackage(Package, nullptr, *Filename, SaveArgs))
+				{
+					UE_LOG(LogPlatformer2DEditor, Error, TEXT("Could not save %s"), *Filename);
+					++NumFailed;
+				}
+			}
+		}
+	}
+
+	// Checked on the assets as they are now, after a bake that is what was just written
+	for (const UPaperFlipbook* Flipbook : Flipbooks)
+	{
+		FString Error;
+		if (!PSpriteAtlasBaker::VerifyFlipbook(Flipbook, Error))
+		{
+			UE_LOG(LogPlatformer2DEditor, Error, TEXT("%s failed verification: %s"), *Flipbook->GetName(), *Error);
+			++NumFailed;
+		}
+	}
+	return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PBakeSpriteAtlasCommandlet.generated.h"
+
+/**
+ * Packs the frames of flipbooks into one atlas texture per flipbook, see PSpriteAtlasBaker.
+ *
+ * Reports the texture count and texture source bytes before and after. The textures the sprites used before are
+ * left in place, delete them once nothing else references them. -Verify only checks already baked flipbooks.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=PBakeSpriteAtlas -unattended -nullrhi
+ *     [-Flipbooks=<path or flipbook>[,...], defaults to /Game/Flipbooks] [-AtlasPath=/Game/Sprites/Atlases]
+ *     [-Padding=2] [-MaxSize=4096] [-NoSave] [-Verify]
+ */
+UCLASS()
+class PLATFORMER2DEDITOR_API UPBakeSpriteAtlasCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPBakeSpriteAtlasCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
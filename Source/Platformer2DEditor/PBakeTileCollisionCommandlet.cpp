@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PBakeTileCollisionCommandlet.h"
+#include "Platformer2DEditor.h"
+#include "PTileCollisionBaker.h"
+
+UPBakeTileCollisionCommandlet::UPBakeTileCollisionCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPBakeTileCollisionCommandlet::Main(const FString& Params)
+{
+	FString MapList;
+	if (!FParse::Value(*Params, TEXT("Map="), MapList, false))
+	{
+		UE_LOG(LogPlatformer2DEditor, Error, TEXT("Usage: -run=PBakeTileCollision -Map=<map>[,<map>...] [-ChunkSize=32] [-Samples=100000] [-Seed=1337] [-NoSave]"));
+		return 1;
+	}
+
+	int32 ChunkSize = 32;
+	FParse::Value(*Params, TEXT("ChunkSize="), ChunkSize);
+	ChunkSize = FMath::Clamp(ChunkSize, 1, 1024);
+
+	int32 NumSamples = 100000;
+	FParse::Value(*Params, TEXT("Samples="), NumSamples);
+
+	int32 Seed = 1337;
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+
+	TArray<FString> MapNames;
+	MapList.ParseIntoArray(MapNames, TEXT(","));
+
+	int32 NumFailed = 0;
+	FPTileCollisionBakeReport Total;
+	for (const FString& MapName : MapNames)
+	{
+		FPTileCollisionBakeReport Report;
+		if (!PTileCollisionBaker::BakeMap(MapName.TrimStartAndEnd(), ChunkSize, NumSamples, Seed, bSave, Report))
+		{
+			++NumFailed;
+			continue;
+		}
+		UE_LOG(LogPlatformer2DEditor, Display, TEXT("%s: %s"), *MapName, *Report.ToString());
+
+		Total.NumTileMaps += Report.NumTileMaps;
+		Total.NumSkippedTileMaps += Report.NumSkippedTileMaps;
+		Total.NumSolidTiles += Report.NumSolidTiles;
+		Total.NumShapesBefore += Report.NumShapesBefore;
+		Total.NumShapesAfter += Report.NumShapesAfter;
+		Total.NumChunks += Report.NumChunks;
+	}
+
+	if (MapNames.Num() > 1)
+	{
+		UE_LOG(LogPlatformer2DEditor, Display, TEXT("Total: %s"), *Total.ToString());
+	}
+	return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PBakeTileCollisionCommandlet.generated.h"
+
+/**
+ * Bakes the tile map collision of maps into greedy-meshed chunk bodies, see PTileCollisionBaker.
+ *
+ * Reports the shape reduction and the mean cost of DetectWall's sweeps on the same map before and after the bake.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=PBakeTileCollision -unattended
+ *     -Map=<map>[,<map>...] [-ChunkSize=32] [-Samples=100000] [-Seed=1337] [-NoSave]
+ */
+UCLASS()
+class PLATFORMER2DEDITOR_API UPBakeTileCollisionCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPBakeTileCollisionCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PCreateAnimationSetsCommandlet.h"
+#include "Platformer2DEditor.h"
+#include "PAnimationSet.h"
+#include "PaperCharacterBase.h"
+
+#include "PaperFlipbook.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/Blueprint.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+namespace PCreateAnimationSets
+{
+	const TCHAR* const StateNames[] = { TEXT("Idle"), TEXT("Run"), TEXT("Jump"), TEXT("Fall"), TEXT("Dash") };
+	static_assert(UE_ARRAY_COUNT(StateNames) == static_cast<int32>(EPAnimationState::Num), "One name per animation state");
+
+	bool SavePackage(UPackage* Package, const FString& Extension)
+	{
+		const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), Extension);
+		FSavePackageArgs SaveArgs;
+		SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		if (!UPackage::SavePackage(Package, nullptr, *Filename, SaveArgs))
+		{
+			UE_LOG(LogPlatformer2DEditor, Error, TEXT("Could not save %s"), *Filename);
+			return false;
+		}
+		return true;
+	}
+}
+
+UPCreateAnimationSetsCommandlet::UPCreateAnimationSetsCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPCreateAnimationSetsCommandlet::Main(const FString& Params)
+{
+	FString Name;
+	FString Prefix;
+	FString BlueprintPath;
+	FParse::Value(*Params, TEXT("Name="), Name);
+	FParse::Value(*Params, TEXT("Prefix="), Prefix);
+	FParse::Value(*Params, TEXT("Blueprint="), BlueprintPath);
+	if (Name.IsEmpty() || (Prefix.IsEmpty() && BlueprintPath.IsEmpty()))
+	{
+		UE_LOG(LogPlatformer2DEditor, Error, TEXT("Usage: -run=PCreateAnimationSets -Name=<set name> [-Prefix=<flipbook path prefix>] [-Blueprint=<character blueprint>] [-Path=/Game/AnimationSets] [-NoSave]"));
+		return 1;
+	}
+
+	FString Path = TEXT("/Game/AnimationSets");
+	FParse::Value(*Params, TEXT("Path="), Path);
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+
+	APaperCharacterBase* Character = nullptr;
+	UBlueprint* Blueprint = nullptr;
+	if (!BlueprintPath.IsEmpty())
+	{
+		Blueprint = LoadObject<UBlueprint>(nullptr, *BlueprintPath);
+		Character = Blueprint && Blueprint->GeneratedClass ? Cast<APaperCharacterBase>(Blueprint->GeneratedClass->GetDefaultObject()) : nullptr;
+		if (!Character)
+		{
+			UE_LOG(LogPlatformer2DEditor, Error, TEXT("%s is not a APaperCharacterBase blueprint"), *BlueprintPath);
+			return 1;
+		}
+	}
+
+	const FString AssetName = TEXT("AS_") + Name;
+	const FString PackageName = Path / AssetName;
+	UPackage* SetPackage = CreatePackage(*PackageName);
+	UPAnimationSet* AnimationSet = FindObject<UPAnimationSet>(SetPackage, *AssetName);
+	if (!AnimationSet)
+	{
+		AnimationSet = LoadObject<UPAnimationSet>(SetPackage, *AssetName, nullptr, LOAD_NoWarn | LOAD_Quiet);
+	}
+	if (!AnimationSet)
+	{
+		AnimationSet = NewObject<UPAnimationSet>(SetPackage, *AssetName, RF_Public | RF_Standalone);
+		FAssetRegistryModule::AssetCreated(AnimationSet);
+	}
+
+	for (int32 State = 0; State < static_cast<int32>(EPAnimationState::Num); ++State)
+	{
+		const EPAnimationState AnimationState = static_cast<EPAnimationState>(State);
+		UPaperFlipbook* Flipbook = nullptr;
+		if (!Prefix.IsEmpty())
+		{
+			const FString FlipbookPath = Prefix + PCreateAnimationSets::StateNames[State];
+			Flipbook = LoadObject<UPaperFlipbook>(nullptr, *FlipbookPath, nullptr, LOAD_NoWarn | LOAD_Quiet);
+		}
+		if (!Flipbook && Character)
+		{
+			Flipbook = Character->GetOwnFlipbook(AnimationState);
+		}
+
+		AnimationSet->GetFlipbookReference(AnimationState) = Flipbook;
+		UE_LOG(LogPlatformer2DEditor, Display, TEXT("%s %s: %s"), *AssetName, PCreateAnimationSets::StateNames[State], Flipbook ? *Flipbook->GetPathName() : TEXT("none"));
+	}
+	SetPackage->MarkPackageDirty();
+
+	if (Character)
+	{
+		// The set replaces the blueprint's own flipbooks, which would otherwise still be loaded with the class
+		Character->SetAnimationSet(AnimationSet);
+		for (int32 State = 0; State < static_cast<int32>(EPAnimationState::Num); ++State)
+		{
+			Character->SetOwnFlipbook(static_cast<EPAnimationState>(State), nullptr);
+		}
+		Blueprint->MarkPackageDirty();
+		UE_LOG(LogPlatformer2DEditor, Display, TEXT("Assigned %s to %s"), *AssetName, *Blueprint->GetName());
+	}
+
+	if (!bSave)
+	{
+		return 0;
+	}
+	bool bSaved = PCreateAnimationSets::SavePackage(SetPackage, FPackageName::GetAssetPackageExtension());
+	if (Blueprint)
+	{
+		bSaved &= PCreateAnimationSets::SavePackage(Blueprint->GetOutermost(), FPackageName::GetAssetPackageExtension());
+	}
+	return bSaved ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PCreateAnimationSetsCommandlet.generated.h"
+
+/**
+ * Creates or updates the animation set /Game/AnimationSets/AS_<Name> and optionally assigns it to a character blueprint.
+ *
+ * The flipbooks come from -Prefix, <Prefix>Idle, <Prefix>Run, <Prefix>Jump, <Prefix>Fall and <Prefix>Dash where they
+ * exist, otherwise from the blueprint's own flipbooks. Flipbooks moved into the set are cleared on the blueprint,
+ * so they are no longer loaded with its class.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=PCreateAnimationSets -unattended
+ *     -Name=<set name> [-Prefix=<flipbook path prefix>] [-Blueprint=<character blueprint>] [-Path=/Game/AnimationSets] [-NoSave]
+ *
+ * The project's sets:
+ *     -Name=Wizard -Blueprint=/Game/Blueprints/BP_PaperCharacter
+ *     -Name=Frog -Prefix=/Game/Flipbooks/FB_Player_
+ */
+UCLASS()
+class PLATFORMER2DEDITOR_API UPCreateAnimationSetsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPCreateAnimationSetsCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
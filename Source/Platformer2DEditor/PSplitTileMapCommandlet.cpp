@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PSplitTileMapCommandlet.h"
+#include "Platformer2DEditor.h"
+#include "PTileMapSplitter.h"
+
+UPSplitTileMapCommandlet::UPSplitTileMapCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPSplitTileMapCommandlet::Main(const FString& Params)
+{
+	FString MapList;
+	if (!FParse::Value(*Params, TEXT("Map="), MapList, false))
+	{
+		UE_LOG(LogPlatformer2DEditor, Error, TEXT("Usage: -run=PSplitTileMap -Map=<map>[,<map>...] [-ChunkSize=32] [-OutputPath=/Game/Tilemaps/Chunks] [-NoSave]"));
+		return 1;
+	}
+
+	int32 ChunkSize = 32;
+	FParse::Value(*Params, TEXT("ChunkSize="), ChunkSize);
+	ChunkSize = FMath::Clamp(ChunkSize, 1, 1024);
+
+	FString OutputPath = TEXT("/Game/Tilemaps/Chunks");
+	FParse::Value(*Params, TEXT("OutputPath="), OutputPath);
+
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+
+	TArray<FString> MapNames;
+	MapList.ParseIntoArray(MapNames, TEXT(","));
+
+	int32 NumFailed = 0;
+	FPTileMapSplitReport Total;
+	for (const FString& MapName : MapNames)
+	{
+		FPTileMapSplitReport Report;
+		if (!PTileMapSplitter::SplitMap(MapName.TrimStartAndEnd(), ChunkSize, OutputPath, bSave, Report))
+		{
+			++NumFailed;
+			continue;
+		}
+		UE_LOG(LogPlatformer2DEditor, Display, TEXT("%s: %s"), *MapName, *Report.ToString());
+
+		Total.NumTileMaps += Report.NumTileMaps;
+		Total.NumSkippedTileMaps += Report.NumSkippedTileMaps;
+		Total.NumChunks += Report.NumChunks;
+		Total.NumEmptyChunks += Report.NumEmptyChunks;
+		Total.TotalBytes += Report.TotalBytes;
+		Total.MaxChunkBytes = FMath::Max(Total.MaxChunkBytes, Report.MaxChunkBytes);
+	}
+
+	if (MapNames.Num() > 1)
+	{
+		UE_LOG(LogPlatformer2DEditor, Display, TEXT("Total: %s"), *Total.ToString());
+	}
+	return NumFailed > 0 ? 1 : 0;
+}
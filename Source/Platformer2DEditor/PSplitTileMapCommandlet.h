@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PSplitTileMapCommandlet.generated.h"
+
+/**
+ * Splits the tile maps of maps into chunks streamed around the camera by APTileMapStreamer, see PTileMapSplitter.
+ *
+ * Reports the chunk count and the estimated memory per chunk, MemoryBudgetKB of the streamers should cover
+ * the chunks that fit in twice the deactivation distance.
+ *
+ * UnrealEditor-Cmd Platformer2D.uproject -run=PSplitTileMap -unattended
+ *     -Map=<map>[,<map>...] [-ChunkSize=32] [-OutputPath=/Game/Tilemaps/Chunks] [-NoSave]
+ */
+UCLASS()
+class PLATFORMER2DEDITOR_API UPSplitTileMapCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPSplitTileMapCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
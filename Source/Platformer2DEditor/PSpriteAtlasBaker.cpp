@@ -0,0 +1,367 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PSpriteAtlasBaker.h"
+#include "Platformer2DEditor.h"
+
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+#include "SpriteEditorOnlyTypes.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/Texture2D.h"
+#include "UObject/Package.h"
+
+namespace PSpriteAtlasBaker
+{
+	/** A sprite being moved into the atlas, with its trimmed texels. */
+	struct FFrame
+	{
+		UPaperSprite* Sprite = nullptr;
+		UTexture2D* Texture = nullptr;
+		/** Top left of the trimmed texels in the old texture. */
+		FIntPoint SourceMin = FIntPoint::ZeroValue;
+		FIntPoint Size = FIntPoint::ZeroValue;
+		TArray<FColor> Texels;
+		FIntPoint AtlasPosition = FIntPoint::ZeroValue;
+	};
+
+	/** Shelf-packs with a fixed width. @return the height used */
+	int32 PackShelves(const TArray<FIntPoint>& Sizes, const TArray<int32>& Order, int32 Padding, int32 Width, TArray<FIntPoint>& OutPositions)
+	{
+		int32 CursorX = 0;
+		int32 ShelfY = 0;
+		int32 ShelfHeight = 0;
+		for (const int32 Index : Order)
+		{
+			const FIntPoint Cell = Sizes[Index] + FIntPoint(Padding * 2);
+			if (CursorX + Cell.X > Width)
+			{
+				ShelfY += ShelfHeight;
+				CursorX = 0;
+				ShelfHeight = 0;
+			}
+			OutPositions[Index] = FIntPoint(CursorX + Padding, ShelfY + Padding);
+			CursorX += Cell.X;
+			ShelfHeight = FMath::Max(ShelfHeight, Cell.Y);
+		}
+		return ShelfY + ShelfHeight;
+	}
+
+	/** Reads the trimmed texels of a sprite from its texture's source. @return false if the source is not BGRA8 */
+	bool ReadFrame(UPaperSprite* Sprite, TMap<UTexture2D*, TArray64<uint8>>& MipCache, FFrame& OutFrame)
+	{
+		UTexture2D* Texture = Sprite->GetSourceTexture();
+		if (!Texture || Texture->Source.GetFormat() != TSF_BGRA8)
+		{
+			return false;
+		}
+
+		TArray64<uint8>* Mip = MipCache.Find(Texture);
+		if (!Mip)
+		{
+			Mip = &MipCache.Add(Texture);
+			if (!Texture->Source.GetMipData(*Mip, 0))
+			{
+				return false;
+			}
+		}
+		const int32 TextureWidth = Texture->Source.GetSizeX();
+		const FColor* TextureTexels = reinterpret_cast<const FColor*>(Mip->GetData());
+
+		const FIntPoint RegionMin(FMath::RoundToInt(Sprite->GetSourceUV().X), FMath::RoundToInt(Sprite->GetSourceUV().Y));
+		const FIntPoint RegionSize(FMath::RoundToInt(Sprite->GetSourceSize().X), FMath::RoundToInt(Sprite->GetSourceSize().Y));
+		if (RegionMin.X < 0 || RegionMin.Y < 0 || RegionMin.X + RegionSize.X > TextureWidth || RegionMin.Y + RegionSize.Y > Texture->Source.GetSizeY())
+		{
+			return false;
+		}
+
+		// Trim to the non-transparent texels, a fully transparent frame keeps a single texel
+		FIntRect Bounds(FIntPoint(MAX_int32), FIntPoint(MIN_int32));
+		for (int32 Y = 0; Y < RegionSize.Y; ++Y)
+		{
+			for (int32 X = 0; X < RegionSize.X; ++X)
+			{
+				if (TextureTexels[(RegionMin.Y + Y) * TextureWidth + RegionMin.X + X].A > 0)
+				{
+					Bounds.Include(FIntPoint(X, Y));
+				}
+			}
+		}
+		if (Bounds.Min.X > Bounds.Max.X)
+		{
+			Bounds = FIntRect(0, 0, 0, 0);
+		}
+
+		OutFrame.Sprite = Sprite;
+		OutFrame.Texture = Texture;
+		OutFrame.SourceMin = RegionMin + Bounds.Min;
+		OutFrame.Size = Bounds.Max - Bounds.Min + FIntPoint(1);
+		OutFrame.Texels.SetNumUninitialized(OutFrame.Size.X * OutFrame.Size.Y);
+		for (int32 Y = 0; Y < OutFrame.Size.Y; ++Y)
+		{
+			FMemory::Memcpy(&OutFrame.Texels[Y * OutFrame.Size.X], &TextureTexels[(OutFrame.SourceMin.Y + Y) * TextureWidth + OutFrame.SourceMin.X], OutFrame.Size.X * sizeof(FColor));
+		}
+		return true;
+	}
+
+	/** Hand-placed geometry is in texture space and has to move with the sprite, generated geometry is rebuilt from the new texels. */
+	void MoveCustomGeometry(UPaperSprite* Sprite, FName PropertyName, const FVector2D& Offset)
+	{
+		const FStructProperty* Property = FindFProperty<FStructProperty>(UPaperSprite::StaticClass(), PropertyName);
+		if (!Property || Property->Struct != FSpriteGeometryCollection::StaticStruct())
+		{
+			return;
+		}
+		FSpriteGeometryCollection* Geometry = Property->ContainerPtrToValuePtr<FSpriteGeometryCollection>(Sprite);
+		if (Geometry->GeometryType == ESpritePolygonMode::FullyCustom)
+		{
+			for (FSpriteGeometryShape& Shape : Geometry->Shapes)
+			{
+				Shape.BoxPosition += Offset;
+			}
+		}
+	}
+
+	FIntRect GetSourceRect(const UPaperSprite* Sprite)
+	{
+		const FIntPoint Min(FMath::RoundToInt(Sprite->GetSourceUV().X), FMath::RoundToInt(Sprite->GetSourceUV().Y));
+		const FIntPoint Size(FMath::RoundToInt(Sprite->GetSourceSize().X), FMath::RoundToInt(Sprite->GetSourceSize().Y));
+		return FIntRect(Min, Min + Size);
+	}
+}
+
+FString FPSpriteAtlasBakeReport::ToString() const
+{
+	return FString::Printf(TEXT("%d flipbooks, %d sprites (%d skipped), textures %d -> %d, source %.1f KiB -> %.1f KiB, texels %lld -> %lld"),
+		NumFlipbooks, NumSprites, NumSkippedSprites, NumTexturesBefore, NumTexturesAfter,
+		BytesBefore / 1024.0, BytesAfter / 1024.0, TexelsBefore, TexelsAfter);
+}
+
+bool PSpriteAtlasBaker::Pack(const TArray<FIntPoint>& Sizes, int32 Padding, int32 MaxSize, FIntPoint& OutAtlasSize, TArray<FIntPoint>& OutPositions)
+{
+	TArray<int32> Order;
+	int32 MinWidth = 1;
+	for (int32 Index = 0; Index < Sizes.Num(); ++Index)
+	{
+		Order.Add(Index);
+		MinWidth = FMath::Max(MinWidth, Sizes[Index].X + Padding * 2);
+	}
+	Order.StableSort([&Sizes](int32 A, int32 B) { return Sizes[A].Y > Sizes[B].Y; });
+
+	// Try every power of two width and keep the smallest atlas, the squarer one on a tie
+	bool bFound = false;
+	TArray<FIntPoint> Positions;
+	Positions.SetNum(Sizes.Num());
+	for (int32 Width = FMath::RoundUpToPowerOfTwo(MinWidth); Width <= MaxSize; Width *= 2)
+	{
+		const int32 Height = FMath::RoundUpToPowerOfTwo(FMath::Max(PackShelves(Sizes, Order, Padding, Width, Positions), 1));
+		if (Height > MaxSize)
+		{
+			continue;
+		}
+		const int64 Area = static_cast<int64>(Width) * Height;
+		const int64 BestArea = static_cast<int64>(OutAtlasSize.X) * OutAtlasSize.Y;
+		if (!bFound || Area < BestArea || (Area == BestArea && FMath::Abs(Width - Height) < FMath::Abs(OutAtlasSize.X - OutAtlasSize.Y)))
+		{
+			bFound = true;
+			OutAtlasSize = FIntPoint(Width, Height);
+			OutPositions = Positions;
+		}
+	}
+	return bFound;
+}
+
+bool PSpriteAtlasBaker::BakeFlipbook(UPaperFlipbook* Flipbook, const FString& AtlasPackagePath, int32 Padding, int32 MaxSize,
+	TSet<UPaperSprite*>& BakedSprites, TArray<UPackage*>& OutDirtyPackages, FPSpriteAtlasBakeReport& OutReport)
+{
+	TMap<UTexture2D*, TArray64<uint8>> MipCache;
+	TArray<FFrame> Frames;
+	TSet<UPaperSprite*> FlipbookSprites;
+	for (int32 KeyFrameIndex = 0; KeyFrameIndex < Flipbook->GetNumKeyFrames(); ++KeyFrameIndex)
+	{
+		UPaperSprite* Sprite = Flipbook->GetKeyFrameChecked(KeyFrameIndex).Sprite;
+		bool bAlreadyInFlipbook = false;
+		FlipbookSprites.Add(Sprite, &bAlreadyInFlipbook);
+		if (!Sprite || bAlreadyInFlipbook)
+		{
+			continue;
+		}
+		if (BakedSprites.Contains(Sprite))
+		{
+			UE_LOG(LogPlatformer2DEditor, Warning, TEXT("%s: %s is already in another flipbook's atlas"), *Flipbook->GetName(), *Sprite->GetName());
+			++OutReport.NumSkippedSprites;
+			continue;
+		}
+		BakedSprites.Add(Sprite);
+
+		FFrame Frame;
+		if (!ReadFrame(Sprite, MipCache, Frame))
+		{
+			UE_LOG(LogPlatformer2DEditor, Warning, TEXT("%s: %s has no BGRA8 texture source, left as it is"), *Flipbook->GetName(), *Sprite->GetName());
+			++OutReport.NumSkippedSprites;
+			continue;
+		}
+		Frames.Add(MoveTemp(Frame));
+	}
+	if (Frames.Num() == 0)
+	{
+		return true;
+	}
+
+	TArray<FIntPoint> Sizes;
+	for (const FFrame& Frame : Frames)
+	{
+		Sizes.Add(Frame.Size);
+	}
+	FIntPoint AtlasSize;
+	TArray<FIntPoint> Positions;
+	if (!Pack(Sizes, Padding, MaxSize, AtlasSize, Positions))
+	{
+		UE_LOG(LogPlatformer2DEditor, Error, TEXT("%s: %d frames don't fit into a %dx%d atlas"), *Flipbook->GetName(), Frames.Num(), MaxSize, MaxSize);
+		return false;
+	}
+
+	TArray<FColor> AtlasTexels;
+	AtlasTexels.SetNumZeroed(AtlasSize.X * AtlasSize.Y);
+	for (int32 Index = 0; Index < Frames.Num(); ++Index)
+	{
+		FFrame& Frame = Frames[Index];
+		Frame.AtlasPosition = Positions[Index];
+		for (int32 Y = 0; Y < Frame.Size.Y; ++Y)
+		{
+			FMemory::Memcpy(&AtlasTexels[(Frame.AtlasPosition.Y + Y) * AtlasSize.X + Frame.AtlasPosition.X], &Frame.Texels[Y * Frame.Size.X], Frame.Size.X * sizeof(FColor));
+		}
+	}
+	// Read every frame back, a packing mistake shows up as one frame overwriting another
+	for (const FFrame& Frame : Frames)
+	{
+		for (int32 Y = 0; Y < Frame.Size.Y; ++Y)
+		{
+			if (FMemory::Memcmp(&AtlasTexels[(Frame.AtlasPosition.Y + Y) * AtlasSize.X + Frame.AtlasPosition.X], &Frame.Texels[Y * Frame.Size.X], Frame.Size.X * sizeof(FColor)) != 0)
+			{
+				UE_LOG(LogPlatformer2DEditor, Error, TEXT("%s: %s was overwritten in the atlas"), *Flipbook->GetName(), *Frame.Sprite->GetName());
+				return false;
+			}
+		}
+	}
+
+	// Texture settings come from the frames' own textures, pixel art keeps its filtering and compression
+	const FString AssetName = FString::Printf(TEXT("T_%s_Atlas"), *Flipbook->GetName());
+	const FString PackageName = AtlasPackagePath / AssetName;
+	UTexture2D* Atlas = LoadObject<UTexture2D>(nullptr, *(PackageName + TEXT(".") + AssetName), nullptr, LOAD_NoWarn | LOAD_Quiet);
+	const UTexture2D* Template = Frames[0].Texture;
+	TSet<UTexture2D*> TexturesBefore;
+	for (const FFrame& Frame : Frames)
+	{
+		TexturesBefore.Add(Frame.Texture);
+	}
+	for (UTexture2D* Texture : TexturesBefore)
+	{
+		OutReport.BytesBefore += Texture->Source.CalcMipSize(0);
+		OutReport.TexelsBefore += static_cast<int64>(Texture->Source.GetSizeX()) * Texture->Source.GetSizeY();
+	}
+	OutReport.NumTexturesBefore += TexturesBefore.Num();
+
+	if (!Atlas)
+	{
+		UPackage* Package = CreatePackage(*PackageName);
+		Atlas = NewObject<UTexture2D>(Package, *AssetName, RF_Public | RF_Standalone);
+		FAssetRegistryModule::AssetCreated(Atlas);
+	}
+	Atlas->Modify();
+	if (Template != Atlas)
+	{
+		Atlas->CompressionSettings = Template->CompressionSettings;
+		Atlas->Filter = Template->Filter;
+		Atlas->LODGroup = Template->LODGroup;
+		Atlas->SRGB = Template->SRGB;
+		Atlas->MipGenSettings = Template->MipGenSettings;
+	}
+	Atlas->Source.Init(AtlasSize.X, AtlasSize.Y, 1, 1, TSF_BGRA8, reinterpret_cast<const uint8*>(AtlasTexels.GetData()));
+	Atlas->PostEditChange();
+	OutDirtyPackages.AddUnique(Atlas->GetOutermost());
+
+	OutReport.NumTexturesAfter += 1;
+	OutReport.BytesAfter += Atlas->Source.CalcMipSize(0);
+	OutReport.TexelsAfter += static_cast<int64>(AtlasSize.X) * AtlasSize.Y;
+
+	for (const FFrame& Frame : Frames)
+	{
+		UPaperSprite* Sprite = Frame.Sprite;
+		// The pivot stays on the same texel, so trimming doesn't move the frame on screen
+		const FVector2D Offset = FVector2D(Frame.AtlasPosition - Frame.SourceMin);
+		const FVector2D Pivot = Sprite->GetPivotPosition() + Offset;
+
+		Sprite->Modify();
+		MoveCustomGeometry(Sprite, TEXT("CollisionGeometry"), Offset);
+		MoveCustomGeometry(Sprite, TEXT("RenderGeometry"), Offset);
+
+		FSpriteAssetInitParameters InitParams;
+		InitParams.Texture = Atlas;
+		InitParams.Offset = Frame.AtlasPosition;
+		InitParams.Dimension = Frame.Size;
+		InitParams.SetPixelsPerUnrealUnit(Sprite->GetPixelsPerUnrealUnit());
+		Sprite->InitializeSprite(InitParams);
+		Sprite->SetPivotMode(ESpritePivotMode::Custom, Pivot);
+		Sprite->PostEditChange();
+		OutDirtyPackages.AddUnique(Sprite->GetOutermost());
+	}
+
+	OutReport.NumFlipbooks += 1;
+	OutReport.NumSprites += Frames.Num();
+	return true;
+}
+
+bool PSpriteAtlasBaker::VerifyFlipbook(const UPaperFlipbook* Flipbook, FString& OutError)
+{
+	const UTexture2D* Atlas = nullptr;
+	TArray<const UPaperSprite*> Sprites;
+	TArray<FIntRect> Rects;
+	for (int32 KeyFrameIndex = 0; KeyFrameIndex < Flipbook->GetNumKeyFrames(); ++KeyFrameIndex)
+	{
+		const UPaperSprite* Sprite = Flipbook->GetKeyFrameChecked(KeyFrameIndex).Sprite;
+		if (!Sprite || Sprites.Contains(Sprite))
+		{
+			continue;
+		}
+
+		const UTexture2D* Texture = Sprite->GetSourceTexture();
+		if (!Texture)
+		{
+			OutError = FString::Printf(TEXT("%s has no texture"), *Sprite->GetName());
+			return false;
+		}
+		if (!Atlas)
+		{
+			Atlas = Texture;
+			if (Atlas->Source.GetFormat() != TSF_BGRA8)
+			{
+				OutError = FString::Printf(TEXT("%s is not BGRA8"), *Atlas->GetName());
+				return false;
+			}
+		}
+		else if (Texture != Atlas)
+		{
+			OutError = FString::Printf(TEXT("%s uses %s instead of %s"), *Sprite->GetName(), *Texture->GetName(), *Atlas->GetName());
+			return false;
+		}
+
+		const FIntRect Rect = GetSourceRect(Sprite);
+		if (Rect.Min.X < 0 || Rect.Min.Y < 0 || Rect.Max.X > Atlas->Source.GetSizeX() || Rect.Max.Y > Atlas->Source.GetSizeY() || Rect.Area() <= 0)
+		{
+			OutError = FString::Printf(TEXT("%s is outside of %s"), *Sprite->GetName(), *Atlas->GetName());
+			return false;
+		}
+		for (int32 Index = 0; Index < Rects.Num(); ++Index)
+		{
+			if (Rect.Intersect(Rects[Index]))
+			{
+				OutError = FString::Printf(TEXT("%s overlaps %s"), *Sprite->GetName(), *Sprites[Index]->GetName());
+				return false;
+			}
+		}
+		Sprites.Add(Sprite);
+		Rects.Add(Rect);
+	}
+	return true;
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPackage;
+class UPaperFlipbook;
+class UPaperSprite;
+
+struct PLATFORMER2DEDITOR_API FPSpriteAtlasBakeReport
+{
+	int32 NumFlipbooks = 0;
+	int32 NumSprites = 0;
+	/** Sprites left alone because their texture source is not BGRA8 or another flipbook already moved them. */
+	int32 NumSkippedSprites = 0;
+
+	int32 NumTexturesBefore = 0;
+	int32 NumTexturesAfter = 0;
+	/** Uncompressed texture source bytes and texels referenced by the baked sprites, before and after. */
+	int64 BytesBefore = 0;
+	int64 BytesAfter = 0;
+	int64 TexelsBefore = 0;
+	int64 TexelsAfter = 0;
+
+	FString ToString() const;
+};
+
+/**
+ * Editor-time packing of a flipbook's sprites into one atlas texture.
+ *
+ * Every frame is trimmed to the bounds of its non-transparent texels and shelf-packed into the smallest power of two
+ * texture that holds them. The sprites are then pointed at their rect in the atlas with a custom pivot where the old
+ * one was, so nothing moves on screen. Everything runs on the texture source data, no GPU or RHI is needed.
+ */
+namespace PSpriteAtlasBaker
+{
+	/**
+	 * Shelf-packs rects, tallest first, with Padding texels around each, into the smallest power of two size up to MaxSize.
+	 * @return false if they don't fit
+	 */
+	PLATFORMER2DEDITOR_API bool Pack(const TArray<FIntPoint>& Sizes, int32 Padding, int32 MaxSize, FIntPoint& OutAtlasSize, TArray<FIntPoint>& OutPositions);
+
+	/**
+	 * Bakes the sprites of a flipbook into the atlas texture AtlasPackagePath/T_<Flipbook>_Atlas.
+	 * Sprites in BakedSprites are skipped and the flipbook's sprites are added to it, so frames shared between flipbooks move once.
+	 * The packages that need saving are added to OutDirtyPackages.
+	 */
+	PLATFORMER2DEDITOR_API bool BakeFlipbook(UPaperFlipbook* Flipbook, const FString& AtlasPackagePath, int32 Padding, int32 MaxSize,
+		TSet<UPaperSprite*>& BakedSprites, TArray<UPackage*>& OutDirtyPackages, FPSpriteAtlasBakeReport& OutReport);
+
+	/**
+	 * Checks a baked flipbook on its assets alone: all frames share one BGRA8 atlas, every rect lies inside it
+	 * and no two frames overlap. @return false with the reason in OutError otherwise
+	 */
+	PLATFORMER2DEDITOR_API bool VerifyFlipbook(const UPaperFlipbook* Flipbook, FString& OutError);
+}
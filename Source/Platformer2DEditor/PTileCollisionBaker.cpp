@@ -0,0 +1,451 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PTileCollisionBaker.h"
+#include "Platformer2DEditor.h"
+#include "PBakedTileCollisionComponent.h"
+#include "PCharacter.h"
+
+#include "EngineUtils.h"
+#include "PaperTileLayer.h"
+#include "PaperTileMap.h"
+#include "PaperTileMapComponent.h"
+#include "PaperTileSet.h"
+#include "Misc/PackageName.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+namespace PTileCollisionBaker
+{
+	constexpr float ShapeTolerance = 0.01f;
+
+	struct FTileGrid
+	{
+		int32 Width = 0;
+		int32 Height = 0;
+		TBitArray<> SolidCells;
+		int32 NumSolidTiles = 0;
+		/** Tiles whose collision does not fill the whole tile, they can not be merged into boxes. */
+		int32 NumPartialTiles = 0;
+	};
+
+	/** True if the shape covers the whole tile, i.e. the tile collides exactly like a box of the tile's size. */
+	bool IsFullTileShape(const FSpriteGeometryShape& Shape, const FIntPoint& TileSize)
+	{
+		if (!FMath::IsNearlyZero(Shape.Rotation))
+		{
+			return false;
+		}
+
+		FBox2D Bounds(ForceInit);
+		if (Shape.ShapeType == ESpriteShapeType::Box)
+		{
+			Bounds += Shape.BoxPosition - Shape.BoxSize * 0.5f;
+			Bounds += Shape.BoxPosition + Shape.BoxSize * 0.5f;
+		}
+		else if (Shape.ShapeType == ESpriteShapeType::Polygon && Shape.Vertices.Num() == 4)
+		{
+			// Polygon vertices are relative to the shape's position
+			for (const FVector2D& Vertex : Shape.Vertices)
+			{
+				Bounds += Shape.BoxPosition + Vertex;
+			}
+			// Four vertices only fill their bounds if every one of them is a corner
+			for (const FVector2D& Vertex : Shape.Vertices)
+			{
+				const FVector2D Position = Shape.BoxPosition + Vertex;
+				const bool bOnCornerX = FMath::IsNearlyEqual(Position.X, Bounds.Min.X, ShapeTolerance) || FMath::IsNearlyEqual(Position.X, Bounds.Max.X, ShapeTolerance);
+				const bool bOnCornerY = FMath::IsNearlyEqual(Position.Y, Bounds.Min.Y, ShapeTolerance) || FMath::IsNearlyEqual(Position.Y, Bounds.Max.Y, ShapeTolerance);
+				if (!bOnCornerX || !bOnCornerY)
+				{
+					return false;
+				}
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		return Bounds.Min.X <= ShapeTolerance && Bounds.Min.Y <= ShapeTolerance
+			&& Bounds.Max.X >= TileSize.X - ShapeTolerance && Bounds.Max.Y >= TileSize.Y - ShapeTolerance;
+	}
+
+	void BuildTileGrid(const UPaperTileMap* TileMap, FTileGrid& OutGrid)
+	{
+		OutGrid.Width = TileMap->MapWidth;
+		OutGrid.Height = TileMap->MapHeight;
+		OutGrid.SolidCells.Init(false, OutGrid.Width * OutGrid.Height);
+
+		for (const UPaperTileLayer* Layer : TileMap->TileLayers)
+		{
+			if (!Layer || !Layer->GetLayerCollides())
+			{
+				continue;
+			}
+
+			const int32 LayerWidth = FMath::Min(Layer->GetLayerWidth(), OutGrid.Width);
+			const int32 LayerHeight = FMath::Min(Layer->GetLayerHeight(), OutGrid.Height);
+			for (int32 Y = 0; Y < LayerHeight; ++Y)
+			{
+				for (int32 X = 0; X < LayerWidth; ++X)
+				{
+					const FPaperTileInfo Cell = Layer->GetCell(X, Y);
+					const FPaperTileMetadata* Metadata = Cell.IsValid() ? Cell.TileSet->GetTileMetadata(Cell.GetTileIndex()) : nullptr;
+					if (!Metadata || !Metadata->HasCollision())
+					{
+						continue;
+					}
+
+					const FIntPoint TileSize = Cell.TileSet->GetTileSize();
+					const bool bFullTile = Metadata->CollisionData.Shapes.ContainsByPredicate([&TileSize](const FSpriteGeometryShape& Shape)
+					{
+						return IsFullTileShape(Shape, TileSize);
+					});
+					if (!bFullTile)
+					{
+						++OutGrid.NumPartialTiles;
+						continue;
+					}
+
+					const int32 Index = Y * OutGrid.Width + X;
+					if (!OutGrid.SolidCells[Index])
+					{
+						OutGrid.SolidCells[Index] = true;
+						++OutGrid.NumSolidTiles;
+					}
+				}
+			}
+		}
+	}
+
+	void ClearComponent(UPaperTileMapComponent* TileMapComponent)
+	{
+		TArray<USceneComponent*> Children;
+		TileMapComponent->GetChildrenComponents(false, Children);
+		for (USceneComponent* Child : Children)
+		{
+			if (UPBakedTileCollisionComponent* BakedComponent = Cast<UPBakedTileCollisionComponent>(Child))
+			{
+				TileMapComponent->Modify();
+				TileMapComponent->SetCollisionEnabled(BakedComponent->SourceCollisionEnabled);
+
+				AActor* Owner = BakedComponent->GetOwner();
+				Owner->Modify();
+				Owner->RemoveInstanceComponent(BakedComponent);
+				BakedComponent->DestroyComponent();
+			}
+		}
+	}
+
+	void BakeComponent(UPaperTileMapComponent* TileMapComponent, int32 ChunkSize, FPTileCollisionBakeReport& OutReport)
+	{
+		ClearComponent(TileMapComponent);
+
+		UPaperTileMap* TileMap = TileMapComponent->TileMap;
+		if (!TileMap || !TileMapComponent->IsCollisionEnabled())
+		{
+			return;
+		}
+
+		++OutReport.NumTileMaps;
+		if (TileMap->ProjectionMode != ETileMapProjectionMode::Orthogonal)
+		{
+			UE_LOG(LogPlatformer2DEditor, Warning, TEXT("Skipping %s, only orthogonal tile maps are baked"), *TileMap->GetName());
+			++OutReport.NumSkippedTileMaps;
+			return;
+		}
+
+		FTileGrid Grid;
+		BuildTileGrid(TileMap, Grid);
+		if (Grid.NumPartialTiles > 0)
+		{
+			UE_LOG(LogPlatformer2DEditor, Warning, TEXT("Skipping %s, %d tiles have collision smaller than the tile and can't be merged"),
+				*TileMap->GetName(), Grid.NumPartialTiles);
+			++OutReport.NumSkippedTileMaps;
+			return;
+		}
+		if (Grid.NumSolidTiles == 0)
+		{
+			return;
+		}
+
+		const UBodySetup* TileMapBodySetup = TileMapComponent->GetBodySetup();
+		OutReport.NumSolidTiles += Grid.NumSolidTiles;
+		OutReport.NumShapesBefore += TileMapBodySetup ? TileMapBodySetup->AggGeom.GetElementCount() : Grid.NumSolidTiles;
+
+		// Tile centers are affine in the tile coordinates, the boxes are built in the tile map component's space
+		const FVector TileOrigin = TileMapComponent->GetTileCenterPosition(0, 0, 0, false);
+		const FVector StepX = TileMapComponent->GetTileCenterPosition(1, 0, 0, false) - TileOrigin;
+		const FVector StepY = TileMapComponent->GetTileCenterPosition(0, 1, 0, false) - TileOrigin;
+		const FVector HalfTile(FMath::Abs(StepX.X) * 0.5f, 0.f, FMath::Abs(StepY.Z) * 0.5f);
+		const float TileSize = FMath::Min(HalfTile.X, HalfTile.Z) * 2.f;
+
+		// One slab through every colliding layer, as thick as the tile map's own collision
+		float MinLayerY = TNumericLimits<float>::Max();
+		float MaxLayerY = TNumericLimits<float>::Lowest();
+		for (int32 LayerIndex = 0; LayerIndex < TileMap->TileLayers.Num(); ++LayerIndex)
+		{
+			if (TileMap->TileLayers[LayerIndex] && TileMap->TileLayers[LayerIndex]->GetLayerCollides())
+			{
+				const float LayerY = TileMapComponent->GetTileCenterPosition(0, 0, LayerIndex, false).Y;
+				MinLayerY = FMath::Min(MinLayerY, LayerY);
+				MaxLayerY = FMath::Max(MaxLayerY, LayerY);
+			}
+		}
+		MinLayerY -= TileMap->GetCollisionThickness() * 0.5f;
+		MaxLayerY += TileMap->GetCollisionThickness() * 0.5f;
+
+		AActor* Owner = TileMapComponent->GetOwner();
+		Owner->Modify();
+		TileMapComponent->Modify();
+
+		TArray<FIntRect> Rects;
+		for (int32 ChunkY = 0; ChunkY * ChunkSize < Grid.Height; ++ChunkY)
+		{
+			for (int32 ChunkX = 0; ChunkX * ChunkSize < Grid.Width; ++ChunkX)
+			{
+				const FIntRect Region(ChunkX * ChunkSize, ChunkY * ChunkSize,
+					FMath::Min((ChunkX + 1) * ChunkSize, Grid.Width), FMath::Min((ChunkY + 1) * ChunkSize, Grid.Height));
+				Rects.Reset();
+				GreedyMesh(Grid.SolidCells, Grid.Width, Region, Rects);
+				if (Rects.Num() == 0)
+				{
+					continue;
+				}
+
+				TArray<FBox> Boxes;
+				Boxes.Reserve(Rects.Num());
+				int32 NumChunkTiles = 0;
+				for (const FIntRect& Rect : Rects)
+				{
+					FBox Box(ForceInit);
+					Box += TileOrigin + StepX * Rect.Min.X + StepY * Rect.Min.Y;
+					Box += TileOrigin + StepX * (Rect.Max.X - 1) + StepY * (Rect.Max.Y - 1);
+					Box = Box.ExpandBy(HalfTile);
+					Box.Min.Y = MinLayerY;
+					Box.Max.Y = MaxLayerY;
+					Boxes.Add(Box);
+					NumChunkTiles += Rect.Area();
+				}
+
+				const FName Name = MakeUniqueObjectName(Owner, UPBakedTileCollisionComponent::StaticClass(),
+					*FString::Printf(TEXT("BakedTileCollision_%d_%d"), ChunkX, ChunkY));
+				UPBakedTileCollisionComponent* BakedComponent = NewObject<UPBakedTileCollisionComponent>(Owner, Name, RF_Transactional);
+				BakedComponent->SetupAttachment(TileMapComponent);
+				BakedComponent->SetMobility(TileMapComponent->Mobility);
+				BakedComponent->BodyInstance.CopyBodyInstancePropertiesFrom(&TileMapComponent->BodyInstance);
+				BakedComponent->SetCanEverAffectNavigation(TileMapComponent->CanEverAffectNavigation());
+				BakedComponent->SourceCollisionEnabled = TileMapComponent->GetCollisionEnabled();
+				BakedComponent->NumSourceTiles = NumChunkTiles;
+				BakedComponent->SetBoxes(MoveTemp(Boxes), TileSize);
+				Owner->AddInstanceComponent(BakedComponent);
+				if (Owner->GetWorld() && Owner->GetWorld()->bIsWorldInitialized)
+				{
+					BakedComponent->RegisterComponent();
+				}
+
+				OutReport.NumShapesAfter += Rects.Num();
+				++OutReport.NumChunks;
+			}
+		}
+
+		TileMapComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+	template <typename FunctionType>
+	void ForEachTileMapComponent(UWorld* World, FunctionType Function)
+	{
+		TArray<UPaperTileMapComponent*> TileMapComponents;
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			TInlineComponentArray<UPaperTileMapComponent*> Components(*It);
+			TileMapComponents.Append(Components);
+		}
+		// Collected first, baking adds components to the actors
+		for (UPaperTileMapComponent* Component : TileMapComponents)
+		{
+			Function(Component);
+		}
+	}
+}
+
+FString FPTileCollisionBakeReport::ToString() const
+{
+	FString Result = FString::Printf(TEXT("%d tile maps (%d skipped), %d solid tiles, %d shapes -> %d shapes in %d chunks (%.1f%% fewer)"),
+		NumTileMaps, NumSkippedTileMaps, NumSolidTiles, NumShapesBefore, NumShapesAfter, NumChunks,
+		NumShapesBefore > 0 ? 100.0 * (NumShapesBefore - NumShapesAfter) / NumShapesBefore : 0.0);
+	if (SweepMicrosecondsBefore >= 0.0 && SweepMicrosecondsAfter >= 0.0)
+	{
+		Result += FString::Printf(TEXT(", DetectWall sweeps %.3fus -> %.3fus"), SweepMicrosecondsBefore, SweepMicrosecondsAfter);
+	}
+	return Result;
+}
+
+void PTileCollisionBaker::GreedyMesh(const TBitArray<>& SolidCells, int32 Width, const FIntRect& Region, TArray<FIntRect>& OutRects)
+{
+	const int32 RegionWidth = Region.Width();
+	TBitArray<> Covered(false, RegionWidth * Region.Height());
+	auto IsFree = [&](int32 X, int32 Y)
+	{
+		return SolidCells[Y * Width + X] && !Covered[(Y - Region.Min.Y) * RegionWidth + (X - Region.Min.X)];
+	};
+
+	for (int32 Y = Region.Min.Y; Y < Region.Max.Y; ++Y)
+	{
+		for (int32 X = Region.Min.X; X < Region.Max.X; ++X)
+		{
+			if (!IsFree(X, Y))
+			{
+				continue;
+			}
+
+			int32 MaxX = X + 1;
+			while (MaxX < Region.Max.X && IsFree(MaxX, Y))
+			{
+				++MaxX;
+			}
+
+			int32 MaxY = Y + 1;
+			for (; MaxY < Region.Max.Y; ++MaxY)
+			{
+				bool bRowFree = true;
+				for (int32 RowX = X; RowX < MaxX && bRowFree; ++RowX)
+				{
+					bRowFree = IsFree(RowX, MaxY);
+				}
+				if (!bRowFree)
+				{
+					break;
+				}
+			}
+
+			for (int32 CoveredY = Y; CoveredY < MaxY; ++CoveredY)
+			{
+				for (int32 CoveredX = X; CoveredX < MaxX; ++CoveredX)
+				{
+					Covered[(CoveredY - Region.Min.Y) * RegionWidth + (CoveredX - Region.Min.X)] = true;
+				}
+			}
+			OutRects.Emplace(X, Y, MaxX, MaxY);
+			X = MaxX - 1;
+		}
+	}
+}
+
+void PTileCollisionBaker::BakeWorld(UWorld* World, int32 ChunkSize, FPTileCollisionBakeReport& OutReport)
+{
+	ChunkSize = FMath::Max(ChunkSize, 1);
+	ForEachTileMapComponent(World, [ChunkSize, &OutReport](UPaperTileMapComponent* Component)
+	{
+		BakeComponent(Component, ChunkSize, OutReport);
+	});
+}
+
+int32 PTileCollisionBaker::ClearWorld(UWorld* World)
+{
+	int32 NumRemoved = 0;
+	ForEachTileMapComponent(World, [&NumRemoved](UPaperTileMapComponent* Component)
+	{
+		TArray<USceneComponent*> Children;
+		Component->GetChildrenComponents(false, Children);
+		NumRemoved += Children.FilterByPredicate([](const USceneComponent* Child) { return Child->IsA<UPBakedTileCollisionComponent>(); }).Num();
+		ClearComponent(Component);
+	});
+	return NumRemoved;
+}
+
+double PTileCollisionBaker::MeasureWallSweeps(UWorld* World, int32 NumSamples, int32 Seed)
+{
+	FBox Bounds(ForceInit);
+	ForEachTileMapComponent(World, [&Bounds](UPaperTileMapComponent* Component)
+	{
+		if (Component->TileMap)
+		{
+			Bounds += Component->Bounds.GetBox();
+		}
+	});
+	if (!Bounds.IsValid || NumSamples <= 0)
+	{
+		return -1.0;
+	}
+
+	// Points are generated up front so only the sweeps are timed
+	FRandomStream Random(Seed);
+	TArray<FVector> Points;
+	Points.Reserve(NumSamples);
+	for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+	{
+		Points.Emplace(Random.FRandRange(Bounds.Min.X, Bounds.Max.X), Bounds.GetCenter().Y, Random.FRandRange(Bounds.Min.Z, Bounds.Max.Z));
+	}
+
+	// Same sweeps as APCharacter::DetectWall with the default character's capsule
+	const APCharacter* Character = GetDefault<APCharacter>();
+	const float SweepReach = Character->GetWallSweepReach();
+	const FCollisionShape Shape = FCollisionShape::MakeSphere(Character->GetWallSweepRadius());
+	const FCollisionQueryParams Params(SCENE_QUERY_STAT(PTileCollisionBakerSweep), false);
+	FHitResult Hit;
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (const FVector& Point : Points)
+	{
+		World->SweepSingleByChannel(Hit, Point, Point + FVector(SweepReach, 0.f, 0.f), FQuat::Identity, ECC_WorldStatic, Shape, Params);
+		World->SweepSingleByChannel(Hit, Point, Point - FVector(SweepReach, 0.f, 0.f), FQuat::Identity, ECC_WorldStatic, Shape, Params);
+	}
+	return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0 / NumSamples;
+}
+
+bool PTileCollisionBaker::BakeMap(const FString& MapName, int32 ChunkSize, int32 NumSamples, int32 Seed, bool bSave, FPTileCollisionBakeReport& OutReport)
+{
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!World)
+	{
+		UE_LOG(LogPlatformer2DEditor, Error, TEXT("Could not load map %s"), *MapName);
+		return false;
+	}
+
+	// Sweeps need a physics scene, the world is initialized like an editor world and torn down after saving
+	World->WorldType = EWorldType::Editor;
+	World->AddToRoot();
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Editor);
+	WorldContext.SetCurrentWorld(World);
+	const bool bInitializedHere = !World->bIsWorldInitialized;
+	if (bInitializedHere)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(false)
+			.RequiresHitProxies(false)
+			.CreatePhysicsScene(true)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.ShouldSimulatePhysics(false)
+			.SetTransactional(false));
+	}
+	World->UpdateWorldComponents(true, false);
+
+	OutReport.SweepMicrosecondsBefore = MeasureWallSweeps(World, NumSamples, Seed);
+	BakeWorld(World, ChunkSize, OutReport);
+	OutReport.SweepMicrosecondsAfter = MeasureWallSweeps(World, NumSamples, Seed);
+
+	bool bSaved = true;
+	if (bSave && OutReport.NumChunks > 0)
+	{
+		const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetMapPackageExtension());
+		FSavePackageArgs SaveArgs;
+		SaveArgs.TopLevelFlags = RF_Standalone;
+		bSaved = UPackage::SavePackage(Package, World, *Filename, SaveArgs);
+		if (!bSaved)
+		{
+			UE_LOG(LogPlatformer2DEditor, Error, TEXT("Could not save %s"), *Filename);
+		}
+	}
+
+	if (bInitializedHere)
+	{
+		World->DestroyWorld(false);
+	}
+	GEngine->DestroyWorldContext(World);
+	World->RemoveFromRoot();
+	return bSaved;
+}
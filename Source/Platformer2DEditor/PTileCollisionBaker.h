@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPaperTileMapComponent;
+class UWorld;
+
+struct PLATFORMER2DEDITOR_API FPTileCollisionBakeReport
+{
+	int32 NumTileMaps = 0;
+	/** Tile maps left alone because they are not orthogonal or have tiles with collision smaller than the tile. */
+	int32 NumSkippedTileMaps = 0;
+	int32 NumSolidTiles = 0;
+	int32 NumShapesBefore = 0;
+	int32 NumShapesAfter = 0;
+	int32 NumChunks = 0;
+
+	/** Mean cost of one DetectWall style pair of sweeps, before and after the bake. Negative if not measured. */
+	double SweepMicrosecondsBefore = -1.0;
+	double SweepMicrosecondsAfter = -1.0;
+
+	FString ToString() const;
+};
+
+/**
+ * Editor-time baking of Paper2D tile map collision.
+ *
+ * The solid tiles of every collision layer are merged into maximal rectangles with greedy meshing, chunk by chunk,
+ * and each chunk becomes one UPBakedTileCollisionComponent attached to its tile map component.
+ * The tile map's own per-tile collision is turned off, clearing the bake turns it back on.
+ */
+namespace PTileCollisionBaker
+{
+	/**
+	 * Covers the solid cells inside Region with as few rectangles as possible, greedily growing each one
+	 * first along X, then along Y. Cells are indexed Y * Width + X, rectangles have an exclusive max.
+	 */
+	PLATFORMER2DEDITOR_API void GreedyMesh(const TBitArray<>& SolidCells, int32 Width, const FIntRect& Region, TArray<FIntRect>& OutRects);
+
+	/** Bakes every tile map component of the world's persistent level, replacing any previous bake. */
+	PLATFORMER2DEDITOR_API void BakeWorld(UWorld* World, int32 ChunkSize, FPTileCollisionBakeReport& OutReport);
+
+	/** Removes the baked components of the world and restores the tile maps' collision. @return the number of components removed */
+	PLATFORMER2DEDITOR_API int32 ClearWorld(UWorld* World);
+
+	/**
+	 * Runs the sweeps DetectWall falls back to at NumSamples random points inside the world's tile maps.
+	 * The same Seed gives the same points, so runs before and after a bake are comparable.
+	 * @return mean microseconds per pair of sweeps
+	 */
+	PLATFORMER2DEDITOR_API double MeasureWallSweeps(UWorld* World, int32 NumSamples, int32 Seed);
+
+	/**
+	 * Loads a map, measures, bakes, measures again and saves it unless bSave is false.
+	 * The map must not be the one open in the editor.
+	 */
+	PLATFORMER2DEDITOR_API bool BakeMap(const FString& MapName, int32 ChunkSize, int32 NumSamples, int32 Seed, bool bSave, FPTileCollisionBakeReport& OutReport);
+}
@@ -0,0 +1,337 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PTileMapSplitter.h"
+#include "Platformer2DEditor.h"
+#include "PBakedTileCollisionComponent.h"
+#include "PTileMapStreamer.h"
+
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "DynamicMeshBuilder.h"
+#include "EngineUtils.h"
+#include "PaperTileLayer.h"
+#include "PaperTileMap.h"
+#include "PaperTileMapComponent.h"
+#include "Misc/PackageName.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+namespace PTileMapSplitter
+{
+	int32 CountTiles(const UPaperTileMap* TileMap, const FIntRect& Region)
+	{
+		int32 NumTiles = 0;
+		for (const UPaperTileLayer* Layer : TileMap->TileLayers)
+		{
+			if (!Layer)
+			{
+				continue;
+			}
+			const int32 MaxX = FMath::Min(Region.Max.X, Layer->GetLayerWidth());
+			const int32 MaxY = FMath::Min(Region.Max.Y, Layer->GetLayerHeight());
+			for (int32 Y = Region.Min.Y; Y < MaxY; ++Y)
+			{
+				for (int32 X = Region.Min.X; X < MaxX; ++X)
+				{
+					NumTiles += Layer->GetCell(X, Y).IsValid() ? 1 : 0;
+				}
+			}
+		}
+		return NumTiles;
+	}
+
+	/** What the chunk costs while it is active: its cells, the render proxy's two triangles per tile and its collision. */
+	int64 EstimateChunkBytes(const UPaperTileMap* Chunk, int32 NumTiles)
+	{
+		int64 Bytes = 0;
+		for (const UPaperTileLayer* Layer : Chunk->TileLayers)
+		{
+			if (Layer)
+			{
+				Bytes += static_cast<int64>(Layer->GetLayerWidth()) * Layer->GetLayerHeight() * sizeof(FPaperTileInfo);
+			}
+		}
+		Bytes += static_cast<int64>(NumTiles) * 6 * sizeof(FDynamicMeshVertex);
+		if (Chunk->BodySetup)
+		{
+			const FKAggregateGeom& Geometry = Chunk->BodySetup->AggGeom;
+			Bytes += Geometry.BoxElems.Num() * sizeof(FKBoxElem);
+			for (const FKConvexElem& Convex : Geometry.ConvexElems)
+			{
+				Bytes += sizeof(FKConvexElem) + Convex.VertexData.Num() * sizeof(FVector) + Convex.IndexData.Num() * sizeof(int32);
+			}
+		}
+		return Bytes;
+	}
+
+	/** The components PBakeTileCollision attached to the source, their boxes replace the tile map's own collision. */
+	void GetBakedCollision(const UPaperTileMapComponent* SourceComponent, TArray<UPBakedTileCollisionComponent*>& OutBakedComponents)
+	{
+		TArray<USceneComponent*> Children;
+		SourceComponent->GetChildrenComponents(false, Children);
+		for (USceneComponent* Child : Children)
+		{
+			if (UPBakedTileCollisionComponent* BakedComponent = Cast<UPBakedTileCollisionComponent>(Child))
+			{
+				OutBakedComponents.Add(BakedComponent);
+			}
+		}
+	}
+
+	/**
+	 * Clips the baked boxes to the chunk's tiles. Chunks start on tile edges and the boxes cover whole tiles,
+	 * so the clipped boxes still do. Boxes go from the source component's space to the chunk component's.
+	 */
+	void ClipBakedCollision(const TArray<UPBakedTileCollisionComponent*>& BakedComponents, const FPTileMapChunk& Entry, TArray<FBox>& OutBoxes)
+	{
+		for (const UPBakedTileCollisionComponent* BakedComponent : BakedComponents)
+		{
+			const FTransform& Transform = BakedComponent->GetRelativeTransform();
+			for (const FBox& BakedBox : BakedComponent->GetBoxes())
+			{
+				FBox Box = BakedBox.TransformBy(Transform);
+				Box.Min.X = FMath::Max(Box.Min.X, Entry.LocalBounds.Min.X);
+				Box.Max.X = FMath::Min(Box.Max.X, Entry.LocalBounds.Max.X);
+				Box.Min.Z = FMath::Max(Box.Min.Z, Entry.LocalBounds.Min.Z);
+				Box.Max.Z = FMath::Min(Box.Max.Z, Entry.LocalBounds.Max.Z);
+				if (Box.Max.X - Box.Min.X > KINDA_SMALL_NUMBER && Box.Max.Z - Box.Min.Z > KINDA_SMALL_NUMBER)
+				{
+					OutBoxes.Add(Box.ShiftBy(-Entry.RelativeLocation));
+				}
+			}
+		}
+	}
+
+	/** Copies Source into a new asset, replacing the one an earlier split left there. */
+	UPaperTileMap* CreateChunkAsset(const UPaperTileMap* Source, const FString& PackageName)
+	{
+		const FString AssetName = FPackageName::GetLongPackageAssetName(PackageName);
+		UPackage* Package = CreatePackage(*PackageName);
+		Package->FullyLoad();
+		if (UPaperTileMap* Existing = FindObject<UPaperTileMap>(Package, *AssetName))
+		{
+			Existing->ClearFlags(RF_Public | RF_Standalone);
+			Existing->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional);
+		}
+
+		UPaperTileMap* Chunk = DuplicateObject<UPaperTileMap>(Source, Package, *AssetName);
+		Chunk->SetFlags(RF_Public | RF_Standalone);
+		FAssetRegistryModule::AssetCreated(Chunk);
+		return Chunk;
+	}
+
+	APTileMapStreamer* FindOrSpawnStreamer(UWorld* World, UPaperTileMapComponent* SourceComponent)
+	{
+		for (TActorIterator<APTileMapStreamer> It(World); It; ++It)
+		{
+			if (It->SourceComponents.Contains(SourceComponent))
+			{
+				return *It;
+			}
+		}
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags = RF_Transactional;
+		APTileMapStreamer* Streamer = World->SpawnActor<APTileMapStreamer>(SpawnParams);
+		Streamer->SetActorLabel(FString::Printf(TEXT("%s_Streamer"), *SourceComponent->GetOwner()->GetActorLabel()));
+		Streamer->SourceComponents.Add(SourceComponent);
+		return Streamer;
+	}
+
+	void SplitComponent(UPaperTileMapComponent* SourceComponent, int32 ChunkSize, const FString& OutputPath,
+		TArray<UPackage*>& OutDirtyPackages, FPTileMapSplitReport& OutReport)
+	{
+		const UPaperTileMap* Source = SourceComponent->TileMap;
+		if (!Source)
+		{
+			return;
+		}
+
+		++OutReport.NumTileMaps;
+		if (Source->ProjectionMode != ETileMapProjectionMode::Orthogonal)
+		{
+			UE_LOG(LogPlatformer2DEditor, Warning, TEXT("Skipping %s, only orthogonal tile maps are split"), *Source->GetName());
+			++OutReport.NumSkippedTileMaps;
+			return;
+		}
+
+		UWorld* World = SourceComponent->GetWorld();
+		APTileMapStreamer* Streamer = FindOrSpawnStreamer(World, SourceComponent);
+		Streamer->Modify();
+		Streamer->SetActorTransform(SourceComponent->GetComponentTransform());
+		Streamer->CollisionProfileName = SourceComponent->GetCollisionProfileName();
+		Streamer->Chunks.Reset();
+
+		// A baked source has its own collision turned off, the baked components kept its profile
+		TArray<UPBakedTileCollisionComponent*> BakedComponents;
+		GetBakedCollision(SourceComponent, BakedComponents);
+		Streamer->bBakedCollision = BakedComponents.Num() > 0;
+		Streamer->BakedTileSize = 0.f;
+		if (Streamer->bBakedCollision)
+		{
+			Streamer->CollisionProfileName = BakedComponents[0]->GetCollisionProfileName();
+			Streamer->BakedTileSize = BakedComponents[0]->GetTileSize();
+		}
+
+		const FString AssetPrefix = FString::Printf(TEXT("%s_%s"), *Source->GetName(), *SourceComponent->GetOwner()->GetName());
+		for (int32 ChunkY = 0; ChunkY * ChunkSize < Source->MapHeight; ++ChunkY)
+		{
+			for (int32 ChunkX = 0; ChunkX * ChunkSize < Source->MapWidth; ++ChunkX)
+			{
+				const FIntRect Region(ChunkX * ChunkSize, ChunkY * ChunkSize,
+					FMath::Min((ChunkX + 1) * ChunkSize, Source->MapWidth), FMath::Min((ChunkY + 1) * ChunkSize, Source->MapHeight));
+				const int32 NumTiles = CountTiles(Source, Region);
+				if (NumTiles == 0)
+				{
+					++OutReport.NumEmptyChunks;
+					continue;
+				}
+
+				UPaperTileMap* Chunk = CreateChunkAsset(Source, OutputPath / FString::Printf(TEXT("%s_%d_%d"), *AssetPrefix, ChunkX, ChunkY));
+				Chunk->ResizeMap(Region.Width(), Region.Height());
+				for (int32 LayerIndex = 0; LayerIndex < Chunk->TileLayers.Num(); ++LayerIndex)
+				{
+					const UPaperTileLayer* SourceLayer = Source->TileLayers[LayerIndex];
+					UPaperTileLayer* Layer = Chunk->TileLayers[LayerIndex];
+					for (int32 Y = 0; Y < Region.Height(); ++Y)
+					{
+						for (int32 X = 0; X < Region.Width(); ++X)
+						{
+							const int32 SourceX = Region.Min.X + X;
+							const int32 SourceY = Region.Min.Y + Y;
+							const bool bInLayer = SourceLayer && SourceX < SourceLayer->GetLayerWidth() && SourceY < SourceLayer->GetLayerHeight();
+							Layer->SetCell(X, Y, bInLayer ? SourceLayer->GetCell(SourceX, SourceY) : FPaperTileInfo());
+						}
+					}
+				}
+				Chunk->RebuildCollision();
+				Chunk->PostEditChange();
+				OutDirtyPackages.AddUnique(Chunk->GetOutermost());
+
+				// Positions are affine in the tile coordinates, so the chunk's first tile lands where it was in the source
+				FPTileMapChunk& Entry = Streamer->Chunks.AddDefaulted_GetRef();
+				Entry.TileMap = Chunk;
+				Entry.Coordinates = FIntPoint(ChunkX, ChunkY);
+				Entry.RelativeLocation = Source->GetTilePositionInLocalSpace(Region.Min.X, Region.Min.Y) - Chunk->GetTilePositionInLocalSpace(0, 0);
+				Entry.LocalBounds = FBox(ForceInit);
+				for (int32 LayerIndex = 0; LayerIndex < Chunk->TileLayers.Num(); ++LayerIndex)
+				{
+					Entry.LocalBounds += Entry.RelativeLocation + Chunk->GetTilePositionInLocalSpace(0, 0, LayerIndex);
+					Entry.LocalBounds += Entry.RelativeLocation + Chunk->GetTilePositionInLocalSpace(Region.Width(), Region.Height(), LayerIndex);
+				}
+				Entry.NumTiles = NumTiles;
+				Entry.EstimatedBytes = EstimateChunkBytes(Chunk, NumTiles);
+				if (Streamer->bBakedCollision)
+				{
+					ClipBakedCollision(BakedComponents, Entry, Entry.CollisionBoxes);
+					Entry.EstimatedBytes += Entry.CollisionBoxes.Num() * (sizeof(FBox) + sizeof(FKBoxElem));
+				}
+
+				++OutReport.NumChunks;
+				OutReport.TotalBytes += Entry.EstimatedBytes;
+				OutReport.MaxChunkBytes = FMath::Max(OutReport.MaxChunkBytes, Entry.EstimatedBytes);
+			}
+		}
+
+		// Kept for editing, but never cooked, and neither is its baked collision which the chunks now carry
+		SourceComponent->Modify();
+		SourceComponent->bIsEditorOnly = true;
+		for (UPBakedTileCollisionComponent* BakedComponent : BakedComponents)
+		{
+			BakedComponent->Modify();
+			BakedComponent->bIsEditorOnly = true;
+		}
+	}
+}
+
+FString FPTileMapSplitReport::ToString() const
+{
+	return FString::Printf(TEXT("%d tile maps (%d skipped) split into %d chunks (%d empty chunks dropped), %.1f KB total, %.1f KB per chunk on average, %.1f KB at most"),
+		NumTileMaps, NumSkippedTileMaps, NumChunks, NumEmptyChunks, TotalBytes / 1024.0,
+		NumChunks > 0 ? TotalBytes / 1024.0 / NumChunks : 0.0, MaxChunkBytes / 1024.0);
+}
+
+void PTileMapSplitter::SplitWorld(UWorld* World, int32 ChunkSize, const FString& OutputPath, TArray<UPackage*>& OutDirtyPackages, FPTileMapSplitReport& OutReport)
+{
+	ChunkSize = FMath::Max(ChunkSize, 1);
+
+	// Collected first, splitting spawns streamers
+	TArray<UPaperTileMapComponent*> TileMapComponents;
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (!It->IsA<APTileMapStreamer>())
+		{
+			TInlineComponentArray<UPaperTileMapComponent*> Components(*It);
+			TileMapComponents.Append(Components);
+		}
+	}
+
+	for (UPaperTileMapComponent* Component : TileMapComponents)
+	{
+		SplitComponent(Component, ChunkSize, OutputPath, OutDirtyPackages, OutReport);
+	}
+	if (OutReport.NumChunks > 0)
+	{
+		OutDirtyPackages.AddUnique(World->GetOutermost());
+	}
+}
+
+bool PTileMapSplitter::SplitMap(const FString& MapName, int32 ChunkSize, const FString& OutputPath, bool bSave, FPTileMapSplitReport& OutReport)
+{
+	UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = MapPackage ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+	if (!World)
+	{
+		UE_LOG(LogPlatformer2DEditor, Error, TEXT("Could not load map %s"), *MapName);
+		return false;
+	}
+
+	// Spawning the streamers needs an initialized world, torn down after saving
+	World->WorldType = EWorldType::Editor;
+	World->AddToRoot();
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Editor);
+	WorldContext.SetCurrentWorld(World);
+	const bool bInitializedHere = !World->bIsWorldInitialized;
+	if (bInitializedHere)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(false)
+			.RequiresHitProxies(false)
+			.CreatePhysicsScene(false)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.ShouldSimulatePhysics(false)
+			.SetTransactional(false));
+	}
+	World->UpdateWorldComponents(true, false);
+
+	TArray<UPackage*> DirtyPackages;
+	SplitWorld(World, ChunkSize, OutputPath / World->GetName(), DirtyPackages, OutReport);
+
+	bool bSaved = true;
+	if (bSave)
+	{
+		for (UPackage* Package : DirtyPackages)
+		{
+			const bool bIsMap = Package == MapPackage;
+			const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(),
+				bIsMap ? FPackageName::GetMapPackageExtension() : FPackageName::GetAssetPackageExtension());
+			FSavePackageArgs SaveArgs;
+			SaveArgs.TopLevelFlags = bIsMap ? RF_Standalone : RF_Public | RF_Standalone;
+			if (!UPackage::SavePackage(Package, bIsMap ? World : nullptr, *Filename, SaveArgs))
+			{
+				UE_LOG(LogPlatformer2DEditor, Error, TEXT("Could not save %s"), *Filename);
+				bSaved = false;
+			}
+		}
+	}
+
+	if (bInitializedHere)
+	{
+		World->DestroyWorld(false);
+	}
+	GEngine->DestroyWorldContext(World);
+	World->RemoveFromRoot();
+	return bSaved;
+}
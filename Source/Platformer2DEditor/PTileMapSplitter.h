@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPackage;
+class UWorld;
+
+struct PLATFORMER2DEDITOR_API FPTileMapSplitReport
+{
+	int32 NumTileMaps = 0;
+	/** Tile maps left alone because they are not orthogonal. */
+	int32 NumSkippedTileMaps = 0;
+	int32 NumChunks = 0;
+	/** Chunks without a single tile, no asset is written for them. */
+	int32 NumEmptyChunks = 0;
+	int64 TotalBytes = 0;
+	int64 MaxChunkBytes = 0;
+
+	FString ToString() const;
+};
+
+/**
+ * Editor-time splitting of large Paper2D tile maps into chunks streamed by APTileMapStreamer.
+ *
+ * Every ChunkSize x ChunkSize block of tiles with at least one tile becomes its own tile map asset,
+ * with all the layers and settings of the source. One streamer per source tile map component lists the chunks,
+ * and the source component is made editor only, so it can still be edited and split again.
+ * If the source's collision was baked by PTileCollisionBaker, each chunk takes the baked boxes over its tiles
+ * and the baked components become editor only as well. Bake before splitting, a bake after the split is not picked up until the next split.
+ */
+namespace PTileMapSplitter
+{
+	/** Splits every tile map component of the world's persistent level, refreshing the streamers of earlier splits. */
+	PLATFORMER2DEDITOR_API void SplitWorld(UWorld* World, int32 ChunkSize, const FString& OutputPath, TArray<UPackage*>& OutDirtyPackages, FPTileMapSplitReport& OutReport);
+
+	/**
+	 * Loads a map, splits it and saves it with the chunk assets unless bSave is false.
+	 * Chunks go to OutputPath/<map name>. The map must not be the one open in the editor.
+	 */
+	PLATFORMER2DEDITOR_API bool SplitMap(const FString& MapName, int32 ChunkSize, const FString& OutputPath, bool bSave, FPTileMapSplitReport& OutReport);
+}
@@ -0,0 +1,15 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class Platformer2DEditor : ModuleRules
+{
+	public Platformer2DEditor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "Paper2D", "Platformer2D" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "AssetRegistry", "ContentBrowser", "PhysicsCore", "Slate", "SlateCore", "ToolMenus", "UnrealEd" });
+	}
+}
@@ -0,0 +1,114 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Platformer2DEditor.h"
+#include "PTileCollisionBaker.h"
+
+#include "ContentBrowserMenuContexts.h"
+#include "Editor.h"
+#include "ScopedTransaction.h"
+#include "ToolMenus.h"
+
+IMPLEMENT_MODULE(FPlatformer2DEditorModule, Platformer2DEditor);
+
+DEFINE_LOG_CATEGORY(LogPlatformer2DEditor);
+
+#define LOCTEXT_NAMESPACE "Platformer2DEditor"
+
+namespace PTileCollisionBakeAction
+{
+	constexpr int32 ChunkSize = 32;
+	constexpr int32 NumSamples = 100000;
+	constexpr int32 Seed = 1337;
+
+	TArray<UWorld*> GetSelectedWorlds(const FToolMenuContext& MenuContext)
+	{
+		TArray<UWorld*> Worlds;
+		if (const UContentBrowserAssetContextMenuContext* Context = MenuContext.FindContext<UContentBrowserAssetContextMenuContext>())
+		{
+			for (const TWeakObjectPtr<UObject>& Object : Context->SelectedObjects)
+			{
+				if (UWorld* World = Cast<UWorld>(Object.Get()))
+				{
+					Worlds.Add(World);
+				}
+			}
+		}
+		return Worlds;
+	}
+
+	bool IsEditorWorld(const UWorld* World)
+	{
+		return GEditor && GEditor->GetEditorWorldContext().World() == World;
+	}
+
+	void Bake(const FToolMenuContext& MenuContext)
+	{
+		for (UWorld* World : GetSelectedWorlds(MenuContext))
+		{
+			FPTileCollisionBakeReport Report;
+			if (IsEditorWorld(World))
+			{
+				// The open map is baked in place and left dirty, so the bake can be undone and is saved with the map
+				const FScopedTransaction Transaction(LOCTEXT("BakeTileCollision", "Bake Tile Collision"));
+				Report.SweepMicrosecondsBefore = PTileCollisionBaker::MeasureWallSweeps(World, NumSamples, Seed);
+				PTileCollisionBaker::BakeWorld(World, ChunkSize, Report);
+				Report.SweepMicrosecondsAfter = PTileCollisionBaker::MeasureWallSweeps(World, NumSamples, Seed);
+				World->MarkPackageDirty();
+			}
+			else if (!PTileCollisionBaker::BakeMap(World->GetOutermost()->GetName(), ChunkSize, NumSamples, Seed, true, Report))
+			{
+				continue;
+			}
+			UE_LOG(LogPlatformer2DEditor, Display, TEXT("%s: %s"), *World->GetName(), *Report.ToString());
+		}
+	}
+
+	void Clear(const FToolMenuContext& MenuContext)
+	{
+		for (UWorld* World : GetSelectedWorlds(MenuContext))
+		{
+			if (!IsEditorWorld(World))
+			{
+				UE_LOG(LogPlatformer2DEditor, Warning, TEXT("Open %s to clear its tile collision bake"), *World->GetName());
+				continue;
+			}
+			const FScopedTransaction Transaction(LOCTEXT("ClearTileCollisionBake", "Clear Tile Collision Bake"));
+			const int32 NumRemoved = PTileCollisionBaker::ClearWorld(World);
+			World->MarkPackageDirty();
+			UE_LOG(LogPlatformer2DEditor, Display, TEXT("%s: removed %d baked tile collision components"), *World->GetName(), NumRemoved);
+		}
+	}
+}
+
+void FPlatformer2DEditorModule::StartupModule()
+{
+	UToolMenus::RegisterStartupCallback(FSimpleMulticastDelegate::FDelegate::CreateRaw(this, &FPlatformer2DEditorModule::RegisterMenus));
+}
+
+void FPlatformer2DEditorModule::ShutdownModule()
+{
+	UToolMenus::UnRegisterStartupCallback(this);
+	UToolMenus::UnregisterOwner(this);
+}
+
+void FPlatformer2DEditorModule::RegisterMenus()
+{
+	FToolMenuOwnerScoped OwnerScoped(this);
+
+	UToolMenu* Menu = UToolMenus::Get()->ExtendMenu("ContentBrowser.AssetContextMenu.World");
+	FToolMenuSection& Section = Menu->FindOrAddSection("GetAssetActions");
+	Section.AddMenuEntry(
+		"PBakeTileCollision",
+		LOCTEXT("BakeTileCollisionLabel", "Bake Tile Collision"),
+		LOCTEXT("BakeTileCollisionTooltip", "Merges the solid tiles of every tile map into a few collision boxes per chunk and reports the shape reduction and wall sweep cost."),
+		FSlateIcon(),
+		FToolUIActionChoice(FToolMenuExecuteAction::CreateStatic(&PTileCollisionBakeAction::Bake)));
+	Section.AddMenuEntry(
+		"PClearTileCollisionBake",
+		LOCTEXT("ClearTileCollisionBakeLabel", "Clear Tile Collision Bake"),
+		LOCTEXT("ClearTileCollisionBakeTooltip", "Removes the baked collision of the open map and turns the tile maps' own collision back on."),
+		FSlateIcon(),
+		FToolUIActionChoice(FToolMenuExecuteAction::CreateStatic(&PTileCollisionBakeAction::Clear)));
+}
+
+#undef LOCTEXT_NAMESPACE